@@ -0,0 +1,471 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "verilogAST.hpp"
+#include "verilogAST/connectivity.hpp"
+#include "verilogAST/emit_stats.hpp"
+#include "verilogAST/memory_usage.hpp"
+#include "verilogAST/parser.hpp"
+#include "verilogAST/passes.hpp"
+#include "verilogAST/serialize.hpp"
+
+namespace vAST = verilogAST;
+
+// Count every heap allocation made by the process so that benchmarks can
+// report allocations per node
+static std::atomic<size_t> num_allocations{0};
+
+// The replacements are not inlined, so that the compiler does not pair the
+// `malloc` and `free` in here with `new` and `delete` expressions
+// (-Wmismatched-new-delete)
+__attribute__((noinline)) void *operator new(size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+  throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void *ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+
+// Tracks the allocations made while a benchmark runs
+class AllocationCounter {
+  size_t start;
+
+ public:
+  AllocationCounter() : start(num_allocations.load()) {}
+
+  // Reports allocations per node, `nodes` is the number of nodes processed
+  // by a single iteration
+  void report(benchmark::State &state, size_t nodes) {
+    double allocations = num_allocations.load() - start;
+    state.counters["allocs_per_node"] =
+        allocations / (static_cast<double>(state.iterations()) * nodes);
+  }
+};
+
+std::unique_ptr<vAST::Expression> make_binop_chain(size_t depth) {
+  std::unique_ptr<vAST::Expression> expr = vAST::make_id("x");
+  for (size_t i = 0; i < depth; i++) {
+    expr = vAST::make_binop(std::move(expr), vAST::BinOp::ADD,
+                            vAST::make_id("in" + std::to_string(i % 64)));
+  }
+  return expr;
+}
+
+std::unique_ptr<vAST::Concat> make_concat(size_t width) {
+  std::vector<std::unique_ptr<vAST::Expression>> args;
+  args.reserve(width);
+  for (size_t i = 0; i < width; i++) {
+    args.push_back(std::make_unique<vAST::Index>(
+        vAST::make_id("bus"), vAST::make_num(std::to_string(i))));
+  }
+  return std::make_unique<vAST::Concat>(std::move(args));
+}
+
+std::unique_ptr<vAST::ModuleInstantiation> make_instance(size_t ports) {
+  vAST::SymbolTable &symbols = vAST::SymbolTable::current();
+  vAST::Connections connections;
+  connections.reserve(ports);
+  for (size_t i = 0; i < ports; i++) {
+    std::string name = "port" + std::to_string(i);
+    connections.emplace_back(symbols.intern(name),
+                             vAST::make_id(name + "_net"));
+  }
+  vAST::Parameters parameters;
+  parameters.push_back(
+      std::make_pair(vAST::make_id("width"), vAST::make_num("8")));
+  return std::make_unique<vAST::ModuleInstantiation>(
+      "child", std::move(parameters), "child_inst", std::move(connections));
+}
+
+std::unique_ptr<vAST::Module> make_module(const std::string &name) {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(vAST::make_port(
+      vAST::make_vector(vAST::make_id("in"), vAST::make_num("7"),
+                        vAST::make_num("0")),
+      vAST::INPUT, vAST::WIRE));
+  ports.push_back(vAST::make_port(vAST::make_id("out"), vAST::OUTPUT,
+                                  vAST::WIRE));
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  body.push_back(std::make_unique<vAST::Wire>(vAST::make_id("tmp")));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("tmp"),
+      vAST::make_binop(
+          std::make_unique<vAST::Index>(vAST::make_id("in"),
+                                        vAST::make_num("0")),
+          vAST::BinOp::EQ,
+          std::make_unique<vAST::Index>(vAST::make_id("in"),
+                                        vAST::make_num("1")))));
+  body.push_back(make_instance(8));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("out"), vAST::make_id("tmp")));
+  return std::make_unique<vAST::Module>(name, std::move(ports),
+                                        std::move(body), vAST::Parameters());
+}
+
+std::unique_ptr<vAST::File> make_file(size_t num_modules) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  for (size_t i = 0; i < num_modules; i++) {
+    modules.push_back(make_module("module" + std::to_string(i)));
+  }
+  return std::make_unique<vAST::File>(modules);
+}
+
+// Nodes created by `make_module`
+constexpr size_t kNodesPerModule = 33;
+
+// Identifier
+
+void BM_IdentifierToString(benchmark::State &state, const char *name) {
+  vAST::Identifier id(name);
+  size_t bytes = 0;
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    std::string str = id.toString();
+    bytes += str.size();
+    benchmark::DoNotOptimize(str);
+  }
+  allocations.report(state, 1);
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK_CAPTURE(BM_IdentifierToString, plain, "data_out_valid");
+BENCHMARK_CAPTURE(BM_IdentifierToString, keyword, "always_comb");
+BENCHMARK_CAPTURE(BM_IdentifierToString, escaped, "inst.data[3]");
+
+void BM_IdentifierConstruct(benchmark::State &state) {
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(vAST::make_id("data_out_valid"));
+  }
+  allocations.report(state, 1);
+}
+BENCHMARK(BM_IdentifierConstruct);
+
+// BinaryOp chains
+
+void BM_BinaryOpChainConstruct(benchmark::State &state) {
+  size_t depth = state.range(0);
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(make_binop_chain(depth));
+  }
+  allocations.report(state, 2 * depth + 1);
+}
+BENCHMARK(BM_BinaryOpChainConstruct)->Range(64, 8 << 10);
+
+void BM_BinaryOpChainEmit(benchmark::State &state) {
+  size_t depth = state.range(0);
+  std::unique_ptr<vAST::Expression> expr = make_binop_chain(depth);
+  size_t bytes = 0;
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    std::string str = expr->toString();
+    bytes += str.size();
+    benchmark::DoNotOptimize(str);
+  }
+  allocations.report(state, 2 * depth + 1);
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_BinaryOpChainEmit)->Range(64, 8 << 10);
+
+// Wide concatenations
+
+void BM_ConcatConstruct(benchmark::State &state) {
+  size_t width = state.range(0);
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(make_concat(width));
+  }
+  allocations.report(state, 3 * width + 1);
+}
+BENCHMARK(BM_ConcatConstruct)->Range(64, 64 << 10);
+
+void BM_ConcatEmit(benchmark::State &state) {
+  size_t width = state.range(0);
+  std::unique_ptr<vAST::Concat> concat = make_concat(width);
+  size_t bytes = 0;
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    std::string str = concat->toString();
+    bytes += str.size();
+    benchmark::DoNotOptimize(str);
+  }
+  allocations.report(state, 3 * width + 1);
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_ConcatEmit)->Range(64, 64 << 10);
+
+// Module instances with many connections
+
+void BM_ModuleInstantiationConstruct(benchmark::State &state) {
+  size_t ports = state.range(0);
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(make_instance(ports));
+  }
+  allocations.report(state, ports + 3);
+}
+BENCHMARK(BM_ModuleInstantiationConstruct)->Range(64, 8 << 10);
+
+void BM_ModuleInstantiationEmit(benchmark::State &state) {
+  size_t ports = state.range(0);
+  std::unique_ptr<vAST::ModuleInstantiation> inst = make_instance(ports);
+  size_t bytes = 0;
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    std::string str = inst->toString();
+    bytes += str.size();
+    benchmark::DoNotOptimize(str);
+  }
+  allocations.report(state, ports + 3);
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_ModuleInstantiationEmit)->Range(64, 8 << 10);
+
+// Files with many modules
+
+void BM_FileConstruct(benchmark::State &state) {
+  size_t num_modules = state.range(0);
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(make_file(num_modules));
+  }
+  allocations.report(state, num_modules * kNodesPerModule);
+}
+BENCHMARK(BM_FileConstruct)->Range(1 << 10, 16 << 10);
+
+void BM_FileToString(benchmark::State &state) {
+  size_t num_modules = state.range(0);
+  std::unique_ptr<vAST::File> file = make_file(num_modules);
+  size_t bytes = 0;
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    std::string str = file->toString();
+    bytes += str.size();
+    benchmark::DoNotOptimize(str);
+  }
+  allocations.report(state, num_modules * kNodesPerModule);
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_FileToString)->Range(1 << 10, 16 << 10);
+
+void BM_FileToStringCompact(benchmark::State &state) {
+  size_t num_modules = state.range(0);
+  std::unique_ptr<vAST::File> file = make_file(num_modules);
+  file->emit_options.compact = true;
+  size_t bytes = 0;
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    std::string str = file->toString();
+    bytes += str.size();
+    benchmark::DoNotOptimize(str);
+  }
+  allocations.report(state, num_modules * kNodesPerModule);
+  state.SetBytesProcessed(bytes);
+  state.counters["bytes_per_module"] =
+      static_cast<double>(bytes) / state.iterations() / num_modules;
+}
+BENCHMARK(BM_FileToStringCompact)->Range(1 << 10, 16 << 10);
+
+// Emission of unchanged modules through the cache
+void BM_FileToStringCached(benchmark::State &state) {
+  size_t num_modules = state.range(0);
+  std::unique_ptr<vAST::File> file = make_file(num_modules);
+  file->cacheEmission(true);
+  file->toString();
+  size_t bytes = 0;
+  for (auto _ : state) {
+    std::string str = file->toString();
+    bytes += str.size();
+    benchmark::DoNotOptimize(str);
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_FileToStringCached)->Range(1 << 10, 16 << 10);
+
+void BM_FileToStringStats(benchmark::State &state) {
+  std::unique_ptr<vAST::File> file = make_file(state.range(0));
+  size_t bytes = 0;
+  for (auto _ : state) {
+    vAST::EmitStats stats;
+    vAST::StringSink sink;
+    sink.stats = &stats;
+    file->emit(sink);
+    bytes += sink.bytesWritten();
+    benchmark::DoNotOptimize(stats);
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_FileToStringStats)->Range(1 << 10, 16 << 10);
+
+void BM_FileToStringParallel(benchmark::State &state) {
+  size_t num_modules = state.range(0);
+  std::unique_ptr<vAST::File> file = make_file(num_modules);
+  vAST::ThreadPool pool;
+  size_t bytes = 0;
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    std::string str = file->toString(pool);
+    bytes += str.size();
+    benchmark::DoNotOptimize(str);
+  }
+  allocations.report(state, num_modules * kNodesPerModule);
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_FileToStringParallel)->Range(1 << 10, 16 << 10)->UseRealTime();
+
+// Parsing
+
+void BM_Parse(benchmark::State &state) {
+  std::string source = make_file(state.range(0))->toString();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(vAST::parse(source));
+  }
+  state.SetBytesProcessed(state.iterations() * source.size());
+}
+BENCHMARK(BM_Parse)->Range(1 << 10, 16 << 10);
+
+void BM_ParseParallel(benchmark::State &state) {
+  std::string source = make_file(state.range(0))->toString();
+  vAST::ThreadPool pool;
+  vAST::ParseOptions options;
+  options.pool = &pool;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(vAST::parse(source, options));
+  }
+  state.SetBytesProcessed(state.iterations() * source.size());
+}
+BENCHMARK(BM_ParseParallel)->Range(1 << 10, 16 << 10)->UseRealTime();
+
+// Binary serialization
+
+void BM_Serialize(benchmark::State &state) {
+  std::unique_ptr<vAST::File> file = make_file(state.range(0));
+  size_t bytes = 0;
+  for (auto _ : state) {
+    vAST::StringSink sink;
+    vAST::serialize(*file, sink);
+    bytes += sink.bytesWritten();
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_Serialize)->Range(1 << 10, 16 << 10);
+
+void BM_Deserialize(benchmark::State &state) {
+  vAST::StringSink sink;
+  vAST::serialize(*make_file(state.range(0)), sink);
+  std::string data = sink.release();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(vAST::deserialize(data));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Deserialize)->Range(1 << 10, 16 << 10);
+
+// Deep copy
+
+void BM_Clone(benchmark::State &state) {
+  std::unique_ptr<vAST::File> file = make_file(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(vAST::clone(*file));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          kNodesPerModule);
+}
+BENCHMARK(BM_Clone)->Range(1 << 10, 16 << 10);
+
+// Only the nodes are copied into the arena, the strings and vectors they own
+// are still heap allocated, and discarding the copy visits all of its nodes
+void BM_CloneArena(benchmark::State &state) {
+  std::unique_ptr<vAST::File> file = make_file(state.range(0));
+  for (auto _ : state) {
+    vAST::Arena arena;
+    std::unique_ptr<vAST::File> copy = vAST::clone(*file, arena);
+    benchmark::DoNotOptimize(copy.get());
+    arena.discard(std::move(copy));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          kNodesPerModule);
+}
+BENCHMARK(BM_CloneArena)->Range(1 << 10, 16 << 10);
+
+// Memory accounting
+
+void BM_MemoryUsage(benchmark::State &state) {
+  std::unique_ptr<vAST::File> file = make_file(state.range(0));
+  size_t bytes = 0;
+  for (auto _ : state) {
+    vAST::MemoryUsage usage = file->memoryUsage();
+    bytes = usage.total().total();
+  }
+  size_t nodes = state.range(0) * kNodesPerModule;
+  state.SetItemsProcessed(state.iterations() * nodes);
+  state.counters["bytes_per_node"] = static_cast<double>(bytes) / nodes;
+}
+BENCHMARK(BM_MemoryUsage)->Range(1 << 10, 16 << 10);
+
+// Connectivity
+
+// Module with a chain of `length` wires, each the sum of the previous one and
+// the input
+std::unique_ptr<vAST::Module> make_chain(size_t length) {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(
+      vAST::make_port(vAST::make_id("in"), vAST::INPUT, vAST::WIRE));
+  ports.push_back(
+      vAST::make_port(vAST::make_id("out"), vAST::OUTPUT, vAST::WIRE));
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  std::string previous = "in";
+  for (size_t i = 0; i < length; i++) {
+    std::string name = "w" + std::to_string(i);
+    body.push_back(std::make_unique<vAST::Wire>(vAST::make_id(name)));
+    body.push_back(std::make_unique<vAST::ContinuousAssign>(
+        vAST::make_id(name),
+        vAST::make_binop(vAST::make_id(previous), vAST::BinOp::ADD,
+                         vAST::make_id("in"))));
+    previous = name;
+  }
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("out"), vAST::make_id(previous)));
+  return std::make_unique<vAST::Module>("chain", std::move(ports),
+                                        std::move(body), vAST::Parameters());
+}
+
+void BM_Connectivity(benchmark::State &state) {
+  std::unique_ptr<vAST::Module> module = make_chain(state.range(0));
+  for (auto _ : state) {
+    vAST::Connectivity graph(*module);
+    benchmark::DoNotOptimize(graph.numNets());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Connectivity)->Range(1 << 10, 1 << 20);
+
+void BM_InlineWires(benchmark::State &state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::unique_ptr<vAST::Module> module = make_chain(state.range(0));
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(vAST::inline_wires(*module));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_InlineWires)->Range(1 << 10, 256 << 10);
+
+}  // namespace
+
+BENCHMARK_MAIN();
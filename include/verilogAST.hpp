@@ -2,104 +2,313 @@
 #ifndef VERILOGAST_H
 #define VERILOGAST_H
 
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>  // std::pair
 #include <variant>
 #include <vector>
 
+#include "verilogAST/arena.hpp"
+#include "verilogAST/sink.hpp"
+#include "verilogAST/symbol.hpp"
+#include "verilogAST/thread_pool.hpp"
+
 namespace verilogAST {
 
+struct MemoryUsage;
+
+// Concrete node classes, used to dispatch on the class of a node without
+// dynamic_cast (see Node::kind)
+namespace NodeKind {
+enum NodeKind {
+  // Expressions
+  NUMERIC_LITERAL,
+  IDENTIFIER,
+  STRING,
+  INDEX,
+  SLICE,
+  BINARY_OP,
+  UNARY_OP,
+  TERNARY_OP,
+  CONCAT,
+  NEG_EDGE,
+  POS_EDGE,
+  // Everything else
+  VECTOR,
+  PORT,
+  STRING_PORT,
+  SINGLE_LINE_COMMENT,
+  BLOCK_COMMENT,
+  MODULE_INSTANTIATION,
+  WIRE,
+  REG,
+  CONTINUOUS_ASSIGN,
+  BLOCKING_ASSIGN,
+  NON_BLOCKING_ASSIGN,
+  STAR,
+  ALWAYS,
+  MODULE,
+  STRING_BODY_MODULE,
+  STRING_MODULE,
+  FILE
+};
+}
+
+inline bool is_expression(NodeKind::NodeKind kind) {
+  return kind <= NodeKind::POS_EDGE;
+}
+
+// Number of NodeKinds, for tables indexed by kind
+constexpr size_t kNumNodeKinds = NodeKind::FILE + 1;
+
+// Name of the class of the nodes of `kind`, e.g. "BinaryOp"
+const char *kind_name(NodeKind::NodeKind kind);
+
 class Node {
- public:
-  virtual std::string toString() = 0;
-  virtual ~Node() = default;
+  // Memoized `hash()`, zero if not computed yet.  Hashes are 30 bits wide so
+  // that they share a word with the flags below, and subclasses can place a
+  // 32 bit field in the padding that follows.
+  static constexpr uint32_t kHashMask = (uint32_t(1) << 30) - 1;
+  mutable uint32_t hash_memo : 30;
+  // Set if the node lives in the memory of an Arena, so that `delete` does
+  // not have to look its address up.  Set by the constructors and never
+  // copied.
+  uint32_t in_arena : 1;
+
+ protected:
+  // Set while the node is part of the cached text of a Module (see
+  // `Module::cache_emission`), which is then registered as its owner.  On a
+  // Module itself, set while its cached text is current.
+  mutable uint32_t emission_current : 1;
+  // Register the nodes of a tree, or release them without destroying them
+  friend class Module;
+  friend class Arena;
+
+ private:
+  // Clears `emission_current` here and on the registered owner, called when
+  // the node is edited or destroyed
+  void releaseEmission() const;
+
+ public:
+  Node();
+  // Copies the memoized hash
+  Node(const Node &other);
+  Node &operator=(const Node &other) {
+    hash_memo = other.hash_memo;
+    if (emission_current) releaseEmission();
+    return *this;
+  }
+
+  // Class of this node, nodes can be static_cast to the class corresponding
+  // to their kind
+  virtual NodeKind::NodeKind kind() const = 0;
+  // Appends the Verilog source for this node to `sink`
+  virtual void emit(Sink &sink) const = 0;
+  // Convenience wrapper around `emit` that collects the output in a string
+  std::string toString() const;
+  virtual ~Node();
+
+  // Hash of the structure of the tree rooted at this node, consistent with
+  // `structurallyEqual`.  Computed in one pass over the nodes that have not
+  // been hashed yet and memoized in each of them.  Not thread safe.
+  //
+  // A Transformer resets the memo of the nodes it visits.  After editing the
+  // fields of a node directly, call `invalidateHash` on it and on each of its
+  // ancestors.  Calling it on the edited node alone is enough to invalidate
+  // the emission cache of the enclosing Module (see `Module::cache_emission`).
+  size_t hash() const;
+  void invalidateHash() const {
+    hash_memo = 0;
+    if (emission_current) releaseEmission();
+  }
+  // Returns true if the trees rooted at this node and `other` have the same
+  // classes, fields and children, i.e. are indistinguishable apart from their
+  // addresses
+  bool structurallyEqual(const Node &other) const;
+
+  // Deep copy of the tree rooted at this node, made in a single pass without
+  // recursion.  The copies are allocated from the current Arena, if any (see
+  // Arena::Scope).  Use `verilogAST::clone` to keep the static type.
+  std::unique_ptr<Node> clone() const;
+  // Deep copy allocated from `arena`, which first counts the bytes of the
+  // tree and reserves them in one block
+  std::unique_ptr<Node> clone(Arena &arena) const;
+
+  // Bytes of memory owned by the tree rooted at this node, by node class (see
+  // memory_usage.hpp), computed in a single pass without recursion
+  MemoryUsage memoryUsage() const;
+
+  // Nodes are allocated from the current Arena, if any (see arena.hpp)
+  static void *operator new(size_t size);
+  static void operator delete(void *ptr);
 };
 
 class Expression : public Node {
  public:
-  virtual std::string toString() = 0;
+  virtual void emit(Sink &sink) const = 0;
   virtual ~Expression() = default;
 };
 
+namespace detail {
+// Destroys the subexpressions of `root` iteratively, called from the
+// destructors of the compound expressions so that tearing down a deep tree
+// does not recurse once per level
+void dismantle(Expression &root);
+}  // namespace detail
+
 enum Radix { BINARY, OCTAL, HEX, DECIMAL };
 
 class NumericLiteral : public Expression {
-  /// For now, we model values as strings because it depends on their radix
-  // (alternatively, we could store an unsigned integer representation and
-  //  convert it during code generation)
-  //
+  enum Form : uint8_t { DIGITS, WORD, WORDS };
+
+ public:
+  // Declared first to fill the padding at the end of Node
+  unsigned int size;  // default 32
+
+ private:
+  // Digits as written, or the bits of an integer literal: in `word` if it
+  // fits in 64 bits, otherwise in `words`, an array holding the number of
+  // words followed by the words, least significant first
+  union {
+    std::string text;
+    uint64_t word;
+    uint64_t *words;
+  };
+
+ public:
   // TODO Maybe add special toString logic for the default case? E.g. if we're
   // generating a 32 bit unsigned decimal literal (commonly used for indexing
   // into ports) then we don't need to generate the "32'd" prefix
-  std::string value;
-  unsigned int size;  // default 32
-  bool _signed;       // default false
-  Radix radix;        // default decimal
+  Radix radix;   // default decimal
+  bool _signed;  // default false
+
+ private:
+  Form form;
 
  public:
   NumericLiteral(std::string value, unsigned int size, bool _signed,
                  Radix radix)
-      : value(value), size(size), _signed(_signed), radix(radix){};
+      : size(size),
+        text(std::move(value)),
+        radix(radix),
+        _signed(_signed),
+        form(DIGITS){};
 
   NumericLiteral(std::string value, unsigned int size, bool _signed)
-      : value(value), size(size), _signed(_signed), radix(Radix::DECIMAL){};
+      : NumericLiteral(std::move(value), size, _signed, Radix::DECIMAL){};
 
   NumericLiteral(std::string value, unsigned int size)
-      : value(value), size(size), _signed(false), radix(Radix::DECIMAL){};
+      : NumericLiteral(std::move(value), size, false, Radix::DECIMAL){};
 
   NumericLiteral(std::string value)
-      : value(value), size(32), _signed(false), radix(Radix::DECIMAL){};
-  std::string toString() override;
+      : NumericLiteral(std::move(value), 32, false, Radix::DECIMAL){};
+
+  // Integer literals, bits above `size` are dropped.  Signed values are given
+  // in two's complement and emitted as the unsigned digits of their bits.
+  NumericLiteral(uint64_t word, unsigned int size = 32, bool _signed = false,
+                 Radix radix = Radix::DECIMAL);
+  // Wide integer literal, `words` are least significant first
+  NumericLiteral(const std::vector<uint64_t> &words, unsigned int size,
+                 bool _signed = false, Radix radix = Radix::HEX);
+
+  NumericLiteral(const NumericLiteral &other);
+  NumericLiteral &operator=(const NumericLiteral &) = delete;
+  ~NumericLiteral();
+
+  NodeKind::NodeKind kind() const override {
+    return NodeKind::NUMERIC_LITERAL;
+  };
+  void emit(Sink &sink) const override;
+
+  // True if the literal holds an integer rather than digits
+  bool isInteger() const { return form != DIGITS; };
+  // Digits in `radix` as written, which may include x, z and underscores.
+  // Empty for integer literals, whose digits are formatted from their words
+  // when emitted.
+  std::string_view value() const {
+    return form == DIGITS ? std::string_view(text) : std::string_view();
+  };
+  // Number of 64 bit words of an integer literal
+  size_t numWords() const {
+    return form == WORD ? 1 : form == WORDS ? words[0] : 0;
+  };
+  // Word `i` of an integer literal, least significant first, for
+  // `i < numWords()`
+  uint64_t wordAt(size_t i) const {
+    return form == WORD ? word : words[i + 1];
+  };
+  // Writes the digits of the literal (without size, sign and radix), for
+  // integer literals without allocating unless decimal and wider than 64 bits
+  void emitDigits(Sink &sink) const;
+  // `value`, or the formatted digits of an integer literal
+  std::string digits() const;
+
+  friend struct MemoryUsage;
 };
 
 // TODO also need a string literal, as strings can be used as parameter values
 
 class Identifier : public Expression {
-  std::string value;
-
  public:
-  Identifier(std::string value) : value(value){};
+  // Interned name, which also caches whether it has to be emitted as an
+  // escaped identifier
+  Symbol value;
+
+  // Interns `value` in the current SymbolTable
+  Identifier(std::string_view value)
+      : value(SymbolTable::current().intern(value)){};
+  Identifier(Symbol value) : value(value){};
+
+  // Returns true if `name` is not a simple identifier or is a keyword
+  static bool needsEscape(std::string_view name);
 
-  std::string toString() override;
+  NodeKind::NodeKind kind() const override { return NodeKind::IDENTIFIER; };
+  void emit(Sink &sink) const override;
   ~Identifier(){};
 };
 
 class String : public Expression {
+ public:
   std::string value;
 
- public:
   String(std::string value) : value(value){};
 
-  std::string toString() override;
+  NodeKind::NodeKind kind() const override { return NodeKind::STRING; };
+  void emit(Sink &sink) const override;
   ~String(){};
 };
 
 class Index : public Expression {
+ public:
   std::unique_ptr<Identifier> id;
   std::unique_ptr<Expression> index;
 
- public:
   Index(std::unique_ptr<Identifier> id, std::unique_ptr<Expression> index)
       : id(std::move(id)), index(std::move(index)){};
-  std::string toString() override;
-  ~Index(){};
+  NodeKind::NodeKind kind() const override { return NodeKind::INDEX; };
+  void emit(Sink &sink) const override;
+  ~Index();
 };
 
 class Slice : public Expression {
+ public:
   std::unique_ptr<Identifier> id;
   std::unique_ptr<Expression> high_index;
   std::unique_ptr<Expression> low_index;
 
- public:
   Slice(std::unique_ptr<Identifier> id, std::unique_ptr<Expression> high_index,
         std::unique_ptr<Expression> low_index)
       : id(std::move(id)),
         high_index(std::move(high_index)),
         low_index(std::move(low_index)){};
-  std::string toString() override;
-  ~Slice(){};
+  NodeKind::NodeKind kind() const override { return NodeKind::SLICE; };
+  void emit(Sink &sink) const override;
+  ~Slice();
 };
 
 namespace BinOp {
@@ -123,16 +332,18 @@ enum BinOp {
 }
 
 class BinaryOp : public Expression {
-  std::unique_ptr<Expression> left;
+ public:
+  // Declared first to fill the padding at the end of Node
   BinOp::BinOp op;
+  std::unique_ptr<Expression> left;
   std::unique_ptr<Expression> right;
 
- public:
   BinaryOp(std::unique_ptr<Expression> left, BinOp::BinOp op,
            std::unique_ptr<Expression> right)
-      : left(std::move(left)), op(op), right(std::move(right)){};
-  std::string toString() override;
-  ~BinaryOp(){};
+      : op(op), left(std::move(left)), right(std::move(right)){};
+  NodeKind::NodeKind kind() const override { return NodeKind::BINARY_OP; };
+  void emit(Sink &sink) const override;
+  ~BinaryOp();
 };
 
 namespace UnOp {
@@ -152,128 +363,142 @@ enum UnOp {
 }
 
 class UnaryOp : public Expression {
-  std::unique_ptr<Expression> operand;
-
+ public:
+  // Declared first to fill the padding at the end of Node
   UnOp::UnOp op;
+  std::unique_ptr<Expression> operand;
 
- public:
   UnaryOp(std::unique_ptr<Expression> operand, UnOp::UnOp op)
-      : operand(std::move(operand)), op(op){};
-  std::string toString();
-  ~UnaryOp(){};
+      : op(op), operand(std::move(operand)){};
+  NodeKind::NodeKind kind() const override { return NodeKind::UNARY_OP; };
+  void emit(Sink &sink) const override;
+  ~UnaryOp();
 };
 
 class TernaryOp : public Expression {
+ public:
   std::unique_ptr<Expression> cond;
   std::unique_ptr<Expression> true_value;
   std::unique_ptr<Expression> false_value;
 
- public:
   TernaryOp(std::unique_ptr<Expression> cond,
             std::unique_ptr<Expression> true_value,
             std::unique_ptr<Expression> false_value)
       : cond(std::move(cond)),
         true_value(std::move(true_value)),
         false_value(std::move(false_value)){};
-  std::string toString();
-  ~TernaryOp(){};
+  NodeKind::NodeKind kind() const override { return NodeKind::TERNARY_OP; };
+  void emit(Sink &sink) const override;
+  ~TernaryOp();
 };
 
 class Concat : public Expression {
+ public:
   std::vector<std::unique_ptr<Expression>> args;
 
- public:
   Concat(std::vector<std::unique_ptr<Expression>> args)
       : args(std::move(args)){};
-  std::string toString();
+  ~Concat();
+  NodeKind::NodeKind kind() const override { return NodeKind::CONCAT; };
+  void emit(Sink &sink) const override;
 };
 
 class NegEdge : public Expression {
+ public:
   std::unique_ptr<Expression> value;
 
- public:
   NegEdge(std::unique_ptr<Expression> value) : value(std::move(value)){};
-  std::string toString();
-  ~NegEdge(){};
+  NodeKind::NodeKind kind() const override { return NodeKind::NEG_EDGE; };
+  void emit(Sink &sink) const override;
+  ~NegEdge();
 };
 
 class PosEdge : public Expression {
+ public:
   std::unique_ptr<Expression> value;
 
- public:
   PosEdge(std::unique_ptr<Expression> value) : value(std::move(value)){};
-  std::string toString();
-  ~PosEdge(){};
+  NodeKind::NodeKind kind() const override { return NodeKind::POS_EDGE; };
+  void emit(Sink &sink) const override;
+  ~PosEdge();
 };
 
-enum Direction { INPUT, OUTPUT, INOUT };
+enum Direction : uint8_t { INPUT, OUTPUT, INOUT };
 
 // TODO: Unify with declarations?
-enum PortType { WIRE, REG };
+enum PortType : uint8_t { WIRE, REG };
 
 class AbstractPort : public Node {};
 
 class Vector : public Node {
+ public:
   std::unique_ptr<Identifier> id;
   std::unique_ptr<Expression> msb;
   std::unique_ptr<Expression> lsb;
 
- public:
   Vector(std::unique_ptr<Identifier> id, std::unique_ptr<Expression> msb,
          std::unique_ptr<Expression> lsb)
       : id(std::move(id)), msb(std::move(msb)), lsb(std::move(lsb)){};
-  std::string toString() override;
+  NodeKind::NodeKind kind() const override { return NodeKind::VECTOR; };
+  void emit(Sink &sink) const override;
   ~Vector(){};
 };
 
 class Port : public AbstractPort {
-  // Required
-  // `<name>` or `<name>[n]` or `name[n:m]`
-  std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Vector>> value;
-
+ public:
   // technically the following are optional (e.g. port direction/data type
   // can be declared in the body of the definition), but for now let's force
   // users to declare ports in a single, unified way for
-  // simplicity/maintenance
+  // simplicity/maintenance.  Declared first to fill the padding at the end of
+  // Node.
   Direction direction;
   PortType data_type;
 
- public:
+  // Required
+  // `<name>` or `<name>[n]` or `name[n:m]`
+  std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Vector>> value;
+
   Port(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Vector>> value,
        Direction direction, PortType data_type)
-      : value(std::move(value)),
-        direction(std::move(direction)),
-        data_type(std::move(data_type)){};
-  std::string toString();
+      : direction(std::move(direction)),
+        data_type(std::move(data_type)),
+        value(std::move(value)){};
+  NodeKind::NodeKind kind() const override { return NodeKind::PORT; };
+  void emit(Sink &sink) const override;
   ~Port(){};
 };
 
 class StringPort : public AbstractPort {
+ public:
   std::string value;
 
- public:
   StringPort(std::string value) : value(value){};
-  std::string toString() { return value; };
+  NodeKind::NodeKind kind() const override { return NodeKind::STRING_PORT; };
+  void emit(Sink &sink) const override { sink << value; };
   ~StringPort(){};
 };
 
 class Statement : public Node {};
 
 class SingleLineComment : public Statement {
+ public:
   std::string value;
 
- public:
   SingleLineComment(std::string value) : value(value){};
-  std::string toString() { return "// " + value; };
+  NodeKind::NodeKind kind() const override {
+    return NodeKind::SINGLE_LINE_COMMENT;
+  };
+  void emit(Sink &sink) const override { sink << "// " << value; };
   ~SingleLineComment(){};
 };
 
 class BlockComment : public Statement {
+ public:
   std::string value;
 
- public:
   BlockComment(std::string value) : value(value){};
-  std::string toString() { return "/*\n" + value + "\n*/"; };
+  NodeKind::NodeKind kind() const override { return NodeKind::BLOCK_COMMENT; };
+  void emit(Sink &sink) const override { sink << "/*\n" << value << "\n*/"; };
   ~BlockComment(){};
 };
 
@@ -284,54 +509,90 @@ typedef std::vector<
     std::pair<std::unique_ptr<Identifier>, std::unique_ptr<Expression>>>
     Parameters;
 
+// Expression connected to a port of a ModuleInstantiation
+typedef std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
+                     std::unique_ptr<Slice>, std::unique_ptr<Concat>>
+    Connection;
+
+// Port names and connections of a ModuleInstantiation, in emission order
+typedef std::vector<std::pair<Symbol, Connection>> Connections;
+
 class ModuleInstantiation : public StructuralStatement {
-  std::string module_name;
+ public:
+  Symbol module_name;
 
   // parameter,value
   Parameters parameters;
 
-  std::string instance_name;
+  Symbol instance_name;
 
-  // map from instance port names to connection expression
+  // instance port names and connection expressions, emitted in this order
   // NOTE: anonymous style of module connections is not supported
-  std::map<std::string,
-           std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
-                        std::unique_ptr<Slice>, std::unique_ptr<Concat>>>
-      connections;
+  Connections connections;
 
- public:
   // TODO Need to make sure that the instance parameters are a subset of the
   // module parameters
-  ModuleInstantiation(
-      std::string module_name, Parameters parameters, std::string instance_name,
-      std::map<std::string,
-               std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
-                            std::unique_ptr<Slice>, std::unique_ptr<Concat>>>
-          connections)
+  // Keeps the connections in the given order
+  ModuleInstantiation(std::string_view module_name, Parameters parameters,
+                      std::string_view instance_name, Connections connections)
+      : module_name(SymbolTable::current().intern(module_name)),
+        parameters(std::move(parameters)),
+        instance_name(SymbolTable::current().intern(instance_name)),
+        connections(std::move(connections)){};
+  ModuleInstantiation(Symbol module_name, Parameters parameters,
+                      Symbol instance_name, Connections connections)
       : module_name(module_name),
         parameters(std::move(parameters)),
         instance_name(instance_name),
         connections(std::move(connections)){};
-  std::string toString();
+  // Sorts the connections by port name
+  ModuleInstantiation(std::string_view module_name, Parameters parameters,
+                      std::string_view instance_name,
+                      std::map<std::string, Connection> connections);
+  NodeKind::NodeKind kind() const override {
+    return NodeKind::MODULE_INSTANTIATION;
+  };
+  void emit(Sink &sink) const override;
   ~ModuleInstantiation(){};
 };
 
+// Hashed lookup of the connections of an instance by port name, for
+// instances with many ports.  Refers to positions in `connections`, so it
+// has to be rebuilt after connections are added, removed or renamed.
+class ConnectionIndex {
+  std::unordered_map<Symbol, size_t> positions;
+
+ public:
+  explicit ConnectionIndex(const ModuleInstantiation &inst);
+
+  // Position of the (first) connection of `port`, or `npos` if the port is
+  // not connected
+  size_t find(Symbol port) const {
+    auto it = positions.find(port);
+    return it == positions.end() ? npos : it->second;
+  };
+
+  static constexpr size_t npos = SIZE_MAX;
+};
+
 class Declaration : public Node {
- protected:
-  std::string decl;
+ public:
   std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
                std::unique_ptr<Slice>, std::unique_ptr<Vector>>
       value;
 
+  // "wire" or "reg", implied by the class
+  std::string_view decl() const {
+    return kind() == NodeKind::REG ? "reg" : "wire";
+  };
+  void emit(Sink &sink) const override;
+  virtual ~Declaration() = default;
+
+ protected:
   Declaration(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
                            std::unique_ptr<Slice>, std::unique_ptr<Vector>>
-                  value,
-              std::string decl)
-      : decl(decl), value(std::move(value)){};
-
- public:
-  std::string toString();
-  virtual ~Declaration() = default;
+                  value)
+      : value(std::move(value)){};
 };
 
 class Wire : public Declaration {
@@ -339,7 +600,8 @@ class Wire : public Declaration {
   Wire(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
                     std::unique_ptr<Slice>, std::unique_ptr<Vector>>
            value)
-      : Declaration(std::move(value), "wire"){};
+      : Declaration(std::move(value)){};
+  NodeKind::NodeKind kind() const override { return NodeKind::WIRE; };
   ~Wire(){};
 };
 
@@ -348,40 +610,58 @@ class Reg : public Declaration {
   Reg(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
                    std::unique_ptr<Slice>, std::unique_ptr<Vector>>
           value)
-      : Declaration(std::move(value), "reg"){};
+      : Declaration(std::move(value)){};
+  NodeKind::NodeKind kind() const override { return NodeKind::REG; };
   ~Reg(){};
 };
 
-class Assign : public Node {
- protected:
+namespace AssignKind {
+enum AssignKind { CONTINUOUS, BLOCKING, NON_BLOCKING };
+}
+
+// Fields shared by the assignment statements.  Not a Node itself so that the
+// assignment classes have a single Node base.
+class Assign {
+ public:
   std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
                std::unique_ptr<Slice>>
       target;
   std::unique_ptr<Expression> value;
-  std::string prefix;
-  std::string symbol;
 
+  AssignKind::AssignKind assignKind() const {
+    return static_cast<AssignKind::AssignKind>(tagged_prefix & kKindMask);
+  };
+  // Text emitted before the target: "assign " for continuous assignments and
+  // empty for the others, unless replaced with `setPrefix`, e.g. to add a
+  // delay with "assign #1 "
+  std::string_view prefix() const;
+  // Interns `prefix` in a process-wide pool of prefixes, unless it is the
+  // default, and resets the memoized hash of the assignment.  The pool is
+  // never freed.
+  void setPrefix(std::string_view prefix);
+  // "<=" for non-blocking assignments, "=" otherwise
+  std::string_view symbol() const {
+    return assignKind() == AssignKind::NON_BLOCKING ? "<=" : "=";
+  };
+
+  void emit(Sink &sink) const;
+
+ protected:
   Assign(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
                       std::unique_ptr<Slice>>
              target,
-         std::unique_ptr<Expression> value, std::string prefix)
-      : target(std::move(target)),
-        value(std::move(value)),
-        prefix(prefix),
-        symbol("="){};
-  Assign(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
-                      std::unique_ptr<Slice>>
-             target,
-         std::unique_ptr<Expression> value, std::string prefix,
-         std::string symbol)
+         std::unique_ptr<Expression> value, AssignKind::AssignKind kind)
       : target(std::move(target)),
         value(std::move(value)),
-        prefix(prefix),
-        symbol(symbol){};
+        tagged_prefix(kind){};
+  ~Assign() = default;
 
- public:
-  std::string toString();
-  virtual ~Assign() = default;
+ private:
+  static constexpr uintptr_t kKindMask = 3;
+  // The AssignKind in the low bits and the address of the interned prefix in
+  // the others, zero if the prefix is the default.  Interned strings are
+  // aligned to more than 4 bytes, so the bits do not overlap.
+  uintptr_t tagged_prefix;
 };
 
 class ContinuousAssign : public StructuralStatement, public Assign {
@@ -390,9 +670,11 @@ class ContinuousAssign : public StructuralStatement, public Assign {
                                 std::unique_ptr<Index>, std::unique_ptr<Slice>>
                        target,
                    std::unique_ptr<Expression> value)
-      : Assign(std::move(target), std::move(value), "assign "){};
-  // Multiple inheritance forces us to have to explicitly state this?
-  std::string toString() { return Assign::toString(); };
+      : Assign(std::move(target), std::move(value), AssignKind::CONTINUOUS){};
+  NodeKind::NodeKind kind() const override {
+    return NodeKind::CONTINUOUS_ASSIGN;
+  };
+  void emit(Sink &sink) const override { Assign::emit(sink); };
   ~ContinuousAssign(){};
 };
 
@@ -404,9 +686,11 @@ class BlockingAssign : public BehavioralAssign, public Assign {
                               std::unique_ptr<Index>, std::unique_ptr<Slice>>
                      target,
                  std::unique_ptr<Expression> value)
-      : Assign(std::move(target), std::move(value), ""){};
-  // Multiple inheritance forces us to have to explicitly state this?
-  std::string toString() { return Assign::toString(); };
+      : Assign(std::move(target), std::move(value), AssignKind::BLOCKING){};
+  NodeKind::NodeKind kind() const override {
+    return NodeKind::BLOCKING_ASSIGN;
+  };
+  void emit(Sink &sink) const override { Assign::emit(sink); };
   ~BlockingAssign(){};
 };
 
@@ -416,19 +700,24 @@ class NonBlockingAssign : public BehavioralAssign, public Assign {
                                  std::unique_ptr<Index>, std::unique_ptr<Slice>>
                         target,
                     std::unique_ptr<Expression> value)
-      : Assign(std::move(target), std::move(value), "", "<="){};
-  // Multiple inheritance forces us to have to explicitly state this?
-  std::string toString() { return Assign::toString(); };
+      : Assign(std::move(target), std::move(value),
+               AssignKind::NON_BLOCKING){};
+  NodeKind::NodeKind kind() const override {
+    return NodeKind::NON_BLOCKING_ASSIGN;
+  };
+  void emit(Sink &sink) const override { Assign::emit(sink); };
   ~NonBlockingAssign(){};
 };
 
-class Star : Node {
+class Star : public Node {
  public:
-  std::string toString() { return "*"; };
+  NodeKind::NodeKind kind() const override { return NodeKind::STAR; };
+  void emit(Sink &sink) const override { sink << '*'; };
   ~Star(){};
 };
 
 class Always : public StructuralStatement {
+ public:
   std::vector<
       std::variant<std::unique_ptr<Identifier>, std::unique_ptr<PosEdge>,
                    std::unique_ptr<NegEdge>, std::unique_ptr<Star>>>
@@ -437,7 +726,6 @@ class Always : public StructuralStatement {
                            std::unique_ptr<Declaration>>>
       body;
 
- public:
   Always(std::vector<
              std::variant<std::unique_ptr<Identifier>, std::unique_ptr<PosEdge>,
                           std::unique_ptr<NegEdge>, std::unique_ptr<Star>>>
@@ -452,77 +740,168 @@ class Always : public StructuralStatement {
     }
     this->sensitivity_list = std::move(sensitivity_list);
   };
-  std::string toString();
+  NodeKind::NodeKind kind() const override { return NodeKind::ALWAYS; };
+  void emit(Sink &sink) const override;
   ~Always(){};
 };
 
 class AbstractModule : public Node {};
 
 class Module : public AbstractModule {
- protected:
+ public:
   std::string name;
   std::vector<std::unique_ptr<AbstractPort>> ports;
   std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                            std::unique_ptr<Declaration>>>
       body;
   Parameters parameters;
-  std::string emitModuleHeader();
-  // Protected initializer that is used by the StringBodyModule subclass which
-  // overrides the `body` field (but reuses the other fields)
+
   Module(std::string name, std::vector<std::unique_ptr<AbstractPort>> ports,
+         std::vector<std::variant<std::unique_ptr<StructuralStatement>,
+                                  std::unique_ptr<Declaration>>>
+             body,
          Parameters parameters)
       : name(name),
         ports(std::move(ports)),
+        body(std::move(body)),
         parameters(std::move(parameters)){};
 
- public:
+  // Keep the emitted text of the module and reuse it as long as the module is
+  // unchanged.  Off by default, as it keeps a copy of the output in memory.
+  //
+  // Reusing the text takes constant time: filling the cache registers the
+  // module as the owner of each of its nodes, and resetting the hash of a
+  // node (`invalidateHash`, which `Assign::setPrefix`, the passes and
+  // Transformers call on the nodes they edit) or destroying it, e.g. when a
+  // statement or connection is replaced, invalidates the cache of its owner.
+  // Renaming the module and adding or removing ports and statements are seen
+  // as well.  Other edits of the fields of a node must be followed by
+  // `invalidateHash` on it, and reordering statements by `invalidateHash` on
+  // the module.
+  bool cache_emission = false;
+
+  NodeKind::NodeKind kind() const override { return NodeKind::MODULE; };
+  void emit(Sink &sink) const override;
+  ~Module();
+
+ protected:
+  void emitModuleHeader(Sink &sink) const;
+  // Emits the module without going through the cache
+  virtual void emitUncached(Sink &sink) const;
+  // Protected initializer that is used by the StringBodyModule subclass which
+  // overrides the `body` field (but reuses the other fields)
   Module(std::string name, std::vector<std::unique_ptr<AbstractPort>> ports,
-         std::vector<std::variant<std::unique_ptr<StructuralStatement>,
-                                  std::unique_ptr<Declaration>>>
-             body,
          Parameters parameters)
       : name(name),
         ports(std::move(ports)),
-        body(std::move(body)),
         parameters(std::move(parameters)){};
 
-  std::string toString();
-  ~Module(){};
+ private:
+  friend struct MemoryUsage;
+
+  // Emits the module, through the cache if `cache_emission` is set
+  void emitCached(Sink &sink) const;
+
+  // Output of the last cached emission, the options of the sink at the time
+  // and the shape of the module it was emitted from, current while
+  // `emission_current` is set on the module and the shape matches
+  struct EmissionCache {
+    std::string text;
+    EmitOptions options;
+    std::string name;
+    size_t num_ports;
+    size_t body_size;
+  };
+  // Number of statements, or length of the body of a StringBodyModule
+  size_t bodySize() const;
+  // Sets `emission_current` on every node of the module and registers the
+  // module as their owner, or undoes it, without recursion
+  void registerEmission() const;
+  void unregisterEmission() const;
+  // Kept out of line, as most modules are not cached
+  mutable std::unique_ptr<EmissionCache> emission_cache;
 };
 
 class StringBodyModule : public Module {
+ public:
   std::string body;
 
- public:
   StringBodyModule(std::string name,
                    std::vector<std::unique_ptr<AbstractPort>> ports,
                    std::string body, Parameters parameters)
       : Module(name, std::move(ports), std::move(parameters)), body(body){};
-  std::string toString();
+  NodeKind::NodeKind kind() const override {
+    return NodeKind::STRING_BODY_MODULE;
+  };
   ~StringBodyModule(){};
+
+ protected:
+  void emitUncached(Sink &sink) const override;
 };
 
 class StringModule : public AbstractModule {
+ public:
   std::string definition;
 
- public:
   StringModule(std::string definition) : definition(definition){};
-  std::string toString() { return definition; };
+  NodeKind::NodeKind kind() const override { return NodeKind::STRING_MODULE; };
+  void emit(Sink &sink) const override { sink << definition; };
   ~StringModule(){};
 };
 
+// Options for `File::writeTo`
+struct WriteOptions {
+  // Size of the reusable output buffer (or of each mapped window when
+  // `use_mmap` is set)
+  size_t buffer_size = 1 << 20;
+  // Write through a memory mapping of the output file instead of write(2)
+  bool use_mmap = false;
+  // If set, modules are emitted concurrently on this pool
+  ThreadPool *pool = nullptr;
+};
+
 class File : public Node {
+ public:
   std::vector<std::unique_ptr<AbstractModule>> modules;
+  // Layout of the emitted file, readable by default
+  EmitOptions emit_options;
 
- public:
   File(std::vector<std::unique_ptr<AbstractModule>> &modules)
       : modules(std::move(modules)){};
-  std::string toString();
+  NodeKind::NodeKind kind() const override { return NodeKind::FILE; };
+  void emit(Sink &sink) const override;
+  // Emits modules concurrently on `pool`, the output is identical to
+  // `emit(sink)`
+  void emit(Sink &sink, ThreadPool &pool) const;
+  using Node::toString;
+  std::string toString(ThreadPool &pool) const;
+  // Sets `Module::cache_emission` of every module of the file.  Direct edits
+  // of the fields of a node of a cached module must be followed by
+  // `invalidateHash` on that node, see there.
+  void cacheEmission(bool enable = true);
+  // Streams the file to `path` (created or truncated) without materializing
+  // the whole output, returns the number of bytes written.  Throws
+  // std::system_error if the file cannot be written.
+  size_t writeTo(const std::string &path,
+                 const WriteOptions &options = WriteOptions()) const;
   ~File(){};
 };
 
+// Deep copy of `node` with the same static type, see Node::clone
+template <typename T>
+std::unique_ptr<T> clone(const T &node) {
+  return std::unique_ptr<T>(static_cast<T *>(node.Node::clone().release()));
+}
+template <typename T>
+std::unique_ptr<T> clone(const T &node, Arena &arena) {
+  return std::unique_ptr<T>(
+      static_cast<T *>(node.Node::clone(arena).release()));
+}
+
 // Helper functions for constructing unique pointers
-std::unique_ptr<Identifier> make_id(std::string name);
+std::unique_ptr<Identifier> make_id(std::string_view name);
+
+std::unique_ptr<Identifier> make_id(Symbol name);
 
 std::unique_ptr<NumericLiteral> make_num(std::string val);
 
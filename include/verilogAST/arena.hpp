@@ -0,0 +1,111 @@
+#pragma once
+#ifndef VERILOGAST_ARENA_H
+#define VERILOGAST_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace verilogAST {
+
+class Node;
+
+// Bump allocator for AST nodes.
+//
+// While an Arena::Scope is active on a thread, every node created on that
+// thread (through `make_*`, `std::make_unique` or `new`) is carved out of the
+// arena instead of the global heap.  Deleting such a node runs its destructor
+// but does not return the memory; all of it is released at once when the
+// arena is destroyed.  The arena must therefore outlive every node allocated
+// from it.  `operator new` hands the address of an arena allocation to the
+// constructor of the node, which records that it lives in an arena, so
+// neither construction nor `delete` looks its address up.
+//
+// Only the nodes themselves come from the arena: the strings and vectors a
+// node owns (literal digits, strings, comments, argument lists, module
+// bodies) are still allocated on the global heap and freed by the destructor
+// of the node, and names are interned in a SymbolTable.
+//
+// An arena is not thread safe, use one arena per constructing thread.
+class Arena {
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+  std::vector<Block> blocks;
+  char *cur = nullptr;
+  char *end = nullptr;
+  size_t block_size;
+  size_t allocated = 0;
+  size_t reserved = 0;
+
+  // Allocates a block of `size` bytes and registers it with the arena
+  char *newBlock(size_t size);
+  void *allocateSlow(size_t size);
+
+ public:
+  explicit Arena(size_t block_size = 1 << 20) : block_size(block_size){};
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  ~Arena();
+
+  // Returns `size` bytes aligned to alignof(std::max_align_t)
+  void *allocate(size_t size) {
+    size = (size + kAlignment - 1) & ~(kAlignment - 1);
+    if (static_cast<size_t>(end - cur) >= size) {
+      void *result = cur;
+      cur += size;
+      allocated += size;
+      return result;
+    }
+    return allocateSlow(size);
+  }
+
+  // Makes sure that the next `size` bytes can be allocated from a single
+  // block, e.g. before building a tree of a known size
+  void reserve(size_t size);
+
+  // Bytes handed out by `allocate`
+  size_t bytesAllocated() const { return allocated; };
+  // Bytes obtained from the system heap
+  size_t bytesReserved() const { return reserved; };
+
+  static constexpr size_t kAlignment = alignof(std::max_align_t);
+
+  // Arena used by the calling thread for new nodes, or nullptr if nodes are
+  // allocated on the heap
+  static Arena *current();
+  // Arena that `ptr` was allocated from, or nullptr if it is not in a block
+  // of a live arena.  Thread safe.
+  static Arena *owner(const void *ptr);
+
+  // Frees the tree rooted at `tree` without running the destructors of the
+  // nodes of this arena that own nothing but their children, e.g. operators
+  // and identifiers, whose memory is reclaimed with the arena.  The other
+  // nodes (literals, containers, modules) and nodes from the heap or another
+  // arena are destroyed as usual.  Does not recurse.
+  //
+  // This is not constant time: every node of the tree is still visited once,
+  // as the nodes that are destroyed (and the heap memory of their strings and
+  // vectors) can only be found by walking the tree, so discarding a File
+  // costs a pass over all of its nodes.  What is saved is the virtual
+  // destructor call and `operator delete` of most of them.
+  void discard(std::unique_ptr<Node> tree);
+
+  // Makes `arena` the current arena of the calling thread for the lifetime of
+  // the scope object.  A scope made with nullptr allocates nodes from the heap
+  // again, e.g. for nodes that may outlive the arena of the caller.
+  class Scope {
+    Arena *previous;
+
+   public:
+    explicit Scope(Arena &arena);
+    explicit Scope(std::nullptr_t);
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+    ~Scope();
+  };
+};
+
+}  // namespace verilogAST
+#endif
@@ -0,0 +1,93 @@
+#pragma once
+#ifndef VERILOGAST_CONNECTIVITY_H
+#define VERILOGAST_CONNECTIVITY_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+// Drivers and loads of the nets of a module, e.g. for fanout, liveness or
+// multiple driver checks.
+//
+// Every name declared or referenced by the module (ports, declarations and
+// identifiers, including the base of an Index or Slice) is a net, numbered
+// from 0 in order of first appearance.  The endpoints of a net are the nodes
+// that drive or read it:
+//   * a Port drives its net if it is an input and reads it if it is an output
+//     (both for an inout), StringPorts are not parsed and are ignored
+//   * a ContinuousAssign, BlockingAssign or NonBlockingAssign drives the net
+//     of its target and reads the names of its value and of the indices of
+//     its target
+//   * an Always reads the names of its sensitivity list
+//   * a ModuleInstantiation drives or reads the names of its connections
+//     depending on the direction of the instantiated port.  Ports are looked
+//     up in the modules of `file`, a connection to a module or port that is
+//     not found (or to an inout) both drives and reads its names.  Parameter
+//     values are read.
+// Each node appears at most once per net and list, in source order.
+//
+// The endpoints are stored in compressed sparse row form (one array of
+// offsets per net and one array of endpoints), built in a single pass over
+// the module, so lookups are O(1) and the graph takes a few words per edge.
+// The graph refers to the nodes of the module, which must outlive it and not
+// be modified while it is in use.
+class Connectivity {
+ public:
+  typedef uint32_t NetId;
+  static constexpr NetId npos = UINT32_MAX;
+
+  // Contiguous range of endpoints
+  class Endpoints {
+    const Node *const *first;
+    const Node *const *last;
+
+   public:
+    Endpoints(const Node *const *first, const Node *const *last)
+        : first(first), last(last){};
+    const Node *const *begin() const { return first; };
+    const Node *const *end() const { return last; };
+    size_t size() const { return last - first; };
+    bool empty() const { return first == last; };
+    const Node *operator[](size_t i) const { return first[i]; };
+  };
+
+  explicit Connectivity(const Module &module, const File *file = nullptr);
+
+  size_t numNets() const { return names.size(); };
+  // Net named `name`, or `npos` if the module does not use the name
+  NetId find(Symbol name) const {
+    auto it = ids.find(name);
+    return it == ids.end() ? npos : it->second;
+  };
+  Symbol name(NetId net) const { return names[net]; };
+
+  Endpoints drivers(NetId net) const {
+    return range(driver_offsets, driver_endpoints, net);
+  };
+  Endpoints loads(NetId net) const {
+    return range(load_offsets, load_endpoints, net);
+  };
+
+ private:
+  std::vector<Symbol> names;
+  std::unordered_map<Symbol, NetId> ids;
+  // The endpoints of net `i` are `endpoints[offsets[i]:offsets[i + 1]]`
+  std::vector<uint32_t> driver_offsets;
+  std::vector<const Node *> driver_endpoints;
+  std::vector<uint32_t> load_offsets;
+  std::vector<const Node *> load_endpoints;
+
+  static Endpoints range(const std::vector<uint32_t> &offsets,
+                         const std::vector<const Node *> &endpoints,
+                         NetId net) {
+    const Node *const *data = endpoints.data();
+    return Endpoints(data + offsets[net], data + offsets[net + 1]);
+  };
+};
+
+}  // namespace verilogAST
+#endif
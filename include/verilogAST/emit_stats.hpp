@@ -0,0 +1,68 @@
+#pragma once
+#ifndef VERILOGAST_EMIT_STATS_H
+#define VERILOGAST_EMIT_STATS_H
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+// Counters collected while emitting, to find out which modules and classes of
+// nodes make the emission of a large file slow.  Collection is opt-in, by
+// pointing the `stats` of a sink at an EmitStats:
+//
+//   EmitStats stats;
+//   StringSink sink;
+//   sink.stats = &stats;
+//   file.emit(sink);
+//   std::cerr << stats.toJson();
+//
+// Modules and files record themselves when they are emitted into the sink
+// (including by `File::emit` with a ThreadPool), other nodes emitted on their
+// own are not recorded.  The nodes of a module are counted in a separate
+// pass after it has been emitted, so the counting is not included in its
+// time.  A sink without stats only pays for a null check per module.
+struct EmitStats {
+  struct ModuleStats {
+    std::string name;
+    // Bytes of the emitted module
+    size_t bytes = 0;
+    // Time spent emitting the module, excluding the time spent counting its
+    // nodes
+    std::chrono::nanoseconds time{0};
+  };
+
+  // Number of nodes emitted by class, indexed by NodeKind
+  std::array<size_t, kNumNodeKinds> nodes{};
+  // Number of emitted identifiers that had to be escaped (see
+  // `Identifier::needsEscape`)
+  size_t escaped_identifiers = 0;
+  // Bytes of the emitted files and modules
+  size_t bytes = 0;
+  // Time spent emitting modules, summed over the modules (so when they are
+  // emitted in parallel it is larger than the elapsed time)
+  std::chrono::nanoseconds time{0};
+  // Emitted modules, in order of emission
+  std::vector<ModuleStats> modules;
+
+  // Called by `Module::emit` after the module has been emitted
+  void record(const Module &module, size_t bytes,
+              std::chrono::nanoseconds time);
+  // Adds the counters of `other`, and appends its modules
+  void merge(const EmitStats &other);
+  void clear() { *this = EmitStats(); };
+
+  // The counters as a JSON object, e.g.
+  //   {"bytes": 120, "time_ns": 5230, "escaped_identifiers": 0,
+  //    "nodes": {"Identifier": 12, "BinaryOp": 3, ...},
+  //    "modules": [{"name": "top", "bytes": 120, "time_ns": 4810}]}
+  // Classes without nodes are left out of "nodes".
+  std::string toJson() const;
+};
+
+}  // namespace verilogAST
+#endif
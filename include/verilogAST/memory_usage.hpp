@@ -0,0 +1,63 @@
+#pragma once
+#ifndef VERILOGAST_MEMORY_USAGE_H
+#define VERILOGAST_MEMORY_USAGE_H
+
+#include <array>
+#include <string>
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+// Bytes of memory owned by the nodes of a tree, by node class, see
+// `Node::memoryUsage`.
+//
+// The names of identifiers and instances are interned in a SymbolTable, which
+// is shared by every tree and not counted (a Symbol is a pointer within its
+// node).  Nor are the edited prefixes of assignments (see
+// `Assign::setPrefix`), which are kept in a process-wide pool: the pool grows
+// with every distinct prefix and is never freed, so code setting many
+// different prefixes (e.g. delays) holds on to all of them.  The bookkeeping
+// of the heap allocator itself is not counted either.  The emission cache of
+// a module (see `Module::cache_emission`) counts towards the bytes of the
+// module, except for the entry registering each of its nodes with the module
+// (a hash map entry per node while the cache is filled).
+struct MemoryUsage {
+  struct Bytes {
+    // Size of the node objects, i.e. sizeof their class
+    size_t objects = 0;
+    // Capacity of the std::strings owned by the nodes that is allocated
+    // outside of the string object (short strings are stored inline)
+    size_t strings = 0;
+    // Capacity of the std::vectors owned by the nodes, e.g. the arguments of
+    // a Concat or the body of a Module
+    size_t containers = 0;
+    // Cost of allocating each node separately, owned through a unique_ptr:
+    // the padding of the allocation to Arena::kAlignment
+    size_t indirection = 0;
+
+    size_t total() const {
+      return objects + strings + containers + indirection;
+    };
+    Bytes &operator+=(const Bytes &other);
+  };
+
+  // Number of nodes and their bytes, indexed by NodeKind
+  std::array<size_t, kNumNodeKinds> nodes{};
+  std::array<Bytes, kNumNodeKinds> bytes{};
+
+  // Adds the memory of `node` itself, not including its children
+  void add(const Node &node);
+  // Sum over the classes
+  Bytes total() const;
+
+  // The bytes as a JSON object, e.g.
+  //   {"total": {"nodes": 3, "objects": 152, "strings": 0,
+  //              "containers": 16, "indirection": 56, "bytes": 224},
+  //    "classes": {"Identifier": {"nodes": 2, ...}, ...}}
+  // Classes without nodes are left out of "classes".
+  std::string toJson() const;
+};
+
+}  // namespace verilogAST
+#endif
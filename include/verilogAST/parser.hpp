@@ -0,0 +1,43 @@
+#pragma once
+#ifndef VERILOGAST_PARSER_H
+#define VERILOGAST_PARSER_H
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+// Options for `parse` and `parse_file`
+struct ParseOptions {
+  // If set, modules are parsed concurrently on this pool.  Nodes created by
+  // the workers are allocated on the heap rather than from an Arena.
+  ThreadPool *pool = nullptr;
+};
+
+// Parses Verilog source back into nodes.
+//
+// Supports the subset of Verilog that the library emits: module definitions
+// with parameters and ANSI style ports, `wire`/`reg` declarations, continuous
+// assignments, `always` blocks with blocking and non-blocking assignments and
+// module instantiations with named connections.  Expressions are limited to
+// the operators of BinOp and UnOp, the ternary operator, indexing, slicing
+// and concatenation; parentheses only group.  Comments are skipped.
+//
+// Names are interned in the current SymbolTable (of the calling thread, also
+// for the workers of `options.pool`).  Escaped names that are stored as plain
+// strings (module, instance and port names) keep their backslash and
+// terminating space so that they are emitted unchanged.
+//
+// The lexer works on `source` in place and expressions are parsed without
+// recursion, so the nesting depth of the input is not limited by the call
+// stack.  Throws std::runtime_error with the line number on invalid or
+// unsupported input.
+std::unique_ptr<File> parse(std::string_view source,
+                            const ParseOptions &options = ParseOptions());
+
+// Parses the file at `path`, which is memory mapped rather than read into a
+// buffer.  Throws std::system_error if the file cannot be read.
+std::unique_ptr<File> parse_file(const std::string &path,
+                                 const ParseOptions &options = ParseOptions());
+
+}  // namespace verilogAST
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+#ifndef VERILOGAST_PASSES_H
+#define VERILOGAST_PASSES_H
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+// Constant folding and algebraic simplification.
+//
+// Folds operators whose operands are all NumericLiterals into a single
+// literal, following the Verilog sizing rules: the result has the width and
+// signedness of the operation and the radix of the left operand (e.g.
+// `8'd3 + 4'd4` becomes `8'd7`).  An operation is only folded if its exact
+// result fits that width, and operands must be free of x/z digits and
+// non-negative (negative signed values change meaning when an enclosing
+// expression is unsigned), so the folded literal means the same in any
+// context.
+//
+// In addition
+//   * `x + 0`, `x - 0`, `x * 1`, `x / 1`, `x ** 1` and shifts by zero become
+//     `x`, and a ternary with a constant condition becomes the selected
+//     value.  Except for shifts and powers, these are only applied if `x` is
+//     known to be at least as wide as the literal (or the other value) and
+//     keeps the signedness of the operation.  Nets declared in the module
+//     are unsigned and as wide as their declared range (e.g. `x + 8'd0`
+//     becomes `x` for `wire [7:0] x`), other identifiers and lone
+//     expressions are of unknown width and left alone.
+//   * `0 && x` and `1 || x` become `1'b0` and `1'b1`
+//   * slices with equal constant bounds (`x[3:3]`) become indices (`x[3]`)
+void fold_constants(Module &module);
+void fold_constants(File &file);
+// Returns the folded replacement for `expr`
+std::unique_ptr<Expression> fold_constants(std::unique_ptr<Expression> expr);
+
+// Common subexpression elimination.
+//
+// Finds expressions (operators, concatenations and slices) that occur more
+// than once on the right-hand sides of the continuous assignments of a
+// module, assigns each of them to a new wire and replaces the occurrences
+// with the name of the wire.  The wire and its assignment are inserted just
+// before the first statement using the expression.
+//
+// The declared width of the wire is the self-determined width of the
+// expression, so only expressions whose width is known (i.e. all of the nets
+// they use are declared with constant widths) and whose value does not depend
+// on the width of their context (e.g. `a + b` assigned to a wider target) are
+// hoisted.  Signed expressions are left alone.
+void eliminate_common_subexpressions(Module &module);
+void eliminate_common_subexpressions(File &file);
+
+// Module deduplication.
+//
+// Removes every module (or module with a string body) that is structurally
+// identical to an earlier module of `file` apart from its name, see
+// Node::structurallyEqual, and points the instantiations of the removed
+// modules at the module that is kept.  Repeats until no module is removed,
+// as renaming the instantiations of a module can make it identical to
+// another.  The text of StringBodyModules and StringModules is not parsed, so
+// a module whose name occurs anywhere in it is kept.  Returns the number of
+// modules removed.
+size_t deduplicate_modules(File &file);
+
+// Dead code elimination.
+//
+// Removes the wire and reg declarations and continuous assignments of a
+// module whose values cannot reach an output (or inout) port.  Liveness is
+// computed backward from the outputs and from everything read or driven by
+// module instantiations and always blocks, which are kept: the connections
+// of an instance are all treated as inputs of the instance, as the
+// directions of its ports are not known.  Names used in the dimensions of a
+// declaration are live, and names in the text of a StringPort are treated as
+// outputs.  Returns the number of statements removed.
+size_t eliminate_dead_code(Module &module);
+size_t eliminate_dead_code(File &file);
+
+// Single use wire inlining.
+//
+// Substitutes the value of each wire that is assigned by exactly one
+// continuous assignment (of the whole wire) and read by exactly one other
+// continuous assignment, in exactly one place, into that reader, and removes
+// the wire's declaration and assignment.  Wires connected to ports,
+// instances or always blocks (driven or read) are left alone, as are names
+// that occur in the text of a StringPort.  A chain of single use wires
+// collapses into the last reader.
+//
+// Like `eliminate_common_subexpressions` in reverse, a value is only
+// substituted if it evaluates the same in the reader as through the wire:
+// the wire and the value must have the same known width, the value must be
+// unsigned, and it must not be evaluated in a wider context than the wire
+// unless it is zero extended there (e.g. `a + b` is not substituted into
+// `c + t` if `c` is wider than `t`, as it would keep its carry).  A value is
+// also not substituted if the reader's right-hand side would grow beyond
+// `max_nodes` nodes.  Returns the number of wires removed.
+size_t inline_wires(Module &module, size_t max_nodes = 32);
+size_t inline_wires(File &file, size_t max_nodes = 32);
+
+}  // namespace verilogAST
+#endif
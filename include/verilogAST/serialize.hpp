@@ -0,0 +1,40 @@
+#pragma once
+#ifndef VERILOGAST_SERIALIZE_H
+#define VERILOGAST_SERIALIZE_H
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+// Binary serialization of trees, used to cache large designs across runs.
+//
+// The format consists of
+//   * a header: the magic "vASTbin" and a zero byte, then the version as a
+//     32 bit little endian integer
+//   * one record per node in post-order (children before their parents),
+//     made of the NodeKind as a byte followed by the fields of the node as
+//     LEB128 integers.  Strings are referred to by their index in the string
+//     table and children are implied by the order of the records.  The
+//     record of a File includes its emit options.
+//   * the string table: the number of strings, then the length and bytes of
+//     each distinct string
+//   * a trailer: the offset of the string table and the number of records as
+//     64 bit little endian integers
+// The string table follows the records, so that a tree is written in a
+// single sequential pass, and is read first when loading.
+void serialize(const Node &root, Sink &sink);
+// Writes `root` to `path` (created or truncated), returns the number of
+// bytes written.  Throws std::system_error if the file cannot be written.
+size_t save_binary(const Node &root, const std::string &path);
+
+// Rebuilds the tree written by `serialize`, in one pass over the records.
+// Names are interned in the current SymbolTable once per distinct name and
+// nodes are allocated from the current Arena, if any.  Throws
+// std::runtime_error if `data` is not a valid serialized tree.
+std::unique_ptr<Node> deserialize(std::string_view data);
+// Memory maps the file at `path` and deserializes it.  Throws
+// std::system_error if the file cannot be read.
+std::unique_ptr<Node> load_binary(const std::string &path);
+
+}  // namespace verilogAST
+#endif
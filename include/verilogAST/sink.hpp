@@ -0,0 +1,147 @@
+#pragma once
+#ifndef VERILOGAST_SINK_H
+#define VERILOGAST_SINK_H
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace verilogAST {
+
+struct EmitStats;
+
+// Layout of the text written by `Node::emit`
+struct EmitOptions {
+  // Leave out the whitespace that is not needed to separate tokens, and the
+  // blank lines between modules.  Statements still end with a newline.
+  bool compact = false;
+
+  bool operator==(const EmitOptions &other) const {
+    return compact == other.compact;
+  }
+  bool operator!=(const EmitOptions &other) const { return !(*this == other); }
+};
+
+// Output target for `Node::emit`.
+//
+// Every sink owns a window of memory [begin, end) that emission appends into
+// directly, so the common case of writing a short token is a bounds check and
+// a memcpy.  When the window is full the subclass' `overflow` is invoked to
+// either grow the window (StringSink) or drain it to its destination
+// (OStreamSink, FdSink).
+class Sink {
+ protected:
+  char *begin = nullptr;
+  char *cur = nullptr;
+  char *end = nullptr;
+  // Number of bytes that have already been drained out of the window
+  size_t drained = 0;
+
+  // Called when `size` bytes starting at `data` do not fit in the remaining
+  // window.  Implementations must consume all of `data`.
+  virtual void overflow(const char *data, size_t size) = 0;
+
+ public:
+  Sink() = default;
+  Sink(const Sink &) = delete;
+  Sink &operator=(const Sink &) = delete;
+  virtual ~Sink() = default;
+
+  void write(const char *data, size_t size) {
+    if (static_cast<size_t>(end - cur) >= size) {
+      std::memcpy(cur, data, size);
+      cur += size;
+    } else {
+      overflow(data, size);
+    }
+  }
+  void write(std::string_view str) { write(str.data(), str.size()); }
+  void put(char c) {
+    if (cur != end) {
+      *cur++ = c;
+    } else {
+      overflow(&c, 1);
+    }
+  }
+
+  Sink &operator<<(std::string_view str) {
+    write(str);
+    return *this;
+  }
+  Sink &operator<<(char c) {
+    put(c);
+    return *this;
+  }
+
+  // Writes any buffered bytes through to the destination
+  virtual void flush(){};
+
+  // Total number of bytes written to this sink so far
+  size_t bytesWritten() const { return drained + (cur - begin); }
+
+  // Layout of the nodes emitted into this sink, `File::emit` sets it to the
+  // file's `emit_options` while emitting the file
+  EmitOptions options;
+
+  // Counters updated while emitting into this sink if not null, see
+  // emit_stats.hpp
+  EmitStats *stats = nullptr;
+
+  // Nesting of the expressions currently being emitted into this sink, used
+  // to bound the recursion of `Node::emit` on deep expression trees
+  unsigned expression_depth = 0;
+};
+
+// Growable in-memory buffer, used to implement `Node::toString`
+class StringSink : public Sink {
+  std::string buffer;
+
+ protected:
+  void overflow(const char *data, size_t size) override;
+
+ public:
+  explicit StringSink(size_t initial_capacity = 256);
+
+  // Contents written so far
+  std::string_view view() const { return std::string_view(begin, cur - begin); }
+
+  // Moves the contents out of the sink, leaving it empty
+  std::string release();
+};
+
+// Buffers writes and forwards them to a std::ostream
+class OStreamSink : public Sink {
+  std::ostream &os;
+  std::string buffer;
+
+ protected:
+  void overflow(const char *data, size_t size) override;
+
+ public:
+  explicit OStreamSink(std::ostream &os, size_t buffer_size = 1 << 16);
+  ~OStreamSink();
+  void flush() override;
+};
+
+// Buffers writes and forwards them to a POSIX file descriptor.  The
+// descriptor is not closed by the sink.
+class FdSink : public Sink {
+  int fd;
+  std::string buffer;
+
+ protected:
+  void overflow(const char *data, size_t size) override;
+
+ public:
+  explicit FdSink(int fd, size_t buffer_size = 1 << 16);
+  // Flushes remaining data, errors are ignored (call `flush` explicitly to
+  // observe them)
+  ~FdSink();
+  // Throws std::runtime_error if the underlying write fails
+  void flush() override;
+};
+
+}  // namespace verilogAST
+#endif
@@ -0,0 +1,128 @@
+#pragma once
+#ifndef VERILOGAST_SYMBOL_H
+#define VERILOGAST_SYMBOL_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace verilogAST {
+
+class SymbolTable;
+
+namespace detail {
+struct SymbolEntry {
+  std::string name;
+  const SymbolTable *table;
+  // Dense index of this entry within `table`
+  uint32_t id;
+  bool needs_escape;
+  size_t hash;
+};
+}  // namespace detail
+
+// Handle to a name interned in a SymbolTable.
+//
+// Symbols are the size of a pointer and are cheap to copy.  Two symbols from
+// the same table are equal iff they are the same entry, so comparing them is a
+// single pointer compare; symbols from different tables fall back to comparing
+// their names.
+class Symbol {
+  const detail::SymbolEntry *entry;
+
+ public:
+  explicit Symbol(const detail::SymbolEntry *entry) : entry(entry){};
+
+  const std::string &str() const { return entry->name; };
+  // Dense index of this symbol in its table, usable to index side arrays
+  uint32_t id() const { return entry->id; };
+  const SymbolTable &table() const { return *entry->table; };
+  // Cached result of `Identifier::needsEscape(str())`
+  bool needsEscape() const { return entry->needs_escape; };
+  size_t hash() const { return entry->hash; };
+
+  bool operator==(const Symbol &other) const {
+    return entry == other.entry ||
+           (entry->table != other.entry->table && entry->name == other.str());
+  };
+  bool operator!=(const Symbol &other) const { return !(*this == other); };
+  bool operator==(std::string_view name) const { return entry->name == name; };
+  bool operator!=(std::string_view name) const { return entry->name != name; };
+};
+
+// Interns names so that each distinct name is stored once.
+//
+// Interning is thread safe.  The names are split into shards by hash, each
+// with its own lock, so that threads interning different names rarely wait
+// for each other.  A table must outlive every Symbol (and therefore every
+// node) created from it.
+class SymbolTable {
+  // On separate cache lines so that the locks of the shards do not contend
+  struct alignas(64) Shard {
+    std::deque<detail::SymbolEntry> entries;
+    std::unordered_map<std::string_view, const detail::SymbolEntry *> index;
+    std::mutex mutex;
+  };
+  static constexpr size_t kNumShards = 16;
+  std::array<Shard, kNumShards> shards;
+  // Number of entries over all shards, the next id to hand out
+  std::atomic<uint32_t> num_entries{0};
+
+ public:
+  SymbolTable() = default;
+  SymbolTable(const SymbolTable &) = delete;
+  SymbolTable &operator=(const SymbolTable &) = delete;
+
+  Symbol intern(std::string_view name);
+  // Number of distinct names in the table
+  size_t size() const;
+  // Forgets every name of the table, which then hands out ids from 0 again.
+  // Every Symbol of the table (and every node using one) must be gone, and no
+  // other thread may intern into the table meanwhile.
+  void clear();
+
+  // Process-wide table used when no other table is in scope.  It is never
+  // destroyed, so its names are kept until the process exits: programs that
+  // build many unrelated trees should intern them into a table of their own
+  // through a Scope, or `clear` the global table once the trees are gone.
+  static SymbolTable &global();
+  // Table used by the calling thread to intern names passed to node
+  // constructors and `make_id`
+  static SymbolTable &current();
+
+  // Makes `table` the current table of the calling thread for the lifetime of
+  // the scope object, e.g.
+  //
+  //   SymbolTable symbols;
+  //   {
+  //     SymbolTable::Scope scope(symbols);
+  //     auto id = make_id("clk");  // interned in `symbols`
+  //   }
+  class Scope {
+    SymbolTable *previous;
+
+   public:
+    explicit Scope(SymbolTable &table);
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+    ~Scope();
+  };
+};
+
+}  // namespace verilogAST
+
+namespace std {
+template <>
+struct hash<verilogAST::Symbol> {
+  size_t operator()(const verilogAST::Symbol &symbol) const {
+    return symbol.hash();
+  }
+};
+}  // namespace std
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+#ifndef VERILOGAST_THREAD_POOL_H
+#define VERILOGAST_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace verilogAST {
+
+// Fixed set of worker threads for data parallel loops over the AST (e.g.
+// emitting the modules of a File concurrently).  The pool is reusable across
+// calls; only one `parallelFor` may run at a time.
+class ThreadPool {
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+  std::condition_variable work_ready;
+  std::condition_variable work_done;
+  // Incremented for every `parallelFor`, wakes up the workers
+  size_t generation = 0;
+  size_t active_workers = 0;
+  bool stopping = false;
+
+  // Current loop
+  const std::function<void(size_t)> *body = nullptr;
+  size_t count = 0;
+  std::atomic<size_t> next{0};
+  std::exception_ptr error;
+
+  void workerLoop();
+  void runIterations();
+
+ public:
+  // `num_threads` includes the calling thread, so a pool of size 1 runs
+  // everything inline.  Defaults to the number of hardware threads.
+  explicit ThreadPool(unsigned num_threads = 0);
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  unsigned size() const { return workers.size() + 1; };
+
+  // Calls `fn(i)` for every i in [0, n) and waits for all calls to finish.
+  // If any call throws, the first exception is rethrown here.
+  void parallelFor(size_t n, const std::function<void(size_t)> &fn);
+};
+
+}  // namespace verilogAST
+#endif
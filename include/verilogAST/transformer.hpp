@@ -0,0 +1,66 @@
+#pragma once
+#ifndef VERILOGAST_TRANSFORMER_H
+#define VERILOGAST_TRANSFORMER_H
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+// Read-only traversal of a tree, see `walk`.
+//
+// Dispatch on the class of a node with `node.kind()`, e.g.
+//
+//   bool enter(const Node &node) override {
+//     if (node.kind() == NodeKind::IDENTIFIER) {
+//       names.insert(static_cast<const Identifier &>(node).value);
+//     }
+//     return true;
+//   }
+class Visitor {
+ public:
+  virtual ~Visitor() = default;
+  // Called before the children of `node` are walked, returning false skips
+  // the children (and the matching `leave`)
+  virtual bool enter(const Node &) { return true; };
+  // Called after all the children of `node` have been walked
+  virtual void leave(const Node &){};
+};
+
+// Walks the tree rooted at `root` depth first, visiting children in source
+// order.  Uses an explicit work stack, so the depth of the tree is not limited
+// by the call stack.
+void walk(const Node &root, Visitor &visitor);
+
+// In-place rewriting of a tree.
+//
+// Like `walk`, the traversal uses an explicit work stack.  Every expression is
+// passed to `transform` after its children have been transformed, and the
+// returned expression takes its place in the parent.  Statements, ports,
+// modules and other non-expression nodes can be edited in place from `enter`
+// (before their children are visited) or `leave` (after).
+class Transformer {
+ public:
+  virtual ~Transformer() = default;
+
+  // Called before the children of `node` are transformed, returning false
+  // leaves the whole subtree (including `node` itself) untouched
+  virtual bool enter(Node &) { return true; };
+  // Called after the children of a non-expression node have been transformed
+  virtual void leave(Node &){};
+  // Returns the replacement for `node`.  The replacement must fit the field
+  // that holds `node` (e.g. an Identifier for `Index::id`), otherwise
+  // std::runtime_error is thrown.
+  virtual std::unique_ptr<Expression> transform(
+      std::unique_ptr<Expression> node) {
+    return node;
+  };
+
+  // Transforms every node below `root`.  `root` itself is not replaced, even
+  // if it is an expression.
+  void run(Node &root);
+  // Transforms the expression tree `root` and returns its replacement
+  std::unique_ptr<Expression> run(std::unique_ptr<Expression> root);
+};
+
+}  // namespace verilogAST
+#endif
@@ -0,0 +1,205 @@
+#include "verilogAST/arena.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <vector>
+
+#include "children.hpp"
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+static thread_local Arena *current_arena = nullptr;
+// Whether the node being deleted on this thread lives in an arena, recorded
+// by `~Node` (or by `operator new`, in case the construction throws) for
+// `operator delete`, which runs right after it
+static thread_local bool deleting_from_arena = false;
+// Arena allocations of this thread whose node is not constructed yet, most
+// recent last.  `new T(args)` allocates before evaluating `args`, which may
+// create nodes of their own, so nodes are constructed in the reverse order of
+// their allocation and a node in the arena finds its address at the back.
+static thread_local std::vector<const void *> pending_arena_nodes;
+
+namespace {
+
+struct RegisteredBlock {
+  const char *end;
+  Arena *arena;
+};
+
+// Blocks of all live arenas, by start address, so that `delete` can tell
+// arena nodes from heap nodes
+std::shared_mutex registry_mutex;
+std::map<const char *, RegisteredBlock> registry;
+// Number of entries in `registry`, read without the lock
+std::atomic<size_t> registry_size{0};
+
+// True if nodes of `kind` own no memory apart from their children, so that
+// their destructor has nothing left to do once the children are released
+bool trivial_teardown(NodeKind::NodeKind kind) {
+  switch (kind) {
+    case NodeKind::IDENTIFIER:
+    case NodeKind::INDEX:
+    case NodeKind::SLICE:
+    case NodeKind::BINARY_OP:
+    case NodeKind::UNARY_OP:
+    case NodeKind::TERNARY_OP:
+    case NodeKind::NEG_EDGE:
+    case NodeKind::POS_EDGE:
+    case NodeKind::VECTOR:
+    case NodeKind::PORT:
+    case NodeKind::WIRE:
+    case NodeKind::REG:
+    case NodeKind::CONTINUOUS_ASSIGN:
+    case NodeKind::BLOCKING_ASSIGN:
+    case NodeKind::NON_BLOCKING_ASSIGN:
+    case NodeKind::STAR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+Arena::~Arena() {
+  if (blocks.empty()) return;
+  std::unique_lock lock(registry_mutex);
+  for (auto &block : blocks) registry.erase(block.data.get());
+  registry_size.store(registry.size(), std::memory_order_relaxed);
+}
+
+char *Arena::newBlock(size_t size) {
+  blocks.push_back({std::unique_ptr<char[]>(new char[size]), size});
+  reserved += size;
+  char *block = blocks.back().data.get();
+  std::unique_lock lock(registry_mutex);
+  registry.emplace(block, RegisteredBlock{block + size, this});
+  registry_size.store(registry.size(), std::memory_order_relaxed);
+  return block;
+}
+
+void *Arena::allocateSlow(size_t size) {
+  // Oversized requests get a dedicated block so the remainder of the current
+  // block is not wasted
+  size_t new_block_size = std::max(size, block_size);
+  char *block = newBlock(new_block_size);
+  if (size < block_size) {
+    cur = block + size;
+    end = block + new_block_size;
+  }
+  allocated += size;
+  return block;
+}
+
+void Arena::reserve(size_t size) {
+  if (static_cast<size_t>(end - cur) >= size) return;
+  size_t new_block_size = std::max(size, block_size);
+  cur = newBlock(new_block_size);
+  end = cur + new_block_size;
+}
+
+Arena *Arena::current() { return current_arena; }
+
+// Looks `ptr` up in the registry, with `registry_mutex` held
+static Arena *find_owner(const void *ptr) {
+  auto address = static_cast<const char *>(ptr);
+  auto it = registry.upper_bound(address);
+  if (it == registry.begin()) return nullptr;
+  --it;
+  return address < it->second.end ? it->second.arena : nullptr;
+}
+
+Arena *Arena::owner(const void *ptr) {
+  if (registry_size.load(std::memory_order_relaxed) == 0) return nullptr;
+  std::shared_lock lock(registry_mutex);
+  return find_owner(ptr);
+}
+
+void Arena::discard(std::unique_ptr<Node> tree) {
+  std::vector<Node *> stack;
+  // Nodes to destroy once the lock is released, as their destructors may
+  // delete other nodes
+  std::vector<Node *> foreign;
+  std::vector<Node *> destroy;
+  stack.push_back(tree.release());
+  {
+    std::shared_lock lock(registry_mutex);
+    while (!stack.empty()) {
+      Node *node = stack.back();
+      stack.pop_back();
+      if (!node) continue;
+      if (find_owner(node) != this) {
+        foreign.push_back(node);
+        continue;
+      }
+      // Nodes that are not destroyed still leave the emission cache of their
+      // Module
+      if (node->emission_current) node->releaseEmission();
+      NodeKind::NodeKind kind = node->kind();
+      detail::for_each_child(*node, kind, [&](auto &slot) {
+        stack.push_back(detail::release_slot(slot));
+      });
+      if (!trivial_teardown(kind)) destroy.push_back(node);
+    }
+  }
+  // The memory itself is released with the arena
+  for (Node *node : destroy) node->~Node();
+  for (Node *node : foreign) delete node;
+}
+
+Arena::Scope::Scope(Arena &arena) : previous(current_arena) {
+  current_arena = &arena;
+}
+
+Arena::Scope::Scope(std::nullptr_t) : previous(current_arena) {
+  current_arena = nullptr;
+}
+
+Arena::Scope::~Scope() { current_arena = previous; }
+
+// Returns true, once, if `node` is the pending arena allocation of the thread
+static bool take_pending_arena_node(const void *node) {
+  if (pending_arena_nodes.empty() || pending_arena_nodes.back() != node) {
+    return false;
+  }
+  pending_arena_nodes.pop_back();
+  return true;
+}
+
+Node::Node()
+    : hash_memo(0),
+      in_arena(take_pending_arena_node(this)),
+      emission_current(0) {}
+
+Node::Node(const Node &other)
+    : hash_memo(other.hash_memo),
+      in_arena(take_pending_arena_node(this)),
+      emission_current(0) {}
+
+Node::~Node() {
+  if (emission_current) releaseEmission();
+  deleting_from_arena = in_arena;
+}
+
+void *Node::operator new(size_t size) {
+  Arena *arena = current_arena;
+  deleting_from_arena = arena != nullptr;
+  if (!arena) return ::operator new(size);
+  void *ptr = arena->allocate(size);
+  pending_arena_nodes.push_back(ptr);
+  return ptr;
+}
+
+void Node::operator delete(void *ptr) {
+  // The allocation is still pending if evaluating the constructor arguments
+  // threw
+  if (take_pending_arena_node(ptr)) return;
+  if (!deleting_from_arena) ::operator delete(ptr);
+}
+
+}  // namespace verilogAST
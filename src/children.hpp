@@ -0,0 +1,225 @@
+// Internal helpers for enumerating the children of a node.  Every field of a
+// node that owns another node is a "slot": either a `std::unique_ptr<T>` or a
+// `std::variant` of unique_ptrs.
+#pragma once
+#ifndef VERILOGAST_CHILDREN_H
+#define VERILOGAST_CHILDREN_H
+
+#include <type_traits>
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+namespace detail {
+
+template <typename T>
+Node *slot_node(std::unique_ptr<T> &slot) {
+  return slot.get();
+}
+
+template <typename... Ts>
+Node *slot_node(std::variant<std::unique_ptr<Ts>...> &slot) {
+  return std::visit([](auto &ptr) -> Node * { return ptr.get(); }, slot);
+}
+
+// Releases ownership of the node in `slot`, leaving it empty
+template <typename T>
+Node *release_slot(std::unique_ptr<T> &slot) {
+  return slot.release();
+}
+
+template <typename... Ts>
+Node *release_slot(std::variant<std::unique_ptr<Ts>...> &slot) {
+  return std::visit([](auto &ptr) -> Node * { return ptr.release(); }, slot);
+}
+
+// True if a node of class `kind` can be held by a `std::unique_ptr<T>`
+template <typename T>
+bool is_a(NodeKind::NodeKind kind) {
+  if constexpr (std::is_same_v<T, Node>) {
+    return true;
+  } else if constexpr (std::is_same_v<T, Expression>) {
+    return is_expression(kind);
+  } else if constexpr (std::is_same_v<T, AbstractPort>) {
+    return kind == NodeKind::PORT || kind == NodeKind::STRING_PORT;
+  } else if constexpr (std::is_same_v<T, StructuralStatement>) {
+    return kind == NodeKind::MODULE_INSTANTIATION ||
+           kind == NodeKind::CONTINUOUS_ASSIGN || kind == NodeKind::ALWAYS;
+  } else if constexpr (std::is_same_v<T, BehavioralStatement>) {
+    return kind == NodeKind::BLOCKING_ASSIGN ||
+           kind == NodeKind::NON_BLOCKING_ASSIGN;
+  } else if constexpr (std::is_same_v<T, Declaration>) {
+    return kind == NodeKind::WIRE || kind == NodeKind::REG;
+  } else if constexpr (std::is_same_v<T, AbstractModule>) {
+    return kind == NodeKind::MODULE || kind == NodeKind::STRING_BODY_MODULE ||
+           kind == NodeKind::STRING_MODULE;
+  } else if constexpr (std::is_same_v<T, Identifier>) {
+    return kind == NodeKind::IDENTIFIER;
+  } else if constexpr (std::is_same_v<T, Index>) {
+    return kind == NodeKind::INDEX;
+  } else if constexpr (std::is_same_v<T, Slice>) {
+    return kind == NodeKind::SLICE;
+  } else if constexpr (std::is_same_v<T, Concat>) {
+    return kind == NodeKind::CONCAT;
+  } else if constexpr (std::is_same_v<T, Vector>) {
+    return kind == NodeKind::VECTOR;
+  } else if constexpr (std::is_same_v<T, PosEdge>) {
+    return kind == NodeKind::POS_EDGE;
+  } else if constexpr (std::is_same_v<T, NegEdge>) {
+    return kind == NodeKind::NEG_EDGE;
+  } else {
+    static_assert(std::is_same_v<T, Star>, "unexpected child class");
+    return kind == NodeKind::STAR;
+  }
+}
+
+// Moves `node` into `slot` if its class fits the slot, returns false
+// otherwise.  An empty node fits any slot and is stored as the first
+// alternative of a variant.
+template <typename T>
+bool set_slot(std::unique_ptr<T> &slot, std::unique_ptr<Node> &node) {
+  if (node && !is_a<T>(node->kind())) return false;
+  slot.reset(static_cast<T *>(node.release()));
+  return true;
+}
+
+template <typename... Ts>
+bool set_slot(std::variant<std::unique_ptr<Ts>...> &slot,
+              std::unique_ptr<Node> &node) {
+  if (!node) {
+    slot = {};
+    return true;
+  }
+  return ((is_a<Ts>(node->kind())
+               ? (slot = std::unique_ptr<Ts>(static_cast<Ts *>(node.release())),
+                  true)
+               : false) ||
+          ...);
+}
+
+// Calls `f(slot)` for every child slot of `node`, whose class is `kind`, in
+// source order
+template <typename F>
+void for_each_child(Node &node, NodeKind::NodeKind kind, F &&f) {
+  switch (kind) {
+    case NodeKind::NUMERIC_LITERAL:
+    case NodeKind::IDENTIFIER:
+    case NodeKind::STRING:
+    case NodeKind::STRING_PORT:
+    case NodeKind::SINGLE_LINE_COMMENT:
+    case NodeKind::BLOCK_COMMENT:
+    case NodeKind::STAR:
+    case NodeKind::STRING_MODULE:
+      break;
+    case NodeKind::INDEX: {
+      auto &index = static_cast<Index &>(node);
+      f(index.id);
+      f(index.index);
+      break;
+    }
+    case NodeKind::SLICE: {
+      auto &slice = static_cast<Slice &>(node);
+      f(slice.id);
+      f(slice.high_index);
+      f(slice.low_index);
+      break;
+    }
+    case NodeKind::BINARY_OP: {
+      auto &binary_op = static_cast<BinaryOp &>(node);
+      f(binary_op.left);
+      f(binary_op.right);
+      break;
+    }
+    case NodeKind::UNARY_OP:
+      f(static_cast<UnaryOp &>(node).operand);
+      break;
+    case NodeKind::TERNARY_OP: {
+      auto &ternary_op = static_cast<TernaryOp &>(node);
+      f(ternary_op.cond);
+      f(ternary_op.true_value);
+      f(ternary_op.false_value);
+      break;
+    }
+    case NodeKind::CONCAT:
+      for (auto &arg : static_cast<Concat &>(node).args) f(arg);
+      break;
+    case NodeKind::NEG_EDGE:
+      f(static_cast<NegEdge &>(node).value);
+      break;
+    case NodeKind::POS_EDGE:
+      f(static_cast<PosEdge &>(node).value);
+      break;
+    case NodeKind::VECTOR: {
+      auto &vector = static_cast<Vector &>(node);
+      f(vector.id);
+      f(vector.msb);
+      f(vector.lsb);
+      break;
+    }
+    case NodeKind::PORT:
+      f(static_cast<Port &>(node).value);
+      break;
+    case NodeKind::MODULE_INSTANTIATION: {
+      auto &inst = static_cast<ModuleInstantiation &>(node);
+      for (auto &param : inst.parameters) {
+        f(param.first);
+        f(param.second);
+      }
+      for (auto &conn : inst.connections) f(conn.second);
+      break;
+    }
+    case NodeKind::WIRE:
+    case NodeKind::REG:
+      f(static_cast<Declaration &>(node).value);
+      break;
+    case NodeKind::CONTINUOUS_ASSIGN: {
+      auto &assign = static_cast<ContinuousAssign &>(node);
+      f(assign.target);
+      f(assign.value);
+      break;
+    }
+    case NodeKind::BLOCKING_ASSIGN: {
+      auto &assign = static_cast<BlockingAssign &>(node);
+      f(assign.target);
+      f(assign.value);
+      break;
+    }
+    case NodeKind::NON_BLOCKING_ASSIGN: {
+      auto &assign = static_cast<NonBlockingAssign &>(node);
+      f(assign.target);
+      f(assign.value);
+      break;
+    }
+    case NodeKind::ALWAYS: {
+      auto &always = static_cast<Always &>(node);
+      for (auto &item : always.sensitivity_list) f(item);
+      for (auto &statement : always.body) f(statement);
+      break;
+    }
+    case NodeKind::MODULE:
+    case NodeKind::STRING_BODY_MODULE: {
+      // StringBodyModule leaves Module::body empty
+      auto &module = static_cast<Module &>(node);
+      for (auto &param : module.parameters) {
+        f(param.first);
+        f(param.second);
+      }
+      for (auto &port : module.ports) f(port);
+      for (auto &statement : module.body) f(statement);
+      break;
+    }
+    case NodeKind::FILE:
+      for (auto &module : static_cast<File &>(node).modules) f(module);
+      break;
+  }
+}
+
+// Calls `f(slot)` for every child slot of `node`, in source order
+template <typename F>
+void for_each_child(Node &node, F &&f) {
+  for_each_child(node, node.kind(), f);
+}
+
+}  // namespace detail
+}  // namespace verilogAST
+#endif
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "children.hpp"
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+// Copy of `node` with the same fields and the same number of child slots,
+// all of them empty
+std::unique_ptr<Node> shallow_copy(const Node &node) {
+  switch (node.kind()) {
+    // Leaves are copied as is, including their memoized hash
+    case NodeKind::NUMERIC_LITERAL:
+      return std::make_unique<NumericLiteral>(
+          static_cast<const NumericLiteral &>(node));
+    case NodeKind::IDENTIFIER:
+      return std::make_unique<Identifier>(
+          static_cast<const Identifier &>(node));
+    case NodeKind::STRING:
+      return std::make_unique<String>(static_cast<const String &>(node));
+    case NodeKind::STRING_PORT:
+      return std::make_unique<StringPort>(
+          static_cast<const StringPort &>(node));
+    case NodeKind::SINGLE_LINE_COMMENT:
+      return std::make_unique<SingleLineComment>(
+          static_cast<const SingleLineComment &>(node));
+    case NodeKind::BLOCK_COMMENT:
+      return std::make_unique<BlockComment>(
+          static_cast<const BlockComment &>(node));
+    case NodeKind::STAR:
+      return std::make_unique<Star>();
+    case NodeKind::STRING_MODULE:
+      return std::make_unique<StringModule>(
+          static_cast<const StringModule &>(node));
+    case NodeKind::INDEX:
+      return std::make_unique<Index>(nullptr, nullptr);
+    case NodeKind::SLICE:
+      return std::make_unique<Slice>(nullptr, nullptr, nullptr);
+    case NodeKind::BINARY_OP:
+      return std::make_unique<BinaryOp>(
+          nullptr, static_cast<const BinaryOp &>(node).op, nullptr);
+    case NodeKind::UNARY_OP:
+      return std::make_unique<UnaryOp>(nullptr,
+                                       static_cast<const UnaryOp &>(node).op);
+    case NodeKind::TERNARY_OP:
+      return std::make_unique<TernaryOp>(nullptr, nullptr, nullptr);
+    case NodeKind::CONCAT:
+      return std::make_unique<Concat>(std::vector<std::unique_ptr<Expression>>(
+          static_cast<const Concat &>(node).args.size()));
+    case NodeKind::NEG_EDGE:
+      return std::make_unique<NegEdge>(nullptr);
+    case NodeKind::POS_EDGE:
+      return std::make_unique<PosEdge>(nullptr);
+    case NodeKind::VECTOR:
+      return std::make_unique<Vector>(nullptr, nullptr, nullptr);
+    case NodeKind::PORT: {
+      auto &port = static_cast<const Port &>(node);
+      return std::make_unique<Port>(
+          std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Vector>>(),
+          port.direction, port.data_type);
+    }
+    case NodeKind::MODULE_INSTANTIATION: {
+      auto &inst = static_cast<const ModuleInstantiation &>(node);
+      auto copy = std::make_unique<ModuleInstantiation>(
+          inst.module_name, Parameters(inst.parameters.size()),
+          inst.instance_name, Connections());
+      copy->connections.reserve(inst.connections.size());
+      for (auto &conn : inst.connections) {
+        copy->connections.emplace_back(conn.first,
+                                       std::unique_ptr<Identifier>());
+      }
+      return copy;
+    }
+    case NodeKind::WIRE:
+      return std::make_unique<Wire>(std::unique_ptr<Identifier>());
+    case NodeKind::REG:
+      return std::make_unique<Reg>(std::unique_ptr<Identifier>());
+    case NodeKind::CONTINUOUS_ASSIGN: {
+      auto copy = std::make_unique<ContinuousAssign>(
+          std::unique_ptr<Identifier>(), nullptr);
+      auto &assign = static_cast<const ContinuousAssign &>(node);
+      copy->setPrefix(assign.prefix());
+      return copy;
+    }
+    case NodeKind::BLOCKING_ASSIGN: {
+      auto copy = std::make_unique<BlockingAssign>(
+          std::unique_ptr<Identifier>(), nullptr);
+      auto &assign = static_cast<const BlockingAssign &>(node);
+      copy->setPrefix(assign.prefix());
+      return copy;
+    }
+    case NodeKind::NON_BLOCKING_ASSIGN: {
+      auto copy = std::make_unique<NonBlockingAssign>(
+          std::unique_ptr<Identifier>(), nullptr);
+      auto &assign = static_cast<const NonBlockingAssign &>(node);
+      copy->setPrefix(assign.prefix());
+      return copy;
+    }
+    case NodeKind::ALWAYS: {
+      auto &always = static_cast<const Always &>(node);
+      return std::make_unique<Always>(
+          decltype(Always::sensitivity_list)(always.sensitivity_list.size()),
+          decltype(Always::body)(always.body.size()));
+    }
+    case NodeKind::MODULE: {
+      auto &module = static_cast<const Module &>(node);
+      auto copy = std::make_unique<Module>(
+          module.name,
+          std::vector<std::unique_ptr<AbstractPort>>(module.ports.size()),
+          decltype(Module::body)(module.body.size()),
+          Parameters(module.parameters.size()));
+      copy->cache_emission = module.cache_emission;
+      return copy;
+    }
+    case NodeKind::STRING_BODY_MODULE: {
+      auto &module = static_cast<const StringBodyModule &>(node);
+      auto copy = std::make_unique<StringBodyModule>(
+          module.name,
+          std::vector<std::unique_ptr<AbstractPort>>(module.ports.size()),
+          module.body, Parameters(module.parameters.size()));
+      copy->cache_emission = module.cache_emission;
+      return copy;
+    }
+    case NodeKind::FILE: {
+      std::vector<std::unique_ptr<AbstractModule>> modules(
+          static_cast<const File &>(node).modules.size());
+      return std::make_unique<File>(modules);
+    }
+  }
+  throw std::runtime_error("vAST::clone: unexpected node");
+}
+
+// Bytes of the nodes of each class, in NodeKind order
+constexpr size_t kNodeSizes[] = {
+    sizeof(NumericLiteral),
+    sizeof(Identifier),
+    sizeof(String),
+    sizeof(Index),
+    sizeof(Slice),
+    sizeof(BinaryOp),
+    sizeof(UnaryOp),
+    sizeof(TernaryOp),
+    sizeof(Concat),
+    sizeof(NegEdge),
+    sizeof(PosEdge),
+    sizeof(Vector),
+    sizeof(Port),
+    sizeof(StringPort),
+    sizeof(SingleLineComment),
+    sizeof(BlockComment),
+    sizeof(ModuleInstantiation),
+    sizeof(Wire),
+    sizeof(Reg),
+    sizeof(ContinuousAssign),
+    sizeof(BlockingAssign),
+    sizeof(NonBlockingAssign),
+    sizeof(Star),
+    sizeof(Always),
+    sizeof(Module),
+    sizeof(StringBodyModule),
+    sizeof(StringModule),
+    sizeof(File)};
+static_assert(sizeof(kNodeSizes) / sizeof(size_t) == kNumNodeKinds,
+              "missing node size");
+
+// Bytes that the nodes of the tree rooted at `root` take in an Arena
+size_t arena_bytes(const Node &root) {
+  size_t bytes = 0;
+  std::vector<const Node *> stack{&root};
+  while (!stack.empty()) {
+    const Node *node = stack.back();
+    stack.pop_back();
+    NodeKind::NodeKind kind = node->kind();
+    bytes += (kNodeSizes[kind] + Arena::kAlignment - 1) &
+             ~(Arena::kAlignment - 1);
+    detail::for_each_child(const_cast<Node &>(*node), kind, [&](auto &slot) {
+      if (Node *child = detail::slot_node(slot)) stack.push_back(child);
+    });
+  }
+  return bytes;
+}
+
+// Moves `node` into the slot of type `Slot` at `slot`
+template <typename Slot>
+void set_slot(void *slot, std::unique_ptr<Node> &node) {
+  detail::set_slot(*static_cast<Slot *>(slot), node);
+}
+
+}  // namespace
+
+std::unique_ptr<Node> Node::clone() const {
+  struct Entry {
+    const Node *node;
+    // Empty slot of the copy of the parent that receives the copy of `node`
+    void *slot;
+    void (*set)(void *slot, std::unique_ptr<Node> &node);
+  };
+  std::unique_ptr<Node> root;
+  // Nodes to copy, each one is copied when popped and its children are
+  // pushed along with the slots of the copy that they go in
+  std::vector<Entry> stack{{this, &root, &set_slot<std::unique_ptr<Node>>}};
+  std::vector<const Node *> children;
+  while (!stack.empty()) {
+    Entry entry = stack.back();
+    stack.pop_back();
+    std::unique_ptr<Node> copy = shallow_copy(*entry.node);
+    Node *parent = copy.get();
+    entry.set(entry.slot, copy);
+    NodeKind::NodeKind kind = entry.node->kind();
+    children.clear();
+    // for_each_child only needs a non-const node to hand out mutable slots
+    detail::for_each_child(
+        const_cast<Node &>(*entry.node), kind,
+        [&](auto &slot) { children.push_back(detail::slot_node(slot)); });
+    size_t first = stack.size();
+    size_t i = 0;
+    detail::for_each_child(*parent, kind, [&](auto &slot) {
+      using Slot = std::decay_t<decltype(slot)>;
+      if (const Node *child = children[i++]) {
+        stack.push_back({child, &slot, &set_slot<Slot>});
+      }
+    });
+    // Copy the children in source order
+    std::reverse(stack.begin() + first, stack.end());
+  }
+  return root;
+}
+
+std::unique_ptr<Node> Node::clone(Arena &arena) const {
+  arena.reserve(arena_bytes(*this));
+  Arena::Scope scope(arena);
+  return clone();
+}
+
+}  // namespace verilogAST
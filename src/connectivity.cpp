@@ -0,0 +1,253 @@
+#include "verilogAST/connectivity.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+
+#include "children.hpp"
+#include "nets.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+typedef Connectivity::NetId NetId;
+
+// Net of an endpoint
+struct Edge {
+  NetId net;
+  const Node *node;
+};
+
+// Collects the nets and edges of a module in source order
+class Edges {
+  // Modules of the file by name, and the directions of the ports of those
+  // that have been instantiated
+  std::unordered_map<std::string_view, const Module *> modules;
+  std::unordered_map<const Module *, std::unordered_map<Symbol, Direction>>
+      directions;
+  // Last node added to the drivers or loads of each net, so that a node is
+  // added once per net
+  std::vector<const Node *> last_driver;
+  std::vector<const Node *> last_load;
+  std::vector<const Node *> stack;
+
+ public:
+  std::vector<Symbol> names;
+  std::unordered_map<Symbol, NetId> ids;
+  std::vector<Edge> drivers;
+  std::vector<Edge> loads;
+
+  explicit Edges(const File *file) {
+    if (!file) return;
+    for (auto &module : file->modules) {
+      if (module->kind() == NodeKind::MODULE) {
+        auto &m = static_cast<const Module &>(*module);
+        modules.emplace(m.name, &m);
+      }
+    }
+  }
+
+  NetId net(Symbol name) {
+    auto inserted = ids.emplace(name, static_cast<NetId>(names.size()));
+    if (inserted.second) {
+      names.push_back(name);
+      last_driver.push_back(nullptr);
+      last_load.push_back(nullptr);
+    }
+    return inserted.first->second;
+  }
+
+  void drive(Symbol name, const Node *node) {
+    NetId id = net(name);
+    if (last_driver[id] == node) return;
+    last_driver[id] = node;
+    drivers.push_back({id, node});
+  }
+
+  void load(Symbol name, const Node *node) {
+    NetId id = net(name);
+    if (last_load[id] == node) return;
+    last_load[id] = node;
+    loads.push_back({id, node});
+  }
+
+  // `node` reads every name of the tree rooted at `root`
+  void read(const Node &root, const Node *node) {
+    stack.push_back(&root);
+    while (!stack.empty()) {
+      const Node *current = stack.back();
+      stack.pop_back();
+      if (!current) continue;
+      if (current->kind() == NodeKind::IDENTIFIER) {
+        load(static_cast<const Identifier *>(current)->value, node);
+        continue;
+      }
+      size_t first = stack.size();
+      // for_each_child only needs a non-const node to hand out mutable slots
+      detail::for_each_child(const_cast<Node &>(*current), [&](auto &slot) {
+        stack.push_back(detail::slot_node(slot));
+      });
+      std::reverse(stack.begin() + first, stack.end());
+    }
+  }
+
+  // `node` drives the names of the assignment target `target`, and reads its
+  // indices
+  void write(const Node &target, const Node *node) {
+    switch (target.kind()) {
+      case NodeKind::IDENTIFIER:
+        drive(static_cast<const Identifier &>(target).value, node);
+        break;
+      case NodeKind::INDEX: {
+        auto &index = static_cast<const Index &>(target);
+        drive(index.id->value, node);
+        read(*index.index, node);
+        break;
+      }
+      case NodeKind::SLICE: {
+        auto &slice = static_cast<const Slice &>(target);
+        drive(slice.id->value, node);
+        read(*slice.high_index, node);
+        read(*slice.low_index, node);
+        break;
+      }
+      case NodeKind::CONCAT:
+        for (auto &arg : static_cast<const Concat &>(target).args) {
+          write(*arg, node);
+        }
+        break;
+      default:
+        read(target, node);
+    }
+  }
+
+  template <typename T>
+  void assign(const T &statement) {
+    std::visit([&](auto &target) { write(*target, &statement); },
+               statement.target);
+    read(*statement.value, &statement);
+  }
+
+  // Direction of `port` of the module named `module_name`, INOUT if unknown
+  Direction direction(Symbol module_name, Symbol port) {
+    auto module = modules.find(module_name.str());
+    if (module == modules.end()) return INOUT;
+    auto inserted = directions.try_emplace(module->second);
+    auto &ports = inserted.first->second;
+    if (inserted.second) {
+      for (auto &p : module->second->ports) {
+        if (p->kind() != NodeKind::PORT) continue;
+        auto &port = static_cast<const Port &>(*p);
+        ports.emplace(detail::net_name(port.value), port.direction);
+      }
+    }
+    auto it = ports.find(port);
+    return it == ports.end() ? INOUT : it->second;
+  }
+
+  void instance(const ModuleInstantiation &inst) {
+    for (auto &parameter : inst.parameters) read(*parameter.second, &inst);
+    for (auto &connection : inst.connections) {
+      const Node &value = *detail::slot_node(
+          const_cast<Connection &>(connection.second));
+      Direction d = direction(inst.module_name, connection.first);
+      if (d != INPUT) write(value, &inst);
+      if (d != OUTPUT) read(value, &inst);
+    }
+  }
+
+  void always(const Always &always) {
+    for (auto &item : always.sensitivity_list) {
+      std::visit([&](auto &ptr) { read(*ptr, &always); }, item);
+    }
+    for (auto &statement : always.body) {
+      if (auto declaration =
+              std::get_if<std::unique_ptr<Declaration>>(&statement)) {
+        declare(**declaration);
+        continue;
+      }
+      auto &behavioral =
+          *std::get<std::unique_ptr<BehavioralStatement>>(statement);
+      if (behavioral.kind() == NodeKind::BLOCKING_ASSIGN) {
+        assign(static_cast<const BlockingAssign &>(behavioral));
+      } else if (behavioral.kind() == NodeKind::NON_BLOCKING_ASSIGN) {
+        assign(static_cast<const NonBlockingAssign &>(behavioral));
+      }
+    }
+  }
+
+  void declare(const Declaration &declaration) {
+    net(detail::net_name(declaration));
+  }
+
+  void port(const Port &port) {
+    Symbol name = detail::net_name(port.value);
+    if (port.direction != OUTPUT) drive(name, &port);
+    if (port.direction != INPUT) load(name, &port);
+  }
+
+  void module(const Module &module) {
+    // Most statements declare, drive or read a net or two
+    size_t size = module.ports.size() + module.body.size();
+    ids.reserve(size);
+    names.reserve(size);
+    drivers.reserve(size);
+    loads.reserve(2 * size);
+    for (auto &p : module.ports) {
+      if (p->kind() == NodeKind::PORT) port(static_cast<const Port &>(*p));
+    }
+    for (auto &statement : module.body) {
+      if (auto declaration =
+              std::get_if<std::unique_ptr<Declaration>>(&statement)) {
+        declare(**declaration);
+        continue;
+      }
+      auto &structural =
+          *std::get<std::unique_ptr<StructuralStatement>>(statement);
+      switch (structural.kind()) {
+        case NodeKind::CONTINUOUS_ASSIGN:
+          assign(static_cast<const ContinuousAssign &>(structural));
+          break;
+        case NodeKind::MODULE_INSTANTIATION:
+          instance(static_cast<const ModuleInstantiation &>(structural));
+          break;
+        case NodeKind::ALWAYS:
+          always(static_cast<const Always &>(structural));
+          break;
+        default:
+          break;
+      }
+    }
+  }
+};
+
+// Counting sort of `edges` by net, keeping the source order of the endpoints
+// of each net
+void compress(const std::vector<Edge> &edges, size_t nets,
+              std::vector<uint32_t> &offsets,
+              std::vector<const Node *> &endpoints) {
+  if (edges.size() >= UINT32_MAX) {
+    throw std::runtime_error("vAST::Connectivity: too many edges");
+  }
+  offsets.assign(nets + 1, 0);
+  for (const Edge &edge : edges) offsets[edge.net + 1]++;
+  for (size_t i = 0; i < nets; i++) offsets[i + 1] += offsets[i];
+  endpoints.resize(edges.size());
+  std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+  for (const Edge &edge : edges) endpoints[next[edge.net]++] = edge.node;
+}
+
+}  // namespace
+
+Connectivity::Connectivity(const Module &module, const File *file) {
+  Edges edges(file);
+  edges.module(module);
+  compress(edges.drivers, edges.names.size(), driver_offsets,
+           driver_endpoints);
+  compress(edges.loads, edges.names.size(), load_offsets, load_endpoints);
+  names = std::move(edges.names);
+  ids = std::move(edges.ids);
+}
+
+}  // namespace verilogAST
@@ -0,0 +1,90 @@
+// Internal helpers for evaluating NumericLiterals, shared by the passes
+#pragma once
+#ifndef VERILOGAST_CONSTANT_H
+#define VERILOGAST_CONSTANT_H
+
+#include <cstdint>
+#include <optional>
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+namespace detail {
+
+// Value of a NumericLiteral (or folded operation) that is known exactly
+struct Constant {
+  uint64_t value;
+  unsigned width;
+  bool is_signed;
+};
+
+// Returns true if `value` is representable as a non-negative number of the
+// given width and signedness
+inline bool fits(uint64_t value, unsigned width, bool is_signed) {
+  unsigned bits = is_signed ? width - 1 : width;
+  return bits >= 64 || value >> bits == 0;
+}
+
+// Value of `literal`, parsing its digits unless it is an integer literal.
+// Returns nothing if the digits contain x/z or the value is negative or does
+// not fit in 64 bits.
+inline std::optional<Constant> evaluate(const NumericLiteral &literal) {
+  if (literal.size == 0) return std::nullopt;
+  if (literal.isInteger()) {
+    for (size_t i = 1; i < literal.numWords(); i++) {
+      if (literal.wordAt(i) != 0) return std::nullopt;
+    }
+    uint64_t word = literal.wordAt(0);
+    if (!fits(word, literal.size, literal._signed)) return std::nullopt;
+    return Constant{word, literal.size, literal._signed};
+  }
+  unsigned base = 10;
+  switch (literal.radix) {
+    case BINARY:
+      base = 2;
+      break;
+    case OCTAL:
+      base = 8;
+      break;
+    case HEX:
+      base = 16;
+      break;
+    case DECIMAL:
+      break;
+  }
+  uint64_t value = 0;
+  bool any_digit = false;
+  for (char c : literal.value()) {
+    unsigned digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else if (c == '_') {
+      continue;
+    } else {
+      return std::nullopt;
+    }
+    if (digit >= base || __builtin_mul_overflow(value, base, &value) ||
+        __builtin_add_overflow(value, digit, &value)) {
+      return std::nullopt;
+    }
+    any_digit = true;
+  }
+  if (!any_digit) return std::nullopt;
+  // Excess digits are truncated to the size of the literal
+  if (literal.size < 64) value &= (uint64_t(1) << literal.size) - 1;
+  if (!fits(value, literal.size, literal._signed)) return std::nullopt;
+  return Constant{value, literal.size, literal._signed};
+}
+
+inline std::optional<Constant> evaluate(const Expression &expr) {
+  if (expr.kind() != NodeKind::NUMERIC_LITERAL) return std::nullopt;
+  return evaluate(static_cast<const NumericLiteral &>(expr));
+}
+
+}  // namespace detail
+}  // namespace verilogAST
+#endif
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "structural.hpp"
+#include "verilogAST/passes.hpp"
+#include "verilogAST/transformer.hpp"
+#include "width.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+using detail::Analyzer;
+using detail::ExprInfo;
+using detail::compute_contexts;
+using detail::kNoParent;
+using detail::kUnknownWidth;
+using detail::target_width;
+
+bool is_candidate(const ExprInfo &info) {
+  switch (info.expr->kind()) {
+    case NodeKind::BINARY_OP:
+    case NodeKind::UNARY_OP:
+    case NodeKind::TERNARY_OP:
+    case NodeKind::CONCAT:
+    case NodeKind::SLICE:
+      break;
+    default:
+      return false;
+  }
+  // The replacement wire is unsigned and as wide as the self-determined
+  // expression, so it must evaluate the same in every occurrence's context
+  return info.slot && !info.opaque && info.width != kUnknownWidth &&
+         !info.is_signed && (info.stable || info.context <= info.width);
+}
+
+bool same_subtree(const std::vector<ExprInfo> &infos, size_t a, size_t b) {
+  if (infos[a].hash != infos[b].hash || infos[a].size != infos[b].size) {
+    return false;
+  }
+  // Post-order sequences with equal arities describe equal trees
+  for (size_t i = 0; i < infos[a].size; i++) {
+    if (!detail::local_equal(*infos[a - i].expr, *infos[b - i].expr)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Structurally identical occurrences, in source order
+struct ExprClass {
+  std::vector<size_t> occurrences;
+};
+
+// Collects every name used in a module, to pick fresh wire names
+class NameCollector : public Visitor {
+ public:
+  std::unordered_set<std::string_view> names;
+
+  bool enter(const Node &node) override {
+    if (node.kind() == NodeKind::IDENTIFIER) {
+      names.insert(static_cast<const Identifier &>(node).value.str());
+    } else if (node.kind() == NodeKind::MODULE_INSTANTIATION) {
+      names.insert(
+          static_cast<const ModuleInstantiation &>(node).instance_name.str());
+    }
+    return true;
+  }
+};
+
+std::unique_ptr<Declaration> make_wire(const std::string &name,
+                                       unsigned width) {
+  if (width == 1) return std::make_unique<Wire>(make_id(name));
+  return std::make_unique<Wire>(std::make_unique<Vector>(
+      make_id(name), make_num(std::to_string(width - 1)), make_num("0")));
+}
+
+}  // namespace
+
+void eliminate_common_subexpressions(Module &module) {
+  detail::NetWidths widths = detail::net_widths(module);
+
+  // Analyze the right-hand sides of the continuous assignments.  Behavioral
+  // assignments are not considered, as a blocking assignment earlier in the
+  // same block may change the value of an expression.
+  std::vector<ExprInfo> infos;
+  Analyzer analyzer(infos, widths);
+  for (size_t i = 0; i < module.body.size(); i++) {
+    auto statement =
+        std::get_if<std::unique_ptr<StructuralStatement>>(&module.body[i]);
+    if (!statement || (*statement)->kind() != NodeKind::CONTINUOUS_ASSIGN) {
+      continue;
+    }
+    auto &assign = static_cast<ContinuousAssign &>(**statement);
+    if (!assign.value) continue;
+    size_t first = infos.size();
+    analyzer.run(assign.value, i);
+    compute_contexts(infos, first, infos.size() - 1,
+                     target_width(widths, assign.target));
+  }
+
+  // Group the candidates into classes of identical expressions
+  std::vector<ExprClass> classes;
+  std::unordered_map<size_t, std::vector<size_t>> buckets;
+  for (size_t i = 0; i < infos.size(); i++) {
+    if (!is_candidate(infos[i])) continue;
+    auto &bucket = buckets[infos[i].hash];
+    auto match = std::find_if(bucket.begin(), bucket.end(), [&](size_t c) {
+      return same_subtree(infos, classes[c].occurrences[0], i);
+    });
+    if (match == bucket.end()) {
+      bucket.push_back(classes.size());
+      classes.push_back({{i}});
+    } else {
+      classes[*match].occurrences.push_back(i);
+    }
+  }
+
+  // Largest expressions first, so that the occurrences of a subexpression
+  // within the copies of a larger expression that are replaced are no longer
+  // counted
+  std::vector<size_t> order;
+  for (size_t c = 0; c < classes.size(); c++) {
+    if (classes[c].occurrences.size() > 1) order.push_back(c);
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return infos[classes[a].occurrences[0]].size >
+           infos[classes[b].occurrences[0]].size;
+  });
+  std::vector<size_t> hoisted;
+  for (size_t c : order) {
+    auto &occurrences = classes[c].occurrences;
+    occurrences.erase(std::remove_if(occurrences.begin(), occurrences.end(),
+                                     [&](size_t i) { return infos[i].dead; }),
+                      occurrences.end());
+    if (occurrences.size() < 2) continue;
+    // The first occurrence becomes the value of the new wire
+    for (size_t k = 1; k < occurrences.size(); k++) {
+      size_t root = occurrences[k];
+      for (size_t i = root + 1 - infos[root].size; i <= root; i++) {
+        infos[i].dead = true;
+      }
+    }
+    hoisted.push_back(c);
+  }
+  if (hoisted.empty()) return;
+
+  // Subexpressions come before the expressions containing them in post-order,
+  // so their wires are assigned first
+  std::sort(hoisted.begin(), hoisted.end(), [&](size_t a, size_t b) {
+    return classes[a].occurrences[0] < classes[b].occurrences[0];
+  });
+  NameCollector collector;
+  walk(module, collector);
+  size_t next_name = 0;
+  std::vector<std::vector<std::unique_ptr<StructuralStatement>>> assigns(
+      module.body.size());
+  std::vector<std::vector<std::unique_ptr<Declaration>>> wires(
+      module.body.size());
+  // Reset the memoized hashes of the ancestors of every replaced occurrence
+  for (size_t c : hoisted) {
+    for (size_t i : classes[c].occurrences) {
+      for (size_t j = infos[i].parent; j != kNoParent && !infos[j].invalidated;
+           j = infos[j].parent) {
+        infos[j].expr->invalidateHash();
+        infos[j].invalidated = true;
+      }
+      std::visit([](auto &statement) { statement->invalidateHash(); },
+                 module.body[infos[i].statement]);
+    }
+  }
+  module.invalidateHash();
+
+  for (size_t c : hoisted) {
+    std::string name;
+    do {
+      name = "_cse_" + std::to_string(next_name++);
+    } while (collector.names.count(name));
+    const ExprInfo &first = infos[classes[c].occurrences[0]];
+    std::unique_ptr<Expression> value = std::move(*first.slot);
+    for (size_t i : classes[c].occurrences) *infos[i].slot = make_id(name);
+    wires[first.statement].push_back(make_wire(name, first.width));
+    assigns[first.statement].push_back(
+        std::make_unique<ContinuousAssign>(make_id(name), std::move(value)));
+  }
+
+  // Each wire is declared and assigned just before the statement that first
+  // used the expression, where all of its operands are declared
+  decltype(module.body) body;
+  for (size_t i = 0; i < module.body.size(); i++) {
+    for (auto &wire : wires[i]) body.push_back(std::move(wire));
+    for (auto &assign : assigns[i]) body.push_back(std::move(assign));
+    body.push_back(std::move(module.body[i]));
+  }
+  module.body = std::move(body);
+}
+
+void eliminate_common_subexpressions(File &file) {
+  for (auto &module : file.modules) {
+    if (module->kind() == NodeKind::MODULE) {
+      eliminate_common_subexpressions(static_cast<Module &>(*module));
+    }
+  }
+}
+
+}  // namespace verilogAST
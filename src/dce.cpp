@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "nets.hpp"
+#include "verilogAST/passes.hpp"
+#include "verilogAST/transformer.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+// Names of a module that may be read by something that is kept
+class Liveness : public Visitor {
+  std::unordered_set<Symbol> live;
+  std::vector<Symbol> work;
+
+ public:
+  // Marks `name` live, returns false if it already was
+  bool mark(Symbol name) {
+    if (!live.insert(name).second) return false;
+    work.push_back(name);
+    return true;
+  }
+
+  // Marks every identifier of the tree rooted at `node`
+  void markAll(const Node &node) { walk(node, *this); }
+
+  bool enter(const Node &node) override {
+    if (node.kind() == NodeKind::IDENTIFIER) {
+      mark(static_cast<const Identifier &>(node).value);
+    }
+    return true;
+  }
+
+  bool isLive(Symbol name) const { return live.count(name) != 0; }
+
+  // Next live name whose drivers have not been marked yet, if any
+  std::optional<Symbol> next() {
+    if (work.empty()) return std::nullopt;
+    Symbol name = work.back();
+    work.pop_back();
+    return name;
+  }
+};
+
+// Marks the names used by the dimensions of a declaration, which are usually
+// parameters
+void mark_dimensions(const Declaration &declaration, Liveness &liveness) {
+  if (auto index = std::get_if<std::unique_ptr<Index>>(&declaration.value)) {
+    liveness.markAll(*(*index)->index);
+  } else if (auto slice =
+                 std::get_if<std::unique_ptr<Slice>>(&declaration.value)) {
+    liveness.markAll(*(*slice)->high_index);
+    liveness.markAll(*(*slice)->low_index);
+  } else if (auto vector =
+                 std::get_if<std::unique_ptr<Vector>>(&declaration.value)) {
+    liveness.markAll(*(*vector)->msb);
+    liveness.markAll(*(*vector)->lsb);
+  }
+}
+
+}  // namespace
+
+size_t eliminate_dead_code(Module &module) {
+  if (module.kind() != NodeKind::MODULE) return 0;
+  Liveness liveness;
+  for (auto &port : module.ports) {
+    if (port->kind() == NodeKind::STRING_PORT) continue;
+    auto &p = static_cast<const Port &>(*port);
+    if (p.direction != INPUT) liveness.mark(detail::net_name(p.value));
+  }
+  // The text of a StringPort is not parsed, so every net named in it is
+  // treated as an output
+  detail::StringPortNames string_port_names = detail::string_port_names(module);
+  auto mark_if_exposed = [&](Symbol name) {
+    if (detail::in_string_port(string_port_names, name)) liveness.mark(name);
+  };
+
+  // Continuous assignments by the name of the net they drive
+  std::unordered_map<Symbol, std::vector<const ContinuousAssign *>> drivers;
+  for (auto &statement : module.body) {
+    if (auto declaration =
+            std::get_if<std::unique_ptr<Declaration>>(&statement)) {
+      mark_dimensions(**declaration, liveness);
+      mark_if_exposed(detail::net_name(**declaration));
+      continue;
+    }
+    auto &structural =
+        *std::get<std::unique_ptr<StructuralStatement>>(statement);
+    if (structural.kind() == NodeKind::CONTINUOUS_ASSIGN) {
+      auto &assign = static_cast<const ContinuousAssign &>(structural);
+      Symbol target = detail::net_name(assign.target);
+      drivers[target].push_back(&assign);
+      mark_if_exposed(target);
+    } else {
+      // Instances and always blocks are kept, along with everything they
+      // read or drive
+      liveness.markAll(structural);
+    }
+  }
+
+  // Backward from the live names to the nets their drivers read
+  while (std::optional<Symbol> name = liveness.next()) {
+    auto it = drivers.find(*name);
+    if (it == drivers.end()) continue;
+    for (const ContinuousAssign *assign : it->second) {
+      liveness.markAll(*assign->value);
+      std::visit([&liveness](auto &ptr) { liveness.markAll(*ptr); },
+                 assign->target);
+    }
+  }
+
+  auto dead = [&liveness](auto &statement) {
+    if (auto declaration =
+            std::get_if<std::unique_ptr<Declaration>>(&statement)) {
+      return !liveness.isLive(detail::net_name(**declaration));
+    }
+    auto &structural =
+        *std::get<std::unique_ptr<StructuralStatement>>(statement);
+    return structural.kind() == NodeKind::CONTINUOUS_ASSIGN &&
+           !liveness.isLive(detail::net_name(
+               static_cast<const ContinuousAssign &>(structural).target));
+  };
+  size_t size = module.body.size();
+  module.body.erase(
+      std::remove_if(module.body.begin(), module.body.end(), dead),
+      module.body.end());
+  size_t removed = size - module.body.size();
+  if (removed) module.invalidateHash();
+  return removed;
+}
+
+size_t eliminate_dead_code(File &file) {
+  size_t removed = 0;
+  for (auto &module : file.modules) {
+    if (module->kind() == NodeKind::MODULE) {
+      removed += eliminate_dead_code(static_cast<Module &>(*module));
+    }
+  }
+  if (removed) file.invalidateHash();
+  return removed;
+}
+
+}  // namespace verilogAST
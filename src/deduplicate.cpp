@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "structural.hpp"
+#include "verilogAST/passes.hpp"
+#include "verilogAST/transformer.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+// Points the instantiations of removed modules at the modules that are kept
+class InstanceRenamer : public Transformer {
+  const std::unordered_map<std::string, std::string> &renames;
+
+ public:
+  InstanceRenamer(const std::unordered_map<std::string, std::string> &renames)
+      : renames(renames){};
+
+  bool enter(Node &node) override {
+    switch (node.kind()) {
+      case NodeKind::FILE:
+      case NodeKind::MODULE:
+      case NodeKind::STRING_BODY_MODULE:
+        return true;
+      case NodeKind::MODULE_INSTANTIATION: {
+        auto &inst = static_cast<ModuleInstantiation &>(node);
+        auto it = renames.find(std::string(inst.module_name.str()));
+        if (it != renames.end()) {
+          inst.module_name = SymbolTable::current().intern(it->second);
+        }
+        return false;
+      }
+      default:
+        return false;
+    }
+  };
+};
+
+bool is_deduplicable(const AbstractModule &module) {
+  return module.kind() == NodeKind::MODULE ||
+         module.kind() == NodeKind::STRING_BODY_MODULE;
+}
+
+// The body of a StringBodyModule and the definition of a StringModule are not
+// parsed, so a module whose name occurs in any of them may be instantiated
+// there and is never removed.  As in dead code elimination, matching
+// substrings rather than tokens is conservative.
+std::vector<std::string_view> opaque_texts(const File &file) {
+  std::vector<std::string_view> texts;
+  for (auto &module : file.modules) {
+    if (module->kind() == NodeKind::STRING_BODY_MODULE) {
+      texts.push_back(static_cast<const StringBodyModule &>(*module).body);
+    } else if (module->kind() == NodeKind::STRING_MODULE) {
+      texts.push_back(static_cast<const StringModule &>(*module).definition);
+    }
+  }
+  return texts;
+}
+
+bool in_opaque_text(std::string_view name,
+                    const std::vector<std::string_view> &texts) {
+  return std::any_of(texts.begin(), texts.end(),
+                     [name](std::string_view text) {
+                       return text.find(name) != std::string_view::npos;
+                     });
+}
+
+// Removes the modules that are identical to an earlier module, returns the
+// number of modules removed
+size_t deduplicate_once(File &file) {
+  std::vector<std::string_view> texts = opaque_texts(file);
+  std::unordered_map<size_t, std::vector<const Module *>> buckets;
+  std::unordered_map<std::string, std::string> renames;
+  std::vector<std::unique_ptr<AbstractModule>> kept;
+  for (auto &module : file.modules) {
+    if (!is_deduplicable(*module)) {
+      kept.push_back(std::move(module));
+      continue;
+    }
+    auto &candidate = static_cast<const Module &>(*module);
+    auto &bucket = buckets[detail::hash_ignoring_name(candidate)];
+    const Module *original = nullptr;
+    for (const Module *other : bucket) {
+      if (detail::equal_ignoring_name(*other, candidate)) {
+        original = other;
+        break;
+      }
+    }
+    if (original && !in_opaque_text(candidate.name, texts)) {
+      renames[candidate.name] = original->name;
+      continue;
+    }
+    if (!original) bucket.push_back(&candidate);
+    kept.push_back(std::move(module));
+  }
+  file.modules = std::move(kept);
+  if (renames.empty()) return 0;
+  file.invalidateHash();
+  InstanceRenamer renamer(renames);
+  renamer.run(file);
+  return renames.size();
+}
+
+}  // namespace
+
+size_t deduplicate_modules(File &file) {
+  size_t removed = 0;
+  // Renaming instantiations can make their parents identical
+  while (size_t count = deduplicate_once(file)) removed += count;
+  return removed;
+}
+
+}  // namespace verilogAST
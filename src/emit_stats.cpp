@@ -0,0 +1,100 @@
+#include "verilogAST/emit_stats.hpp"
+
+#include <cstdio>
+
+#include "verilogAST/transformer.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+class NodeCounter : public Visitor {
+  EmitStats &stats;
+
+ public:
+  explicit NodeCounter(EmitStats &stats) : stats(stats) {}
+
+  bool enter(const Node &node) override {
+    stats.nodes[node.kind()]++;
+    if (node.kind() == NodeKind::IDENTIFIER &&
+        static_cast<const Identifier &>(node).value.needsEscape()) {
+      stats.escaped_identifiers++;
+    }
+    return true;
+  }
+};
+
+void append_json_string(std::string &out, std::string_view str) {
+  out += '"';
+  for (char c : str) {
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          out += escaped;
+        } else {
+          out += c;
+        }
+    }
+  }
+  out += '"';
+}
+
+}  // namespace
+
+void EmitStats::record(const Module &module, size_t bytes,
+                       std::chrono::nanoseconds time) {
+  this->bytes += bytes;
+  this->time += time;
+  modules.push_back({module.name, bytes, time});
+  NodeCounter counter(*this);
+  walk(module, counter);
+}
+
+void EmitStats::merge(const EmitStats &other) {
+  for (size_t i = 0; i < kNumNodeKinds; i++) nodes[i] += other.nodes[i];
+  escaped_identifiers += other.escaped_identifiers;
+  bytes += other.bytes;
+  time += other.time;
+  modules.insert(modules.end(), other.modules.begin(), other.modules.end());
+}
+
+std::string EmitStats::toJson() const {
+  std::string out = "{\"bytes\": " + std::to_string(bytes) +
+                    ", \"time_ns\": " + std::to_string(time.count()) +
+                    ", \"escaped_identifiers\": " +
+                    std::to_string(escaped_identifiers) + ", \"nodes\": {";
+  bool first = true;
+  for (size_t i = 0; i < kNumNodeKinds; i++) {
+    if (!nodes[i]) continue;
+    if (!first) out += ", ";
+    first = false;
+    append_json_string(out, kind_name(static_cast<NodeKind::NodeKind>(i)));
+    out += ": " + std::to_string(nodes[i]);
+  }
+  out += "}, \"modules\": [";
+  for (size_t i = 0; i < modules.size(); i++) {
+    if (i > 0) out += ", ";
+    out += "{\"name\": ";
+    append_json_string(out, modules[i].name);
+    out += ", \"bytes\": " + std::to_string(modules[i].bytes) +
+           ", \"time_ns\": " + std::to_string(modules[i].time.count()) + "}";
+  }
+  out += "]}";
+  return out;
+}
+
+}  // namespace verilogAST
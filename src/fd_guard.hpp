@@ -0,0 +1,22 @@
+// Internal helper for closing file descriptors on scope exit
+#pragma once
+#ifndef VERILOGAST_FD_GUARD_H
+#define VERILOGAST_FD_GUARD_H
+
+#include <unistd.h>
+
+namespace verilogAST {
+namespace detail {
+
+// Closes `fd` on scope exit unless it is negative, set it to -1 to close the
+// descriptor by hand and check the result
+struct FdGuard {
+  int fd;
+  ~FdGuard() {
+    if (fd >= 0) close(fd);
+  }
+};
+
+}  // namespace detail
+}  // namespace verilogAST
+#endif
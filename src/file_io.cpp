@@ -0,0 +1,121 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+#include "fd_guard.hpp"
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+static std::system_error os_error(const std::string &what) {
+  return std::system_error(errno, std::generic_category(), what);
+}
+
+namespace {
+
+// Sink that writes straight into a shared mapping of `fd`.  The file is grown
+// one window at a time and truncated to the exact output size by `finish`.
+class MmapSink : public Sink {
+  int fd;
+  size_t window_size;
+  // File offset of the current window
+  size_t offset = 0;
+
+  void unmap() {
+    if (begin) munmap(begin, window_size);
+    begin = cur = end = nullptr;
+  }
+
+  void map(size_t new_offset) {
+    offset = new_offset;
+    if (ftruncate(fd, offset + window_size) != 0) {
+      throw os_error("vAST::File::writeTo ftruncate failed");
+    }
+    void *window = mmap(nullptr, window_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, offset);
+    if (window == MAP_FAILED) {
+      throw os_error("vAST::File::writeTo mmap failed");
+    }
+    begin = cur = static_cast<char *>(window);
+    end = begin + window_size;
+  }
+
+ protected:
+  void overflow(const char *data, size_t size) override {
+    while (size > 0) {
+      size_t chunk = std::min(size, static_cast<size_t>(end - cur));
+      std::memcpy(cur, data, chunk);
+      cur += chunk;
+      data += chunk;
+      size -= chunk;
+      if (cur == end) {
+        drained += window_size;
+        unmap();
+        map(offset + window_size);
+      }
+    }
+  }
+
+ public:
+  MmapSink(int fd, size_t window_size) : fd(fd) {
+    // Mapping offsets must be page aligned
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    this->window_size =
+        std::max(page_size, (window_size + page_size - 1) / page_size *
+                                page_size);
+    map(0);
+  }
+
+  ~MmapSink() { unmap(); }
+
+  void finish() {
+    size_t size = bytesWritten();
+    unmap();
+    if (ftruncate(fd, size) != 0) {
+      throw os_error("vAST::File::writeTo ftruncate failed");
+    }
+  }
+};
+
+}  // namespace
+
+size_t File::writeTo(const std::string &path,
+                     const WriteOptions &options) const {
+  // The mapping needs read access to the file as well
+  int flags = (options.use_mmap ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC;
+  detail::FdGuard guard{open(path.c_str(), flags, 0644)};
+  if (guard.fd < 0) throw os_error("vAST::File::writeTo cannot open " + path);
+
+  auto emit_to = [&](Sink &sink) {
+    if (options.pool) {
+      emit(sink, *options.pool);
+    } else {
+      emit(sink);
+    }
+  };
+
+  size_t size;
+  if (options.use_mmap) {
+    MmapSink sink(guard.fd, options.buffer_size);
+    emit_to(sink);
+    size = sink.bytesWritten();
+    sink.finish();
+  } else {
+    FdSink sink(guard.fd, options.buffer_size);
+    emit_to(sink);
+    sink.flush();
+    size = sink.bytesWritten();
+  }
+
+  int fd = guard.fd;
+  guard.fd = -1;
+  if (close(fd) != 0) throw os_error("vAST::File::writeTo close failed");
+  return size;
+}
+
+}  // namespace verilogAST
@@ -0,0 +1,440 @@
+#include "constant.hpp"
+#include "verilogAST/passes.hpp"
+#include "verilogAST/transformer.hpp"
+#include "width.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+using detail::Constant;
+using detail::evaluate;
+using detail::fits;
+using detail::kUnknownWidth;
+using detail::max_width;
+using detail::net_width;
+using detail::NetWidths;
+using detail::range_width;
+
+// Keeps the radix of `like` (the left operand)
+std::unique_ptr<Expression> make_constant(Constant constant,
+                                          const Expression &like) {
+  Radix radix = like.kind() == NodeKind::NUMERIC_LITERAL
+                    ? static_cast<const NumericLiteral &>(like).radix
+                    : Radix::DECIMAL;
+  return std::make_unique<NumericLiteral>(constant.value, constant.width,
+                                          constant.is_signed, radix);
+}
+
+std::unique_ptr<Expression> make_bool(bool value) {
+  return std::make_unique<NumericLiteral>(value ? "1" : "0", 1, false,
+                                          Radix::BINARY);
+}
+
+namespace Signedness {
+enum Signedness { UNSIGNED, SIGNED, UNKNOWN };
+}
+
+// Combines the signedness of the operands of a context determined operator,
+// which is signed only if all of them are
+Signedness::Signedness both(Signedness::Signedness a,
+                            Signedness::Signedness b) {
+  if (a == Signedness::UNSIGNED || b == Signedness::UNSIGNED) {
+    return Signedness::UNSIGNED;
+  }
+  if (a == Signedness::SIGNED && b == Signedness::SIGNED) {
+    return Signedness::SIGNED;
+  }
+  return Signedness::UNKNOWN;
+}
+
+// Returns the signedness of `expr` where it can be told from the expression
+// and the nets `widths` of the module.  Nets are unsigned, other identifiers
+// may name signed parameters, so they are UNKNOWN
+Signedness::Signedness signedness(const Expression &expr,
+                                  const NetWidths &widths,
+                                  unsigned depth = 0) {
+  // Give up on deep trees rather than recursing through them
+  if (depth > 32) return Signedness::UNKNOWN;
+  switch (expr.kind()) {
+    case NodeKind::NUMERIC_LITERAL:
+      return static_cast<const NumericLiteral &>(expr)._signed
+                 ? Signedness::SIGNED
+                 : Signedness::UNSIGNED;
+    case NodeKind::UNARY_OP: {
+      auto &unary_op = static_cast<const UnaryOp &>(expr);
+      switch (unary_op.op) {
+        case UnOp::INVERT:
+        case UnOp::PLUS:
+        case UnOp::MINUS:
+          return signedness(*unary_op.operand, widths, depth + 1);
+        default:
+          return Signedness::UNSIGNED;
+      }
+    }
+    case NodeKind::BINARY_OP: {
+      auto &binary_op = static_cast<const BinaryOp &>(expr);
+      switch (binary_op.op) {
+        case BinOp::EQ:
+        case BinOp::NEQ:
+        case BinOp::AND:
+        case BinOp::OR:
+          return Signedness::UNSIGNED;
+        case BinOp::LSHIFT:
+        case BinOp::RSHIFT:
+        case BinOp::ALSHIFT:
+        case BinOp::ARSHIFT:
+        case BinOp::POW:
+          return signedness(*binary_op.left, widths, depth + 1);
+        default:
+          return both(signedness(*binary_op.left, widths, depth + 1),
+                      signedness(*binary_op.right, widths, depth + 1));
+      }
+    }
+    case NodeKind::TERNARY_OP: {
+      auto &ternary_op = static_cast<const TernaryOp &>(expr);
+      return both(signedness(*ternary_op.true_value, widths, depth + 1),
+                  signedness(*ternary_op.false_value, widths, depth + 1));
+    }
+    case NodeKind::IDENTIFIER:
+      return widths.count(static_cast<const Identifier &>(expr).value)
+                 ? Signedness::UNSIGNED
+                 : Signedness::UNKNOWN;
+    case NodeKind::SLICE:
+    case NodeKind::CONCAT:
+      return Signedness::UNSIGNED;
+    default:
+      // Selects of identifiers, which may be array elements
+      return Signedness::UNKNOWN;
+  }
+}
+
+// Exact result of `a op b`, if it fits the width of the operation
+std::optional<Constant> fold(BinOp::BinOp op, Constant a, Constant b) {
+  Constant result{0, std::max(a.width, b.width), a.is_signed && b.is_signed};
+  switch (op) {
+    case BinOp::EQ:
+      return Constant{a.value == b.value, 1, false};
+    case BinOp::NEQ:
+      return Constant{a.value != b.value, 1, false};
+    case BinOp::AND:
+      return Constant{a.value && b.value, 1, false};
+    case BinOp::OR:
+      return Constant{a.value || b.value, 1, false};
+    case BinOp::ADD:
+      if (__builtin_add_overflow(a.value, b.value, &result.value)) {
+        return std::nullopt;
+      }
+      break;
+    case BinOp::SUB:
+      if (a.value < b.value) return std::nullopt;
+      result.value = a.value - b.value;
+      break;
+    case BinOp::MUL:
+      if (__builtin_mul_overflow(a.value, b.value, &result.value)) {
+        return std::nullopt;
+      }
+      break;
+    case BinOp::DIV:
+      if (b.value == 0) return std::nullopt;
+      result.value = a.value / b.value;
+      break;
+    case BinOp::MOD:
+      if (b.value == 0) return std::nullopt;
+      result.value = a.value % b.value;
+      break;
+    case BinOp::LSHIFT:
+    case BinOp::ALSHIFT:
+      // The shifted value is only exact if no set bits are shifted out
+      result = {a.value, a.width, a.is_signed};
+      if (a.value != 0) {
+        if (b.value >= 64 || (a.value << b.value) >> b.value != a.value) {
+          return std::nullopt;
+        }
+        result.value = a.value << b.value;
+      }
+      break;
+    case BinOp::RSHIFT:
+    case BinOp::ARSHIFT:
+      // Same for both as the operand is non-negative
+      result = {b.value >= 64 ? 0 : a.value >> b.value, a.width, a.is_signed};
+      break;
+    case BinOp::POW:
+      result = {1, a.width, a.is_signed};
+      for (uint64_t i = 0; i < b.value && result.value != 0; i++) {
+        if (__builtin_mul_overflow(result.value, a.value, &result.value)) {
+          return std::nullopt;
+        }
+        // 1 ** n
+        if (result.value == 1) break;
+      }
+      break;
+  }
+  if (!fits(result.value, result.width, result.is_signed)) return std::nullopt;
+  return result;
+}
+
+// Returns true if `op` leaves its left operand unchanged when the right
+// operand is `value`
+bool is_right_identity(BinOp::BinOp op, uint64_t value) {
+  switch (op) {
+    case BinOp::ADD:
+    case BinOp::SUB:
+    case BinOp::LSHIFT:
+    case BinOp::RSHIFT:
+    case BinOp::ALSHIFT:
+    case BinOp::ARSHIFT:
+      return value == 0;
+    case BinOp::MUL:
+    case BinOp::DIV:
+    case BinOp::POW:
+      return value == 1;
+    default:
+      return false;
+  }
+}
+
+// Self-determined width of `expr` where it can be told from the expression
+// and the nets `widths` of the module, kUnknownWidth otherwise (e.g. for
+// parameters)
+unsigned self_width(const Expression &expr, const NetWidths &widths,
+                    unsigned depth = 0) {
+  // Give up on deep trees rather than recursing through them
+  if (depth > 32) return kUnknownWidth;
+  switch (expr.kind()) {
+    case NodeKind::NUMERIC_LITERAL:
+      return static_cast<const NumericLiteral &>(expr).size;
+    case NodeKind::IDENTIFIER:
+      return net_width(widths, static_cast<const Identifier &>(expr).value);
+    case NodeKind::SLICE: {
+      auto &slice = static_cast<const Slice &>(expr);
+      return range_width(*slice.high_index, *slice.low_index);
+    }
+    case NodeKind::UNARY_OP: {
+      auto &unary_op = static_cast<const UnaryOp &>(expr);
+      switch (unary_op.op) {
+        case UnOp::INVERT:
+        case UnOp::PLUS:
+        case UnOp::MINUS:
+          return self_width(*unary_op.operand, widths, depth + 1);
+        default:
+          return 1;
+      }
+    }
+    case NodeKind::BINARY_OP: {
+      auto &binary_op = static_cast<const BinaryOp &>(expr);
+      switch (binary_op.op) {
+        case BinOp::EQ:
+        case BinOp::NEQ:
+        case BinOp::AND:
+        case BinOp::OR:
+          return 1;
+        case BinOp::LSHIFT:
+        case BinOp::RSHIFT:
+        case BinOp::ALSHIFT:
+        case BinOp::ARSHIFT:
+        case BinOp::POW:
+          return self_width(*binary_op.left, widths, depth + 1);
+        default:
+          return max_width(self_width(*binary_op.left, widths, depth + 1),
+                           self_width(*binary_op.right, widths, depth + 1));
+      }
+    }
+    case NodeKind::TERNARY_OP: {
+      auto &ternary_op = static_cast<const TernaryOp &>(expr);
+      return max_width(self_width(*ternary_op.true_value, widths, depth + 1),
+                       self_width(*ternary_op.false_value, widths, depth + 1));
+    }
+    default:
+      // Selects of identifiers, which may be array elements
+      return kUnknownWidth;
+  }
+}
+
+// Returns true if `kept` is at least as wide as `width`, so replacing an
+// operation on both by `kept` does not narrow it.  The width of an operation
+// reaches its context (e.g. the carry of `a + b` in `(a + b) >> 1` or
+// `(a + b) == c`), so any narrowing would change the result
+bool covers(const Expression &kept, unsigned width, const NetWidths &widths) {
+  unsigned kept_width = self_width(kept, widths);
+  return kept_width != kUnknownWidth && width <= kept_width;
+}
+
+class ConstantFolder : public Transformer {
+  // Nodes that have been entered but not yet left, i.e. the ancestors of the
+  // node being transformed
+  std::vector<const Node *> path;
+  // Declared widths of the nets of the module being transformed, empty for a
+  // lone expression
+  NetWidths widths;
+
+  const Node *parent() const {
+    return path.empty() ? nullptr : path.back();
+  }
+
+  std::unique_ptr<Expression> foldBinaryOp(std::unique_ptr<BinaryOp> node) {
+    std::optional<Constant> left = evaluate(*node->left);
+    std::optional<Constant> right = evaluate(*node->right);
+    if (left && right) {
+      std::optional<Constant> result = fold(node->op, *left, *right);
+      if (!result) return node;
+      bool is_bool = node->op == BinOp::EQ || node->op == BinOp::NEQ ||
+                     node->op == BinOp::AND || node->op == BinOp::OR;
+      return is_bool ? make_bool(result->value)
+                     : make_constant(*result, *node->left);
+    }
+    // Short circuits, the other operand has no side effects
+    if ((node->op == BinOp::AND && ((left && left->value == 0) ||
+                                    (right && right->value == 0))) ||
+        (node->op == BinOp::OR &&
+         ((left && left->value != 0) || (right && right->value != 0)))) {
+      return make_bool(node->op == BinOp::OR);
+    }
+    // Identities, the width and signedness of shifts and powers only depend
+    // on the left operand.  Otherwise the other operand must be as wide as
+    // the literal, or removing it would narrow the operation
+    bool self_typed = node->op == BinOp::LSHIFT ||
+                      node->op == BinOp::RSHIFT ||
+                      node->op == BinOp::ALSHIFT ||
+                      node->op == BinOp::ARSHIFT || node->op == BinOp::POW;
+    if (right && is_right_identity(node->op, right->value) &&
+        (self_typed ||
+         (covers(*node->left, right->width, widths) &&
+          (right->is_signed ||
+           signedness(*node->left, widths) == Signedness::UNSIGNED)))) {
+      return std::move(node->left);
+    }
+    if (left && !self_typed &&
+        ((node->op == BinOp::ADD && left->value == 0) ||
+         (node->op == BinOp::MUL && left->value == 1)) &&
+        covers(*node->right, left->width, widths) &&
+        (left->is_signed ||
+         signedness(*node->right, widths) == Signedness::UNSIGNED)) {
+      return std::move(node->right);
+    }
+    return node;
+  }
+
+  std::unique_ptr<Expression> foldUnaryOp(std::unique_ptr<UnaryOp> node) {
+    std::optional<Constant> operand = evaluate(*node->operand);
+    if (!operand) return node;
+    uint64_t value = operand->value;
+    bool all_ones = operand->width < 64
+                        ? value == (uint64_t(1) << operand->width) - 1
+                        : operand->width == 64 && value == UINT64_MAX;
+    bool parity = __builtin_popcountll(value) & 1;
+    switch (node->op) {
+      case UnOp::NOT:
+        return make_bool(value == 0);
+      case UnOp::AND:
+        return make_bool(all_ones);
+      case UnOp::NAND:
+        return make_bool(!all_ones);
+      case UnOp::OR:
+        return make_bool(value != 0);
+      case UnOp::NOR:
+        return make_bool(value == 0);
+      case UnOp::XOR:
+        return make_bool(parity);
+      case UnOp::NXOR:
+      case UnOp::XNOR:
+        return make_bool(!parity);
+      case UnOp::PLUS:
+        return std::move(node->operand);
+      case UnOp::MINUS:
+        if (value == 0) return std::move(node->operand);
+        return node;
+      case UnOp::INVERT:
+        // Depends on the width of the context
+        return node;
+    }
+    return node;
+  }
+
+  std::unique_ptr<Expression> foldTernaryOp(std::unique_ptr<TernaryOp> node) {
+    std::optional<Constant> cond = evaluate(*node->cond);
+    if (!cond) return node;
+    auto &selected = cond->value ? node->true_value : node->false_value;
+    auto &other = cond->value ? node->false_value : node->true_value;
+    // The result is as wide as the wider value
+    unsigned other_width = self_width(*other, widths);
+    if (other_width == kUnknownWidth ||
+        !covers(*selected, other_width, widths)) {
+      return node;
+    }
+    // The result is unsigned if either value is, so the selected value can
+    // only stand alone if that does not change its signedness
+    if (signedness(*other, widths) != Signedness::SIGNED &&
+        signedness(*selected, widths) != Signedness::UNSIGNED) {
+      return node;
+    }
+    return std::move(selected);
+  }
+
+  std::unique_ptr<Expression> foldSlice(std::unique_ptr<Slice> node) {
+    // A single element slice of a declaration has a different meaning
+    if (parent() && (parent()->kind() == NodeKind::WIRE ||
+                     parent()->kind() == NodeKind::REG)) {
+      return node;
+    }
+    std::optional<Constant> high = evaluate(*node->high_index);
+    std::optional<Constant> low = evaluate(*node->low_index);
+    if (!high || !low || high->value != low->value) return node;
+    return std::make_unique<Index>(std::move(node->id),
+                                   std::move(node->low_index));
+  }
+
+ public:
+  bool enter(Node &node) override {
+    path.push_back(&node);
+    if (node.kind() == NodeKind::MODULE) {
+      widths = detail::net_widths(static_cast<Module &>(node));
+    }
+    return true;
+  }
+
+  void leave(Node &node) override {
+    path.pop_back();
+    if (node.kind() == NodeKind::MODULE) widths.clear();
+  }
+
+  std::unique_ptr<Expression> transform(
+      std::unique_ptr<Expression> node) override {
+    path.pop_back();
+    switch (node->kind()) {
+      case NodeKind::BINARY_OP:
+        return foldBinaryOp(std::unique_ptr<BinaryOp>(
+            static_cast<BinaryOp *>(node.release())));
+      case NodeKind::UNARY_OP:
+        return foldUnaryOp(std::unique_ptr<UnaryOp>(
+            static_cast<UnaryOp *>(node.release())));
+      case NodeKind::TERNARY_OP:
+        return foldTernaryOp(std::unique_ptr<TernaryOp>(
+            static_cast<TernaryOp *>(node.release())));
+      case NodeKind::SLICE:
+        return foldSlice(
+            std::unique_ptr<Slice>(static_cast<Slice *>(node.release())));
+      default:
+        return node;
+    }
+  }
+};
+
+}  // namespace
+
+void fold_constants(Module &module) {
+  ConstantFolder folder;
+  folder.run(module);
+}
+
+void fold_constants(File &file) {
+  ConstantFolder folder;
+  folder.run(file);
+}
+
+std::unique_ptr<Expression> fold_constants(std::unique_ptr<Expression> expr) {
+  ConstantFolder folder;
+  return folder.run(std::move(expr));
+}
+
+}  // namespace verilogAST
@@ -0,0 +1,192 @@
+#include <cstdint>
+#include <unordered_map>
+
+#include "nets.hpp"
+#include "verilogAST/connectivity.hpp"
+#include "verilogAST/passes.hpp"
+#include "verilogAST/transformer.hpp"
+#include "width.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+constexpr size_t kNoStatement = SIZE_MAX;
+
+// Counts the nodes of a tree and the occurrences of a name in it
+class Counter : public Visitor {
+  const Symbol *name;
+
+ public:
+  size_t nodes = 0;
+  size_t uses = 0;
+
+  explicit Counter(const Symbol *name = nullptr) : name(name) {}
+
+  bool enter(const Node &node) override {
+    nodes++;
+    if (name && node.kind() == NodeKind::IDENTIFIER &&
+        static_cast<const Identifier &>(node).value == *name) {
+      uses++;
+    }
+    return true;
+  }
+};
+
+// True for the declarations of wires that are not arrays
+bool is_plain_wire(const Declaration &declaration) {
+  return declaration.kind() == NodeKind::WIRE &&
+         !std::holds_alternative<std::unique_ptr<Index>>(declaration.value) &&
+         !std::holds_alternative<std::unique_ptr<Slice>>(declaration.value);
+}
+
+}  // namespace
+
+size_t inline_wires(Module &module, size_t max_nodes) {
+  if (module.kind() != NodeKind::MODULE) return 0;
+  Connectivity graph(module);
+  detail::NetWidths widths = detail::net_widths(module);
+
+  // Position in the body of each statement, and of the declaration of each
+  // wire that is declared once
+  std::unordered_map<const Node *, size_t> positions;
+  std::unordered_map<Symbol, size_t> declarations;
+  for (size_t i = 0; i < module.body.size(); i++) {
+    auto declaration =
+        std::get_if<std::unique_ptr<Declaration>>(&module.body[i]);
+    if (!declaration) {
+      positions.emplace(
+          std::get<std::unique_ptr<StructuralStatement>>(module.body[i]).get(),
+          i);
+      continue;
+    }
+    auto inserted = declarations.emplace(detail::net_name(**declaration), i);
+    if (!is_plain_wire(**declaration) || !inserted.second) {
+      inserted.first->second = kNoStatement;
+    }
+  }
+  detail::StringPortNames string_port_names = detail::string_port_names(module);
+
+  // Nodes of the right-hand side of each assignment that has been looked at
+  std::unordered_map<const ContinuousAssign *, size_t> sizes;
+  auto size = [&sizes](const ContinuousAssign &assign) {
+    auto inserted = sizes.try_emplace(&assign, 0);
+    if (inserted.second) {
+      Counter counter;
+      walk(*assign.value, counter);
+      inserted.first->second = counter.nodes;
+    }
+    return inserted.first->second;
+  };
+  // The assignment that each inlined assignment was substituted into
+  std::unordered_map<const ContinuousAssign *, ContinuousAssign *> merged;
+  std::vector<bool> removed(module.body.size());
+  size_t inlined = 0;
+  std::vector<detail::ExprInfo> value_infos;
+  std::vector<detail::ExprInfo> reader_infos;
+  detail::Analyzer value_analyzer(value_infos, widths);
+  detail::Analyzer reader_analyzer(reader_infos, widths);
+
+  for (size_t i = 0; i < module.body.size(); i++) {
+    auto declaration =
+        std::get_if<std::unique_ptr<Declaration>>(&module.body[i]);
+    if (!declaration) continue;
+    Symbol name = detail::net_name(**declaration);
+    if (declarations[name] != i) continue;
+    if (detail::in_string_port(string_port_names, name)) continue;
+    Connectivity::NetId net = graph.find(name);
+    if (net == Connectivity::npos) continue;
+    Connectivity::Endpoints drivers = graph.drivers(net);
+    Connectivity::Endpoints loads = graph.loads(net);
+    if (drivers.size() != 1 || loads.size() != 1 ||
+        drivers[0]->kind() != NodeKind::CONTINUOUS_ASSIGN ||
+        loads[0]->kind() != NodeKind::CONTINUOUS_ASSIGN) {
+      continue;
+    }
+    // The graph hands out const nodes of the module, which is not const here
+    auto *driver = const_cast<ContinuousAssign *>(
+        static_cast<const ContinuousAssign *>(drivers[0]));
+    auto *reader = const_cast<ContinuousAssign *>(
+        static_cast<const ContinuousAssign *>(loads[0]));
+    if (!std::holds_alternative<std::unique_ptr<Identifier>>(
+            driver->target)) {
+      continue;
+    }
+    // The reader may itself have been inlined into another assignment
+    for (auto it = merged.find(reader); it != merged.end();
+         it = merged.find(reader)) {
+      reader = it->second;
+    }
+    // A combinational loop
+    if (reader == driver) continue;
+    // An edited prefix, e.g. a delay, has no place in the merged assignment
+    if (driver->prefix() != "assign " || reader->prefix() != "assign ") {
+      continue;
+    }
+    if (size(*driver) + size(*reader) - 1 > max_nodes) continue;
+    Counter target(&name);
+    std::visit([&target](auto &ptr) { walk(*ptr, target); }, reader->target);
+    if (target.uses) continue;
+
+    unsigned width = detail::net_width(widths, name);
+    value_infos.clear();
+    value_analyzer.run(driver->value, 0);
+    const detail::ExprInfo &value = value_infos.back();
+    if (width == detail::kUnknownWidth || value.width != width ||
+        value.is_signed || value.opaque) {
+      continue;
+    }
+
+    reader_infos.clear();
+    reader_analyzer.run(reader->value, 0);
+    detail::compute_contexts(reader_infos, 0, reader_infos.size() - 1,
+                             detail::target_width(widths, reader->target));
+    const detail::ExprInfo *use = nullptr;
+    size_t uses = 0;
+    for (const detail::ExprInfo &info : reader_infos) {
+      if (info.expr->kind() == NodeKind::IDENTIFIER &&
+          static_cast<const Identifier *>(info.expr)->value == name) {
+        use = &info;
+        uses++;
+      }
+    }
+    if (uses != 1 || !use->slot ||
+        !(value.stable || use->context <= value.width)) {
+      continue;
+    }
+
+    *use->slot = std::move(driver->value);
+    for (size_t j = use->parent; j != detail::kNoParent;
+         j = reader_infos[j].parent) {
+      reader_infos[j].expr->invalidateHash();
+    }
+    reader->invalidateHash();
+    sizes[reader] += sizes[driver] - 1;
+    merged.emplace(driver, reader);
+    removed[i] = true;
+    removed[positions[driver]] = true;
+    inlined++;
+  }
+  if (!inlined) return 0;
+
+  size_t kept = 0;
+  for (size_t i = 0; i < module.body.size(); i++) {
+    if (!removed[i]) module.body[kept++] = std::move(module.body[i]);
+  }
+  module.body.erase(module.body.begin() + kept, module.body.end());
+  module.invalidateHash();
+  return inlined;
+}
+
+size_t inline_wires(File &file, size_t max_nodes) {
+  size_t inlined = 0;
+  for (auto &module : file.modules) {
+    if (module->kind() == NodeKind::MODULE) {
+      inlined += inline_wires(static_cast<Module &>(*module), max_nodes);
+    }
+  }
+  if (inlined) file.invalidateHash();
+  return inlined;
+}
+
+}  // namespace verilogAST
@@ -0,0 +1,65 @@
+// Internal helper for reading whole files through a memory mapping
+#pragma once
+#ifndef VERILOGAST_MAPPED_FILE_H
+#define VERILOGAST_MAPPED_FILE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace verilogAST {
+namespace detail {
+
+// Read-only mapping of a whole file, errors are reported as std::system_error
+// prefixed with `what`
+class MappedFile {
+  void *data = MAP_FAILED;
+  size_t size = 0;
+
+  static std::system_error os_error(const std::string &what) {
+    return std::system_error(errno, std::generic_category(), what);
+  }
+
+ public:
+  MappedFile(const std::string &path, const std::string &what) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw os_error(what + " cannot open " + path);
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      std::system_error error = os_error(what + " fstat failed");
+      close(fd);
+      throw error;
+    }
+    size = info.st_size;
+    // Empty files cannot be mapped
+    if (size > 0) {
+      data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    std::system_error error = os_error(what + " mmap failed");
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (size == 0) return;
+    if (data == MAP_FAILED) throw error;
+    madvise(data, size, MADV_SEQUENTIAL);
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() {
+    if (data != MAP_FAILED) munmap(data, size);
+  }
+
+  std::string_view view() const {
+    if (data == MAP_FAILED) return {};
+    return std::string_view(static_cast<const char *>(data), size);
+  }
+};
+
+}  // namespace detail
+}  // namespace verilogAST
+#endif
@@ -0,0 +1,228 @@
+#include "verilogAST/memory_usage.hpp"
+
+#include "verilogAST/transformer.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+// Bytes allocated for the characters of `str`, zero if they are stored within
+// the string object
+size_t heap_bytes(const std::string &str) {
+  const char *object = reinterpret_cast<const char *>(&str);
+  if (str.data() >= object && str.data() < object + sizeof(str)) return 0;
+  return str.capacity() + 1;
+}
+
+template <typename T>
+size_t heap_bytes(const std::vector<T> &vector) {
+  return vector.capacity() * sizeof(T);
+}
+
+void add_module(const Module &module, MemoryUsage::Bytes &bytes) {
+  bytes.strings += heap_bytes(module.name);
+  bytes.containers += heap_bytes(module.ports) + heap_bytes(module.body) +
+                      heap_bytes(module.parameters);
+}
+
+void append_bytes(std::string &out, size_t nodes,
+                  const MemoryUsage::Bytes &bytes) {
+  out += "{\"nodes\": " + std::to_string(nodes) +
+         ", \"objects\": " + std::to_string(bytes.objects) +
+         ", \"strings\": " + std::to_string(bytes.strings) +
+         ", \"containers\": " + std::to_string(bytes.containers) +
+         ", \"indirection\": " + std::to_string(bytes.indirection) +
+         ", \"bytes\": " + std::to_string(bytes.total()) + "}";
+}
+
+}  // namespace
+
+MemoryUsage::Bytes &MemoryUsage::Bytes::operator+=(const Bytes &other) {
+  objects += other.objects;
+  strings += other.strings;
+  containers += other.containers;
+  indirection += other.indirection;
+  return *this;
+}
+
+void MemoryUsage::add(const Node &node) {
+  nodes[node.kind()]++;
+  Bytes &bytes = this->bytes[node.kind()];
+  size_t objects = bytes.objects;
+  // The emission cache of a module
+  Bytes cache;
+  auto add_cache = [&cache](const Module &module) {
+    if (!module.emission_cache) return;
+    cache.objects += sizeof(Module::EmissionCache);
+    cache.strings += heap_bytes(module.emission_cache->text);
+    cache.strings += heap_bytes(module.emission_cache->name);
+  };
+  switch (node.kind()) {
+    case NodeKind::NUMERIC_LITERAL: {
+      auto &literal = static_cast<const NumericLiteral &>(node);
+      bytes.objects += sizeof(NumericLiteral);
+      if (literal.form == NumericLiteral::DIGITS) {
+        bytes.strings += heap_bytes(literal.text);
+      } else if (literal.form == NumericLiteral::WORDS) {
+        bytes.containers += (literal.numWords() + 1) * sizeof(uint64_t);
+      }
+      break;
+    }
+    case NodeKind::IDENTIFIER:
+      bytes.objects += sizeof(Identifier);
+      break;
+    case NodeKind::STRING:
+      bytes.objects += sizeof(String);
+      bytes.strings += heap_bytes(static_cast<const String &>(node).value);
+      break;
+    case NodeKind::INDEX:
+      bytes.objects += sizeof(Index);
+      break;
+    case NodeKind::SLICE:
+      bytes.objects += sizeof(Slice);
+      break;
+    case NodeKind::BINARY_OP:
+      bytes.objects += sizeof(BinaryOp);
+      break;
+    case NodeKind::UNARY_OP:
+      bytes.objects += sizeof(UnaryOp);
+      break;
+    case NodeKind::TERNARY_OP:
+      bytes.objects += sizeof(TernaryOp);
+      break;
+    case NodeKind::CONCAT:
+      bytes.objects += sizeof(Concat);
+      bytes.containers += heap_bytes(static_cast<const Concat &>(node).args);
+      break;
+    case NodeKind::NEG_EDGE:
+      bytes.objects += sizeof(NegEdge);
+      break;
+    case NodeKind::POS_EDGE:
+      bytes.objects += sizeof(PosEdge);
+      break;
+    case NodeKind::VECTOR:
+      bytes.objects += sizeof(Vector);
+      break;
+    case NodeKind::PORT:
+      bytes.objects += sizeof(Port);
+      break;
+    case NodeKind::STRING_PORT:
+      bytes.objects += sizeof(StringPort);
+      bytes.strings += heap_bytes(static_cast<const StringPort &>(node).value);
+      break;
+    case NodeKind::SINGLE_LINE_COMMENT:
+      bytes.objects += sizeof(SingleLineComment);
+      bytes.strings +=
+          heap_bytes(static_cast<const SingleLineComment &>(node).value);
+      break;
+    case NodeKind::BLOCK_COMMENT:
+      bytes.objects += sizeof(BlockComment);
+      bytes.strings +=
+          heap_bytes(static_cast<const BlockComment &>(node).value);
+      break;
+    case NodeKind::MODULE_INSTANTIATION: {
+      auto &inst = static_cast<const ModuleInstantiation &>(node);
+      bytes.objects += sizeof(ModuleInstantiation);
+      bytes.containers +=
+          heap_bytes(inst.parameters) + heap_bytes(inst.connections);
+      break;
+    }
+    case NodeKind::WIRE:
+      bytes.objects += sizeof(Wire);
+      break;
+    case NodeKind::REG:
+      bytes.objects += sizeof(Reg);
+      break;
+    case NodeKind::CONTINUOUS_ASSIGN:
+      bytes.objects += sizeof(ContinuousAssign);
+      break;
+    case NodeKind::BLOCKING_ASSIGN:
+      bytes.objects += sizeof(BlockingAssign);
+      break;
+    case NodeKind::NON_BLOCKING_ASSIGN:
+      bytes.objects += sizeof(NonBlockingAssign);
+      break;
+    case NodeKind::STAR:
+      bytes.objects += sizeof(Star);
+      break;
+    case NodeKind::ALWAYS: {
+      auto &always = static_cast<const Always &>(node);
+      bytes.objects += sizeof(Always);
+      bytes.containers +=
+          heap_bytes(always.sensitivity_list) + heap_bytes(always.body);
+      break;
+    }
+    case NodeKind::MODULE: {
+      auto &module = static_cast<const Module &>(node);
+      bytes.objects += sizeof(Module);
+      add_module(module, bytes);
+      add_cache(module);
+      break;
+    }
+    case NodeKind::STRING_BODY_MODULE: {
+      auto &module = static_cast<const StringBodyModule &>(node);
+      bytes.objects += sizeof(StringBodyModule);
+      add_module(module, bytes);
+      add_cache(module);
+      bytes.strings += heap_bytes(module.body);
+      break;
+    }
+    case NodeKind::STRING_MODULE:
+      bytes.objects += sizeof(StringModule);
+      bytes.strings +=
+          heap_bytes(static_cast<const StringModule &>(node).definition);
+      break;
+    case NodeKind::FILE:
+      bytes.objects += sizeof(File);
+      bytes.containers += heap_bytes(static_cast<const File &>(node).modules);
+      break;
+  }
+  // Nodes are allocated rounded up to the alignment (see Node::operator new)
+  size_t object = bytes.objects - objects;
+  size_t allocation =
+      (object + Arena::kAlignment - 1) & ~(Arena::kAlignment - 1);
+  bytes.indirection += allocation - object;
+  bytes += cache;
+}
+
+MemoryUsage::Bytes MemoryUsage::total() const {
+  Bytes total;
+  for (const Bytes &b : bytes) total += b;
+  return total;
+}
+
+std::string MemoryUsage::toJson() const {
+  size_t count = 0;
+  for (size_t n : nodes) count += n;
+  std::string out = "{\"total\": ";
+  append_bytes(out, count, total());
+  out += ", \"classes\": {";
+  bool first = true;
+  for (size_t i = 0; i < kNumNodeKinds; i++) {
+    if (!nodes[i]) continue;
+    if (!first) out += ", ";
+    first = false;
+    out += '"';
+    out += kind_name(static_cast<NodeKind::NodeKind>(i));
+    out += "\": ";
+    append_bytes(out, nodes[i], bytes[i]);
+  }
+  out += "}}";
+  return out;
+}
+
+MemoryUsage Node::memoryUsage() const {
+  class Counter : public Visitor {
+   public:
+    MemoryUsage usage;
+
+    bool enter(const Node &node) override {
+      usage.add(node);
+      return true;
+    }
+  } counter;
+  walk(*this, counter);
+  return counter.usage;
+}
+
+}  // namespace verilogAST
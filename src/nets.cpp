@@ -0,0 +1,60 @@
+#include "nets.hpp"
+
+namespace verilogAST {
+namespace detail {
+
+namespace {
+
+bool is_letter(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool is_identifier_char(char c) {
+  return is_letter(c) || (c >= '0' && c <= '9') || c == '$';
+}
+
+// Characters of the words of literals, including their base
+bool is_literal_char(char c) { return is_identifier_char(c) || c == '\''; }
+
+bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' ||
+         c == '\v';
+}
+
+// Adds the identifiers of `text` to `names`.  The words of literals (`8'hff`)
+// and system tasks (`$display`) are skipped whole, so that their digits and
+// base are not taken for names.
+void scan(std::string_view text, StringPortNames &names) {
+  size_t i = 0;
+  while (i < text.size()) {
+    char c = text[i];
+    size_t start = i;
+    if (c == '\\') {
+      start = ++i;
+      while (i < text.size() && !is_space(text[i])) i++;
+      if (i > start) names.insert(text.substr(start, i - start));
+    } else if (is_letter(c)) {
+      while (i < text.size() && is_identifier_char(text[i])) i++;
+      names.insert(text.substr(start, i - start));
+    } else if (is_literal_char(c)) {
+      while (i < text.size() && is_literal_char(text[i])) i++;
+    } else {
+      i++;
+    }
+  }
+}
+
+}  // namespace
+
+StringPortNames string_port_names(const Module &module) {
+  StringPortNames names;
+  for (auto &port : module.ports) {
+    if (port->kind() == NodeKind::STRING_PORT) {
+      scan(static_cast<const StringPort &>(*port).value, names);
+    }
+  }
+  return names;
+}
+
+}  // namespace detail
+}  // namespace verilogAST
@@ -0,0 +1,48 @@
+// Internal helpers for the names of the nets of a module, shared by the passes
+#pragma once
+#ifndef VERILOGAST_NETS_H
+#define VERILOGAST_NETS_H
+
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <variant>
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+namespace detail {
+
+// Name of the net of a port, declaration or assignment target
+template <typename T>
+Symbol net_name(const std::unique_ptr<T> &ptr) {
+  if constexpr (std::is_same_v<T, Identifier>) {
+    return ptr->value;
+  } else {
+    return ptr->id->value;
+  }
+}
+
+template <typename... Ts>
+Symbol net_name(const std::variant<std::unique_ptr<Ts>...> &value) {
+  return std::visit([](auto &ptr) { return net_name(ptr); }, value);
+}
+
+inline Symbol net_name(const Declaration &declaration) {
+  return net_name(declaration.value);
+}
+
+// Identifiers written in the StringPorts of `module`, which are not parsed.
+// Escaped identifiers are included without their backslash.  The views point
+// into the ports.
+typedef std::unordered_set<std::string_view> StringPortNames;
+
+StringPortNames string_port_names(const Module &module);
+
+inline bool in_string_port(const StringPortNames &names, Symbol name) {
+  return names.count(name.str()) != 0;
+}
+
+}  // namespace detail
+}  // namespace verilogAST
+#endif
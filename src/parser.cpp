@@ -0,0 +1,882 @@
+#include "verilogAST/parser.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <iterator>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "mapped_file.hpp"
+#include "precedence.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+// Character classes used by the lexer
+enum : uint8_t { kSpace = 1, kIdStart = 2, kIdPart = 4, kDigit = 8 };
+
+constexpr std::array<uint8_t, 256> make_char_classes() {
+  std::array<uint8_t, 256> classes{};
+  for (char c : {' ', '\t', '\n', '\r', '\f', '\v'}) classes[c] = kSpace;
+  for (int c = 'a'; c <= 'z'; c++) classes[c] = kIdStart | kIdPart;
+  for (int c = 'A'; c <= 'Z'; c++) classes[c] = kIdStart | kIdPart;
+  for (int c = '0'; c <= '9'; c++) classes[c] = kIdPart | kDigit;
+  classes['_'] = kIdStart | kIdPart;
+  classes['$'] = kIdStart | kIdPart;
+  return classes;
+}
+
+constexpr std::array<uint8_t, 256> kCharClasses = make_char_classes();
+
+inline bool has_class(char c, uint8_t mask) {
+  return kCharClasses[static_cast<uint8_t>(c)] & mask;
+}
+
+// Operators and punctuation of more than one character, longest first
+constexpr std::string_view kLongSymbols[] = {
+    "<<<", ">>>", "**", "<<", ">>", "<=", ">=", "==", "!=",
+    "&&",  "||",  "~&", "~|", "~^", "^~"};
+constexpr std::string_view kShortSymbols = "()[]{},;:?@#.=!~&|^+-*/%<>";
+
+namespace TokenKind {
+enum TokenKind {
+  END,
+  // Simple identifier or keyword
+  IDENTIFIER,
+  // Escaped identifier, the text excludes the backslash
+  ESCAPED_IDENTIFIER,
+  NUMBER,
+  // The text excludes the quotes
+  STRING,
+  SYMBOL
+};
+}
+
+struct Token {
+  TokenKind::TokenKind kind = TokenKind::END;
+  std::string_view text;
+  bool is(std::string_view symbol) const {
+    return kind == TokenKind::SYMBOL && text == symbol;
+  }
+  bool isKeyword(std::string_view keyword) const {
+    return kind == TokenKind::IDENTIFIER && text == keyword;
+  }
+};
+
+struct BinaryOperator {
+  std::string_view text;
+  BinOp::BinOp op;
+};
+
+using detail::kBinOpPrecedence;
+using detail::kTernaryPrecedence;
+using detail::kUnaryPrecedence;
+
+constexpr BinaryOperator kBinaryOperators[] = {
+    {"||", BinOp::OR},      {"&&", BinOp::AND},      {"==", BinOp::EQ},
+    {"!=", BinOp::NEQ},     {"<<", BinOp::LSHIFT},   {">>", BinOp::RSHIFT},
+    {"<<<", BinOp::ALSHIFT}, {">>>", BinOp::ARSHIFT}, {"+", BinOp::ADD},
+    {"-", BinOp::SUB},      {"*", BinOp::MUL},       {"/", BinOp::DIV},
+    {"%", BinOp::MOD},      {"**", BinOp::POW}};
+
+struct UnaryOperator {
+  std::string_view text;
+  UnOp::UnOp op;
+};
+
+constexpr UnaryOperator kUnaryOperators[] = {
+    {"!", UnOp::NOT},   {"~", UnOp::INVERT}, {"&", UnOp::AND},
+    {"~&", UnOp::NAND}, {"|", UnOp::OR},     {"~|", UnOp::NOR},
+    {"^", UnOp::XOR},   {"~^", UnOp::NXOR},  {"^~", UnOp::XNOR},
+    {"+", UnOp::PLUS},  {"-", UnOp::MINUS}};
+
+const BinaryOperator *find_binary_operator(const Token &token) {
+  if (token.kind != TokenKind::SYMBOL) return nullptr;
+  for (auto &op : kBinaryOperators) {
+    if (op.text == token.text) return &op;
+  }
+  return nullptr;
+}
+
+const UnaryOperator *find_unary_operator(const Token &token) {
+  if (token.kind != TokenKind::SYMBOL) return nullptr;
+  for (auto &op : kUnaryOperators) {
+    if (op.text == token.text) return &op;
+  }
+  return nullptr;
+}
+
+// Splits source into tokens without copying, the tokens point into the source
+class Lexer {
+  const char *cur;
+  const char *end;
+
+ public:
+  // Start of the whole source, used to compute line numbers
+  const char *const source;
+
+  Lexer(const char *source, std::string_view range)
+      : cur(range.data()), end(range.data() + range.size()), source(source){};
+
+  [[noreturn]] void error(const char *where, std::string_view message) const {
+    size_t line = 1 + std::count(source, where, '\n');
+    throw std::runtime_error("vAST::parse: line " + std::to_string(line) +
+                             ": " + std::string(message));
+  }
+
+  Token next() {
+    skipSpace();
+    if (cur == end) return {TokenKind::END, {cur, 0}};
+    const char *start = cur;
+    char c = *cur;
+    if (has_class(c, kIdStart)) {
+      while (++cur != end && has_class(*cur, kIdPart)) {
+      }
+      return {TokenKind::IDENTIFIER, {start, size_t(cur - start)}};
+    }
+    if (has_class(c, kDigit) || c == '\'') return number();
+    if (c == '\\') {
+      while (++cur != end && !has_class(*cur, kSpace)) {
+      }
+      if (cur - start == 1) error(start, "empty escaped identifier");
+      return {TokenKind::ESCAPED_IDENTIFIER,
+              {start + 1, size_t(cur - start - 1)}};
+    }
+    if (c == '"') {
+      while (++cur != end && *cur != '"') {
+        if (*cur == '\\' && cur + 1 != end) cur++;
+      }
+      if (cur == end) error(start, "unterminated string");
+      cur++;
+      return {TokenKind::STRING, {start + 1, size_t(cur - start - 2)}};
+    }
+    std::string_view rest(cur, end - cur);
+    for (std::string_view symbol : kLongSymbols) {
+      if (rest.substr(0, symbol.size()) == symbol) {
+        cur += symbol.size();
+        return {TokenKind::SYMBOL, {start, symbol.size()}};
+      }
+    }
+    if (kShortSymbols.find(c) == std::string_view::npos) {
+      error(start, "unexpected character '" + std::string(1, c) + "'");
+    }
+    cur++;
+    return {TokenKind::SYMBOL, {start, 1}};
+  }
+
+ private:
+  void skipSpace() {
+    while (cur != end) {
+      if (has_class(*cur, kSpace)) {
+        cur++;
+      } else if (*cur == '/' && cur + 1 != end && cur[1] == '/') {
+        cur = std::find(cur, end, '\n');
+      } else if (*cur == '/' && cur + 1 != end && cur[1] == '*') {
+        std::string_view rest(cur + 2, end - cur - 2);
+        size_t close = rest.find("*/");
+        if (close == std::string_view::npos) error(cur, "unterminated comment");
+        cur += close + 4;
+      } else {
+        return;
+      }
+    }
+  }
+  // `[size]'[s]radix value` or `digits`, checked by `Parser::literal`
+  // `[size]['[s][radix]]value`, checked by `Parser::literal`
+  Token number() {
+    const char *start = cur;
+    while (cur != end && (has_class(*cur, kDigit) || *cur == '_')) cur++;
+    if (cur != end && *cur == '\'') {
+      cur++;
+      while (cur != end && has_class(*cur, kIdPart)) cur++;
+    }
+    return {TokenKind::NUMBER, {start, size_t(cur - start)}};
+  }
+};
+
+template <typename T>
+constexpr NodeKind::NodeKind kind_of();
+template <>
+constexpr NodeKind::NodeKind kind_of<Identifier>() {
+  return NodeKind::IDENTIFIER;
+}
+template <>
+constexpr NodeKind::NodeKind kind_of<Index>() {
+  return NodeKind::INDEX;
+}
+template <>
+constexpr NodeKind::NodeKind kind_of<Slice>() {
+  return NodeKind::SLICE;
+}
+template <>
+constexpr NodeKind::NodeKind kind_of<Concat>() {
+  return NodeKind::CONCAT;
+}
+
+// Moves `expr` into `result` if its class is one of the alternatives
+template <typename... Ts>
+bool narrow(std::unique_ptr<Expression> &expr,
+            std::variant<std::unique_ptr<Ts>...> &result) {
+  return ((expr->kind() == kind_of<Ts>()
+               ? (result = std::unique_ptr<Ts>(static_cast<Ts *>(
+                      expr.release())),
+                  true)
+               : false) ||
+          ...);
+}
+
+typedef std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
+                     std::unique_ptr<Slice>>
+    AssignTarget;
+typedef std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
+                     std::unique_ptr<Slice>, std::unique_ptr<Vector>>
+    DeclarationValue;
+
+// Operator or open bracket waiting for its operands while parsing an
+// expression
+struct PendingOp {
+  enum Kind {
+    BINARY,
+    UNARY,
+    // `cond ? true_value` waiting for the `:`
+    TERNARY_CONDITION,
+    TERNARY,
+    PAREN,
+    CONCAT,
+    INDEX,
+    SLICE
+  } kind;
+  // Zero for brackets, which are never reduced by an operator
+  unsigned precedence;
+  // BinOp or UnOp
+  int op;
+  // CONCAT: number of operands before the `{`
+  size_t first_operand = 0;
+  // INDEX and SLICE: the indexed name
+  std::unique_ptr<Identifier> id;
+
+  PendingOp(Kind kind, unsigned precedence, int op = 0)
+      : kind(kind), precedence(precedence), op(op){};
+};
+
+class Parser {
+  Lexer lexer;
+  Token token;
+  SymbolTable &symbols;
+  // Names already interned by this parser, saves locking the table
+  std::unordered_map<std::string_view, Symbol> interned;
+  // Reused by `expression`
+  std::vector<PendingOp> ops;
+  std::vector<std::unique_ptr<Expression>> operands;
+
+ public:
+  Parser(const char *source, std::string_view range, SymbolTable &symbols)
+      : lexer(source, range), symbols(symbols) {
+    advance();
+  }
+
+  void parseModules(std::vector<std::unique_ptr<AbstractModule>> &modules) {
+    while (token.kind != TokenKind::END) modules.push_back(module());
+  }
+
+ private:
+  void advance() { token = lexer.next(); }
+
+  [[noreturn]] void error(std::string_view message) {
+    lexer.error(token.text.data(), message);
+  }
+
+  [[noreturn]] void unexpected(std::string_view expected) {
+    std::string found = token.kind == TokenKind::END
+                            ? "end of input"
+                            : "'" + std::string(token.text) + "'";
+    error("expected " + std::string(expected) + " but found " + found);
+  }
+
+  bool accept(std::string_view symbol) {
+    if (!token.is(symbol)) return false;
+    advance();
+    return true;
+  }
+
+  void expect(std::string_view symbol) {
+    if (!accept(symbol)) unexpected("'" + std::string(symbol) + "'");
+  }
+
+  bool acceptKeyword(std::string_view keyword) {
+    if (!token.isKeyword(keyword)) return false;
+    advance();
+    return true;
+  }
+
+  void expectKeyword(std::string_view keyword) {
+    if (!acceptKeyword(keyword)) unexpected("'" + std::string(keyword) + "'");
+  }
+
+  Symbol intern(std::string_view name) {
+    auto it = interned.find(name);
+    if (it != interned.end()) return it->second;
+    Symbol symbol = symbols.intern(name);
+    interned.emplace(name, symbol);
+    return symbol;
+  }
+
+  std::unique_ptr<Identifier> identifier() {
+    if (token.kind == TokenKind::ESCAPED_IDENTIFIER) {
+      auto id = std::make_unique<Identifier>(intern(token.text));
+      advance();
+      return id;
+    }
+    if (token.kind != TokenKind::IDENTIFIER) unexpected("an identifier");
+    Symbol symbol = intern(token.text);
+    // Simple identifiers only need escaping if they are keywords
+    if (symbol.needsEscape()) unexpected("an identifier");
+    advance();
+    return std::make_unique<Identifier>(symbol);
+  }
+
+  // Name that is stored as a string (or symbol) and emitted verbatim
+  std::string rawName() {
+    std::string name;
+    if (token.kind == TokenKind::ESCAPED_IDENTIFIER) {
+      name.reserve(token.text.size() + 2);
+      name += '\\';
+      name += token.text;
+      name += ' ';
+    } else if (token.kind == TokenKind::IDENTIFIER &&
+               !Identifier::needsEscape(token.text)) {
+      name = token.text;
+    } else {
+      unexpected("a name");
+    }
+    advance();
+    return name;
+  }
+
+  // Interned `rawName`, plain names go through the parser's own cache
+  Symbol rawSymbol() {
+    if (token.kind == TokenKind::IDENTIFIER &&
+        !Identifier::needsEscape(token.text)) {
+      Symbol symbol = intern(token.text);
+      advance();
+      return symbol;
+    }
+    return symbols.intern(rawName());
+  }
+
+  std::unique_ptr<NumericLiteral> literal() {
+    std::string_view text = token.text;
+    size_t quote = text.find('\'');
+    if (quote == std::string_view::npos) {
+      advance();
+      return std::make_unique<NumericLiteral>(std::string(text));
+    }
+    unsigned size = 32;
+    if (quote > 0) {
+      auto [end, ec] = std::from_chars(text.data(), text.data() + quote, size);
+      if (ec != std::errc() || end != text.data() + quote || size == 0) {
+        error("invalid literal size '" + std::string(text) + "'");
+      }
+    }
+    std::string_view rest = text.substr(quote + 1);
+    bool is_signed = !rest.empty() && (rest[0] == 's' || rest[0] == 'S');
+    if (is_signed) rest.remove_prefix(1);
+    Radix radix;
+    switch (rest.empty() ? '\0' : rest[0]) {
+      case 'b':
+      case 'B':
+        radix = BINARY;
+        break;
+      case 'o':
+      case 'O':
+        radix = OCTAL;
+        break;
+      case 'h':
+      case 'H':
+        radix = HEX;
+        break;
+      case 'd':
+      case 'D':
+        radix = DECIMAL;
+        break;
+      default:
+        // The base is required after the quote
+        error("invalid literal '" + std::string(text) + "'");
+    }
+    rest.remove_prefix(1);
+    if (rest.empty()) error("invalid literal '" + std::string(text) + "'");
+    advance();
+    return std::make_unique<NumericLiteral>(std::string(rest), size, is_signed,
+                                            radix);
+  }
+
+  // Applies the operator on top of `ops` to its operands
+  void reduceTop() {
+    PendingOp op = std::move(ops.back());
+    ops.pop_back();
+    std::unique_ptr<Expression> result;
+    switch (op.kind) {
+      case PendingOp::BINARY: {
+        auto right = std::move(operands.back());
+        operands.pop_back();
+        result = std::make_unique<BinaryOp>(std::move(operands.back()),
+                                            BinOp::BinOp(op.op),
+                                            std::move(right));
+        break;
+      }
+      case PendingOp::UNARY:
+        result = std::make_unique<UnaryOp>(std::move(operands.back()),
+                                           UnOp::UnOp(op.op));
+        break;
+      default: {
+        // TERNARY
+        auto false_value = std::move(operands.back());
+        operands.pop_back();
+        auto true_value = std::move(operands.back());
+        operands.pop_back();
+        result = std::make_unique<TernaryOp>(std::move(operands.back()),
+                                             std::move(true_value),
+                                             std::move(false_value));
+        break;
+      }
+    }
+    operands.back() = std::move(result);
+  }
+
+  // Reduces the operators on top of `ops` that bind at least as tightly as
+  // `precedence`, stopping at the innermost open bracket
+  void reduce(unsigned precedence) {
+    while (!ops.empty() && ops.back().precedence >= precedence) reduceTop();
+  }
+
+  PendingOp::Kind innermost() const {
+    return ops.empty() ? PendingOp::BINARY : ops.back().kind;
+  }
+
+  // Operator precedence parser with explicit operator and operand stacks
+  std::unique_ptr<Expression> expression() {
+    ops.clear();
+    operands.clear();
+    for (;;) {
+      // Prefix operators and opening brackets
+      for (;;) {
+        if (const UnaryOperator *op = find_unary_operator(token)) {
+          ops.emplace_back(PendingOp::UNARY, kUnaryPrecedence, op->op);
+        } else if (token.is("(")) {
+          ops.emplace_back(PendingOp::PAREN, 0);
+        } else if (token.is("{")) {
+          ops.emplace_back(PendingOp::CONCAT, 0);
+          ops.back().first_operand = operands.size();
+        } else {
+          break;
+        }
+        advance();
+      }
+
+      // Operand
+      if (token.kind == TokenKind::NUMBER) {
+        operands.push_back(literal());
+      } else if (token.kind == TokenKind::STRING) {
+        operands.push_back(std::make_unique<String>(std::string(token.text)));
+        advance();
+      } else if (token.kind == TokenKind::IDENTIFIER ||
+                 token.kind == TokenKind::ESCAPED_IDENTIFIER) {
+        auto id = identifier();
+        if (accept("[")) {
+          ops.emplace_back(PendingOp::INDEX, 0);
+          ops.back().id = std::move(id);
+          continue;
+        }
+        operands.push_back(std::move(id));
+      } else {
+        unexpected("an expression");
+      }
+
+      // Binary operators and closing brackets
+      for (;;) {
+        if (const BinaryOperator *op = find_binary_operator(token)) {
+          unsigned precedence = kBinOpPrecedence[op->op];
+          reduce(precedence);
+          ops.emplace_back(PendingOp::BINARY, precedence, op->op);
+          advance();
+          break;
+        }
+        if (token.is("?")) {
+          // Right associative
+          reduce(kTernaryPrecedence + 1);
+          ops.emplace_back(PendingOp::TERNARY_CONDITION, 0);
+          advance();
+          break;
+        }
+        reduce(kTernaryPrecedence);
+        PendingOp::Kind open = innermost();
+        if (token.is(":") && open == PendingOp::TERNARY_CONDITION) {
+          ops.back().kind = PendingOp::TERNARY;
+          ops.back().precedence = kTernaryPrecedence;
+          advance();
+          break;
+        }
+        if (token.is(":") && open == PendingOp::INDEX) {
+          ops.back().kind = PendingOp::SLICE;
+          advance();
+          break;
+        }
+        if (token.is(",") && open == PendingOp::CONCAT) {
+          advance();
+          break;
+        }
+        if (token.is(")") && open == PendingOp::PAREN) {
+          ops.pop_back();
+          advance();
+          continue;
+        }
+        if (token.is("]") && open == PendingOp::INDEX) {
+          auto index = std::move(operands.back());
+          operands.back() = std::make_unique<Index>(std::move(ops.back().id),
+                                                    std::move(index));
+          ops.pop_back();
+          advance();
+          continue;
+        }
+        if (token.is("]") && open == PendingOp::SLICE) {
+          auto low = std::move(operands.back());
+          operands.pop_back();
+          auto high = std::move(operands.back());
+          operands.back() = std::make_unique<Slice>(
+              std::move(ops.back().id), std::move(high), std::move(low));
+          ops.pop_back();
+          advance();
+          continue;
+        }
+        if (token.is("}") && open == PendingOp::CONCAT) {
+          std::vector<std::unique_ptr<Expression>> args(
+              std::make_move_iterator(operands.begin() +
+                                      ops.back().first_operand),
+              std::make_move_iterator(operands.end()));
+          operands.resize(ops.back().first_operand);
+          operands.push_back(std::make_unique<Concat>(std::move(args)));
+          ops.pop_back();
+          advance();
+          continue;
+        }
+        // End of the expression
+        if (!ops.empty()) {
+          switch (ops.back().kind) {
+            case PendingOp::TERNARY_CONDITION:
+              unexpected("':'");
+            case PendingOp::PAREN:
+              unexpected("')'");
+            case PendingOp::CONCAT:
+              unexpected("'}'");
+            default:
+              unexpected("']'");
+          }
+        }
+        return std::move(operands.back());
+      }
+    }
+  }
+
+  template <typename Variant>
+  Variant narrowed(std::string_view what) {
+    const char *where = token.text.data();
+    std::unique_ptr<Expression> expr = expression();
+    Variant result;
+    if (!narrow(expr, result)) {
+      lexer.error(where, "invalid " + std::string(what));
+    }
+    return result;
+  }
+
+  std::unique_ptr<AbstractPort> port() {
+    Direction direction;
+    if (acceptKeyword("input")) {
+      direction = INPUT;
+    } else if (acceptKeyword("output")) {
+      direction = OUTPUT;
+    } else if (acceptKeyword("inout")) {
+      direction = INOUT;
+    } else {
+      unexpected("a port direction");
+    }
+    PortType data_type = WIRE;
+    if (acceptKeyword("reg")) {
+      data_type = REG;
+    } else {
+      acceptKeyword("wire");
+    }
+    if (accept("[")) {
+      auto msb = expression();
+      expect(":");
+      auto lsb = expression();
+      expect("]");
+      auto id = identifier();
+      return std::make_unique<Port>(
+          std::make_unique<Vector>(std::move(id), std::move(msb),
+                                   std::move(lsb)),
+          direction, data_type);
+    }
+    return std::make_unique<Port>(identifier(), direction, data_type);
+  }
+
+  // The value of a declaration, after the `wire` or `reg`
+  DeclarationValue declarationValue() {
+    DeclarationValue value;
+    if (accept("[")) {
+      auto msb = expression();
+      expect(":");
+      auto lsb = expression();
+      expect("]");
+      auto id = identifier();
+      value = std::make_unique<Vector>(std::move(id), std::move(msb),
+                                       std::move(lsb));
+    } else {
+      auto id = identifier();
+      if (accept("[")) {
+        auto high = expression();
+        if (accept(":")) {
+          value = std::make_unique<Slice>(std::move(id), std::move(high),
+                                          expression());
+        } else {
+          value = std::make_unique<Index>(std::move(id), std::move(high));
+        }
+        expect("]");
+      } else {
+        value = std::move(id);
+      }
+    }
+    expect(";");
+    return value;
+  }
+
+  std::unique_ptr<Declaration> declaration() {
+    if (acceptKeyword("wire")) {
+      return std::make_unique<Wire>(declarationValue());
+    }
+    expectKeyword("reg");
+    return std::make_unique<Reg>(declarationValue());
+  }
+
+  std::unique_ptr<Always> always() {
+    expect("@");
+    std::vector<
+        std::variant<std::unique_ptr<Identifier>, std::unique_ptr<PosEdge>,
+                     std::unique_ptr<NegEdge>, std::unique_ptr<Star>>>
+        sensitivity_list;
+    if (accept("*")) {
+      sensitivity_list.push_back(std::make_unique<Star>());
+    } else {
+      expect("(");
+      do {
+        if (accept("*")) {
+          sensitivity_list.push_back(std::make_unique<Star>());
+        } else if (acceptKeyword("posedge")) {
+          sensitivity_list.push_back(std::make_unique<PosEdge>(expression()));
+        } else if (acceptKeyword("negedge")) {
+          sensitivity_list.push_back(std::make_unique<NegEdge>(expression()));
+        } else {
+          sensitivity_list.push_back(identifier());
+        }
+      } while (accept(",") || acceptKeyword("or"));
+      expect(")");
+    }
+
+    std::vector<std::variant<std::unique_ptr<BehavioralStatement>,
+                             std::unique_ptr<Declaration>>>
+        body;
+    expectKeyword("begin");
+    while (!acceptKeyword("end")) {
+      if (token.isKeyword("wire") || token.isKeyword("reg")) {
+        body.push_back(declaration());
+        continue;
+      }
+      auto target = narrowed<AssignTarget>("assignment target");
+      if (accept("=")) {
+        body.push_back(
+            std::make_unique<BlockingAssign>(std::move(target), expression()));
+      } else if (accept("<=")) {
+        body.push_back(std::make_unique<NonBlockingAssign>(std::move(target),
+                                                           expression()));
+      } else {
+        unexpected("'=' or '<='");
+      }
+      expect(";");
+    }
+    return std::make_unique<Always>(std::move(sensitivity_list),
+                                    std::move(body));
+  }
+
+  std::unique_ptr<ModuleInstantiation> instantiation() {
+    Symbol module_name = rawSymbol();
+    Parameters parameters;
+    if (accept("#")) {
+      expect("(");
+      do {
+        expect(".");
+        auto name = identifier();
+        expect("(");
+        parameters.emplace_back(std::move(name), expression());
+        expect(")");
+      } while (accept(","));
+      expect(")");
+    }
+    Symbol instance_name = rawSymbol();
+    // Kept in source order
+    Connections connections;
+    std::unordered_set<Symbol> ports;
+    expect("(");
+    if (!accept(")")) {
+      do {
+        expect(".");
+        const char *where = token.text.data();
+        Symbol port = rawSymbol();
+        if (!ports.insert(port).second) {
+          lexer.error(where, "duplicate connection '" + port.str() + "'");
+        }
+        expect("(");
+        connections.emplace_back(port, narrowed<Connection>("connection"));
+        expect(")");
+      } while (accept(","));
+      expect(")");
+    }
+    expect(";");
+    return std::make_unique<ModuleInstantiation>(
+        module_name, std::move(parameters), instance_name,
+        std::move(connections));
+  }
+
+  std::variant<std::unique_ptr<StructuralStatement>,
+               std::unique_ptr<Declaration>>
+  moduleItem() {
+    if (token.isKeyword("wire") || token.isKeyword("reg")) {
+      return declaration();
+    }
+    if (acceptKeyword("assign")) {
+      auto target = narrowed<AssignTarget>("assignment target");
+      expect("=");
+      auto value = expression();
+      expect(";");
+      return std::make_unique<ContinuousAssign>(std::move(target),
+                                                std::move(value));
+    }
+    if (acceptKeyword("always")) return always();
+    if (token.kind == TokenKind::IDENTIFIER &&
+        Identifier::needsEscape(token.text)) {
+      error("unsupported statement '" + std::string(token.text) + "'");
+    }
+    return instantiation();
+  }
+
+  std::unique_ptr<AbstractModule> module() {
+    expectKeyword("module");
+    std::string name = rawName();
+    Parameters parameters;
+    if (accept("#")) {
+      expect("(");
+      do {
+        acceptKeyword("parameter");
+        auto id = identifier();
+        expect("=");
+        parameters.emplace_back(std::move(id), expression());
+      } while (accept(","));
+      expect(")");
+    }
+    std::vector<std::unique_ptr<AbstractPort>> ports;
+    expect("(");
+    if (!accept(")")) {
+      do {
+        ports.push_back(port());
+      } while (accept(","));
+      expect(")");
+    }
+    expect(";");
+    std::vector<std::variant<std::unique_ptr<StructuralStatement>,
+                             std::unique_ptr<Declaration>>>
+        body;
+    while (!acceptKeyword("endmodule")) {
+      if (token.kind == TokenKind::END) unexpected("'endmodule'");
+      body.push_back(moduleItem());
+    }
+    return std::make_unique<Module>(std::move(name), std::move(ports),
+                                    std::move(body), std::move(parameters));
+  }
+};
+
+// Splits `source` after `endmodule` keywords into about `count` pieces of
+// similar size that can be parsed independently
+std::vector<std::string_view> split_modules(std::string_view source,
+                                            size_t count) {
+  std::vector<std::string_view> pieces;
+  size_t target = source.size() / count + 1;
+  const char *begin = source.data();
+  const char *end = begin + source.size();
+  const char *piece = begin;
+  const char *cur = begin;
+  while (cur != end) {
+    char c = *cur;
+    if (has_class(c, kIdPart)) {
+      const char *word = cur;
+      while (++cur != end && has_class(*cur, kIdPart)) {
+      }
+      if (std::string_view(word, cur - word) == "endmodule" &&
+          static_cast<size_t>(cur - piece) >= target) {
+        pieces.emplace_back(piece, cur - piece);
+        piece = cur;
+      }
+    } else if (c == '/' && cur + 1 != end && cur[1] == '/') {
+      cur = std::find(cur, end, '\n');
+    } else if (c == '/' && cur + 1 != end && cur[1] == '*') {
+      size_t close = std::string_view(cur + 2, end - cur - 2).find("*/");
+      cur = close == std::string_view::npos ? end : cur + close + 4;
+    } else if (c == '"') {
+      while (++cur != end && *cur != '"') {
+        if (*cur == '\\' && cur + 1 != end) cur++;
+      }
+      if (cur != end) cur++;
+    } else if (c == '\\') {
+      while (++cur != end && !has_class(*cur, kSpace)) {
+      }
+    } else {
+      cur++;
+    }
+  }
+  if (piece != end) pieces.emplace_back(piece, end - piece);
+  return pieces;
+}
+
+}  // namespace
+
+std::unique_ptr<File> parse(std::string_view source,
+                            const ParseOptions &options) {
+  SymbolTable &symbols = SymbolTable::current();
+  std::vector<std::unique_ptr<AbstractModule>> modules;
+  if (!options.pool || options.pool->size() == 1) {
+    Parser parser(source.data(), source, symbols);
+    parser.parseModules(modules);
+    return std::make_unique<File>(modules);
+  }
+
+  std::vector<std::string_view> pieces =
+      split_modules(source, 4 * options.pool->size());
+  std::vector<std::vector<std::unique_ptr<AbstractModule>>> results(
+      pieces.size());
+  options.pool->parallelFor(pieces.size(), [&](size_t i) {
+    SymbolTable::Scope scope(symbols);
+    Parser parser(source.data(), pieces[i], symbols);
+    parser.parseModules(results[i]);
+  });
+  for (auto &result : results) {
+    std::move(result.begin(), result.end(), std::back_inserter(modules));
+  }
+  return std::make_unique<File>(modules);
+}
+
+std::unique_ptr<File> parse_file(const std::string &path,
+                                 const ParseOptions &options) {
+  detail::MappedFile file(path, "vAST::parse_file");
+  return parse(file.view(), options);
+}
+
+}  // namespace verilogAST
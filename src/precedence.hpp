@@ -0,0 +1,55 @@
+// Internal operator precedences shared by the emitter and the parser, higher
+// binds tighter.  Binary operators are left associative and the ternary
+// operator is right associative.
+#pragma once
+#ifndef VERILOGAST_PRECEDENCE_H
+#define VERILOGAST_PRECEDENCE_H
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+namespace detail {
+
+constexpr unsigned kTernaryPrecedence = 1;
+constexpr unsigned kUnaryPrecedence = 9;
+// Leaves and bracketed expressions (indexing, concatenation)
+constexpr unsigned kPrimaryPrecedence = 10;
+
+// Indexed by BinOp
+constexpr unsigned kBinOpPrecedence[] = {
+    5,  // LSHIFT
+    5,  // RSHIFT
+    3,  // AND
+    2,  // OR
+    4,  // EQ
+    4,  // NEQ
+    6,  // ADD
+    6,  // SUB
+    7,  // MUL
+    7,  // DIV
+    8,  // POW
+    7,  // MOD
+    5,  // ALSHIFT
+    5,  // ARSHIFT
+};
+static_assert(sizeof(kBinOpPrecedence) / sizeof(kBinOpPrecedence[0]) ==
+                  BinOp::ARSHIFT + 1,
+              "kBinOpPrecedence does not match BinOp");
+
+// Precedence of `expr` as the operand of an operator
+inline unsigned precedence(const Expression &expr) {
+  switch (expr.kind()) {
+    case NodeKind::BINARY_OP:
+      return kBinOpPrecedence[static_cast<const BinaryOp &>(expr).op];
+    case NodeKind::UNARY_OP:
+      return kUnaryPrecedence;
+    case NodeKind::TERNARY_OP:
+      return kTernaryPrecedence;
+    default:
+      return kPrimaryPrecedence;
+  }
+}
+
+}  // namespace detail
+}  // namespace verilogAST
+#endif
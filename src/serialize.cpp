@@ -0,0 +1,594 @@
+#include "verilogAST/serialize.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <deque>
+#include <optional>
+#include <system_error>
+#include <unordered_map>
+
+#include "children.hpp"
+#include "fd_guard.hpp"
+#include "mapped_file.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+constexpr char kMagic[8] = {'v', 'A', 'S', 'T', 'b', 'i', 'n', '\0'};
+constexpr uint32_t kFormatVersion = 1;
+constexpr size_t kHeaderSize = sizeof(kMagic) + 4;
+constexpr size_t kTrailerSize = 16;
+// Record of an empty slot
+constexpr uint8_t kNullRecord = 0xff;
+
+class Writer {
+  Sink &sink;
+  // Offset of the header in `sink`, offsets in the trailer are relative to it
+  size_t start;
+  std::unordered_map<std::string_view, uint32_t> string_ids;
+  std::vector<std::string_view> strings;
+  // Digits of integer literals, which are written like other literals
+  std::deque<std::string> formatted;
+  uint64_t records = 0;
+
+  void byte(uint8_t value) { sink.put(static_cast<char>(value)); }
+
+  void varint(uint64_t value) {
+    char buffer[10];
+    size_t size = 0;
+    do {
+      uint8_t byte = value & 0x7f;
+      value >>= 7;
+      buffer[size++] = static_cast<char>(value ? byte | 0x80 : byte);
+    } while (value);
+    sink.write(buffer, size);
+  }
+
+  void fixed(uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) byte((value >> (8 * i)) & 0xff);
+  }
+
+  void string(std::string_view str) {
+    auto it = string_ids.emplace(str, strings.size()).first;
+    if (it->second == strings.size()) strings.push_back(str);
+    varint(it->second);
+  }
+
+  // Writes the kind and fields of `node`, its children have been written
+  void record(const Node *node) {
+    records++;
+    if (!node) {
+      byte(kNullRecord);
+      return;
+    }
+    byte(node->kind());
+    switch (node->kind()) {
+      case NodeKind::NUMERIC_LITERAL: {
+        auto &literal = static_cast<const NumericLiteral &>(*node);
+        if (literal.isInteger()) {
+          string(formatted.emplace_back(literal.digits()));
+        } else {
+          string(literal.value());
+        }
+        varint(literal.size);
+        byte(literal._signed);
+        byte(literal.radix);
+        break;
+      }
+      case NodeKind::IDENTIFIER:
+        string(static_cast<const Identifier &>(*node).value.str());
+        break;
+      case NodeKind::STRING:
+        string(static_cast<const String &>(*node).value);
+        break;
+      case NodeKind::BINARY_OP:
+        byte(static_cast<const BinaryOp &>(*node).op);
+        break;
+      case NodeKind::UNARY_OP:
+        byte(static_cast<const UnaryOp &>(*node).op);
+        break;
+      case NodeKind::CONCAT:
+        varint(static_cast<const Concat &>(*node).args.size());
+        break;
+      case NodeKind::PORT: {
+        auto &port = static_cast<const Port &>(*node);
+        byte(port.direction);
+        byte(port.data_type);
+        break;
+      }
+      case NodeKind::STRING_PORT:
+        string(static_cast<const StringPort &>(*node).value);
+        break;
+      case NodeKind::SINGLE_LINE_COMMENT:
+        string(static_cast<const SingleLineComment &>(*node).value);
+        break;
+      case NodeKind::BLOCK_COMMENT:
+        string(static_cast<const BlockComment &>(*node).value);
+        break;
+      case NodeKind::MODULE_INSTANTIATION: {
+        auto &inst = static_cast<const ModuleInstantiation &>(*node);
+        string(inst.module_name.str());
+        string(inst.instance_name.str());
+        varint(inst.parameters.size());
+        varint(inst.connections.size());
+        for (auto &conn : inst.connections) string(conn.first.str());
+        break;
+      }
+      case NodeKind::CONTINUOUS_ASSIGN:
+      case NodeKind::BLOCKING_ASSIGN:
+      case NodeKind::NON_BLOCKING_ASSIGN: {
+        const Assign &assign =
+            node->kind() == NodeKind::CONTINUOUS_ASSIGN
+                ? static_cast<const Assign &>(
+                      static_cast<const ContinuousAssign &>(*node))
+            : node->kind() == NodeKind::BLOCKING_ASSIGN
+                ? static_cast<const Assign &>(
+                      static_cast<const BlockingAssign &>(*node))
+                : static_cast<const Assign &>(
+                      static_cast<const NonBlockingAssign &>(*node));
+        string(assign.prefix());
+        break;
+      }
+      case NodeKind::ALWAYS: {
+        auto &always = static_cast<const Always &>(*node);
+        varint(always.sensitivity_list.size());
+        varint(always.body.size());
+        break;
+      }
+      case NodeKind::MODULE: {
+        auto &module = static_cast<const Module &>(*node);
+        string(module.name);
+        varint(module.parameters.size());
+        varint(module.ports.size());
+        varint(module.body.size());
+        break;
+      }
+      case NodeKind::STRING_BODY_MODULE: {
+        auto &module = static_cast<const StringBodyModule &>(*node);
+        string(module.name);
+        string(module.body);
+        varint(module.parameters.size());
+        varint(module.ports.size());
+        break;
+      }
+      case NodeKind::STRING_MODULE:
+        string(static_cast<const StringModule &>(*node).definition);
+        break;
+      case NodeKind::FILE: {
+        auto &file = static_cast<const File &>(*node);
+        varint(file.modules.size());
+        varint(file.emit_options.compact);
+        break;
+      }
+      default:
+        // Index, Slice, TernaryOp, NegEdge, PosEdge, Vector, Star and the
+        // declarations only have children
+        break;
+    }
+  }
+
+ public:
+  explicit Writer(Sink &sink) : sink(sink), start(sink.bytesWritten()){};
+
+  void write(const Node &root) {
+    sink.write(kMagic, sizeof(kMagic));
+    fixed(kFormatVersion, 4);
+
+    // Post-order with an explicit stack, so deep trees do not recurse
+    std::vector<std::pair<const Node *, bool>> stack{{&root, false}};
+    std::vector<const Node *> children;
+    while (!stack.empty()) {
+      auto [node, expanded] = stack.back();
+      if (!node || expanded) {
+        stack.pop_back();
+        record(node);
+        continue;
+      }
+      stack.back().second = true;
+      children.clear();
+      detail::for_each_child(const_cast<Node &>(*node), [&](auto &slot) {
+        children.push_back(detail::slot_node(slot));
+      });
+      for (size_t i = children.size(); i-- > 0;) {
+        stack.push_back({children[i], false});
+      }
+    }
+
+    uint64_t table_offset = sink.bytesWritten() - start;
+    varint(strings.size());
+    for (std::string_view str : strings) {
+      varint(str.size());
+      sink.write(str);
+    }
+    fixed(table_offset, 8);
+    fixed(records, 8);
+  }
+};
+
+class Reader {
+  const char *cur;
+  const char *end;
+  SymbolTable &table;
+  std::vector<std::string_view> strings;
+  // Interned on first use
+  std::vector<std::optional<Symbol>> symbols;
+  // Nodes whose parent has not been read yet
+  std::vector<std::unique_ptr<Node>> stack;
+  // Start of the children of the current record on `stack`
+  size_t first_child;
+
+  typedef std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
+                       std::unique_ptr<Slice>>
+      AssignTarget;
+  typedef std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
+                       std::unique_ptr<Slice>, std::unique_ptr<Vector>>
+      DeclarationValue;
+
+  [[noreturn]] static void corrupt() {
+    throw std::runtime_error("vAST::deserialize: corrupt data");
+  }
+
+  uint8_t byte() {
+    if (cur == end) corrupt();
+    return static_cast<uint8_t>(*cur++);
+  }
+
+  uint64_t varint() {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      uint8_t next = byte();
+      value |= static_cast<uint64_t>(next & 0x7f) << shift;
+      if (!(next & 0x80)) return value;
+    }
+    corrupt();
+  }
+
+  // Reads a count of children that have to be on the stack
+  size_t count(size_t multiple = 1) {
+    uint64_t value = varint();
+    if (value > stack.size() / multiple) corrupt();
+    return value;
+  }
+
+  size_t stringIndex() {
+    uint64_t index = varint();
+    if (index >= strings.size()) corrupt();
+    return index;
+  }
+
+  std::string string() { return std::string(strings[stringIndex()]); }
+
+  Symbol symbol() {
+    size_t index = stringIndex();
+    if (!symbols[index]) symbols[index] = table.intern(strings[index]);
+    return *symbols[index];
+  }
+
+  // Converts a node on the stack to the type of a slot
+  template <typename T>
+  T take(size_t i) {
+    T result;
+    if (!detail::set_slot(result, stack[i])) corrupt();
+    return result;
+  }
+
+  // Index of the first of the last `n` nodes on the stack, which are the
+  // children of the current record
+  size_t children(size_t n) {
+    if (stack.size() < n) corrupt();
+    first_child = stack.size() - n;
+    return first_child;
+  }
+
+  std::unique_ptr<Node> record(uint8_t kind) {
+    switch (kind) {
+      case NodeKind::NUMERIC_LITERAL: {
+        std::string value = string();
+        uint64_t size = varint();
+        bool is_signed = byte();
+        uint8_t radix = byte();
+        if (size > UINT32_MAX || radix > DECIMAL) corrupt();
+        return std::make_unique<NumericLiteral>(std::move(value), size,
+                                                is_signed, Radix(radix));
+      }
+      case NodeKind::IDENTIFIER:
+        return std::make_unique<Identifier>(symbol());
+      case NodeKind::STRING:
+        return std::make_unique<String>(string());
+      case NodeKind::INDEX: {
+        size_t first = children(2);
+        return std::make_unique<Index>(
+            take<std::unique_ptr<Identifier>>(first),
+            take<std::unique_ptr<Expression>>(first + 1));
+      }
+      case NodeKind::SLICE: {
+        size_t first = children(3);
+        return std::make_unique<Slice>(
+            take<std::unique_ptr<Identifier>>(first),
+            take<std::unique_ptr<Expression>>(first + 1),
+            take<std::unique_ptr<Expression>>(first + 2));
+      }
+      case NodeKind::BINARY_OP: {
+        uint8_t op = byte();
+        if (op > BinOp::ARSHIFT) corrupt();
+        size_t first = children(2);
+        return std::make_unique<BinaryOp>(
+            take<std::unique_ptr<Expression>>(first), BinOp::BinOp(op),
+            take<std::unique_ptr<Expression>>(first + 1));
+      }
+      case NodeKind::UNARY_OP: {
+        uint8_t op = byte();
+        if (op > UnOp::MINUS) corrupt();
+        size_t first = children(1);
+        return std::make_unique<UnaryOp>(
+            take<std::unique_ptr<Expression>>(first), UnOp::UnOp(op));
+      }
+      case NodeKind::TERNARY_OP: {
+        size_t first = children(3);
+        return std::make_unique<TernaryOp>(
+            take<std::unique_ptr<Expression>>(first),
+            take<std::unique_ptr<Expression>>(first + 1),
+            take<std::unique_ptr<Expression>>(first + 2));
+      }
+      case NodeKind::CONCAT: {
+        size_t first = children(count());
+        std::vector<std::unique_ptr<Expression>> args;
+        args.reserve(stack.size() - first);
+        for (size_t i = first; i < stack.size(); i++) {
+          args.push_back(take<std::unique_ptr<Expression>>(i));
+        }
+        return std::make_unique<Concat>(std::move(args));
+      }
+      case NodeKind::NEG_EDGE:
+        return std::make_unique<NegEdge>(
+            take<std::unique_ptr<Expression>>(children(1)));
+      case NodeKind::POS_EDGE:
+        return std::make_unique<PosEdge>(
+            take<std::unique_ptr<Expression>>(children(1)));
+      case NodeKind::VECTOR: {
+        size_t first = children(3);
+        return std::make_unique<Vector>(
+            take<std::unique_ptr<Identifier>>(first),
+            take<std::unique_ptr<Expression>>(first + 1),
+            take<std::unique_ptr<Expression>>(first + 2));
+      }
+      case NodeKind::PORT: {
+        uint8_t direction = byte();
+        uint8_t data_type = byte();
+        if (direction > INOUT || data_type > REG) corrupt();
+        return std::make_unique<Port>(
+            take<std::variant<std::unique_ptr<Identifier>,
+                              std::unique_ptr<Vector>>>(children(1)),
+            Direction(direction), PortType(data_type));
+      }
+      case NodeKind::STRING_PORT:
+        return std::make_unique<StringPort>(string());
+      case NodeKind::SINGLE_LINE_COMMENT:
+        return std::make_unique<SingleLineComment>(string());
+      case NodeKind::BLOCK_COMMENT:
+        return std::make_unique<BlockComment>(string());
+      case NodeKind::MODULE_INSTANTIATION: {
+        Symbol module_name = symbol();
+        Symbol instance_name = symbol();
+        size_t num_parameters = count(2);
+        size_t num_connections = count();
+        size_t first = children(2 * num_parameters + num_connections);
+        auto inst = std::make_unique<ModuleInstantiation>(
+            module_name, Parameters(), instance_name, Connections());
+        inst->parameters.reserve(num_parameters);
+        for (size_t i = 0; i < num_parameters; i++) {
+          inst->parameters.emplace_back(
+              take<std::unique_ptr<Identifier>>(first + 2 * i),
+              take<std::unique_ptr<Expression>>(first + 2 * i + 1));
+        }
+        first += 2 * num_parameters;
+        inst->connections.reserve(num_connections);
+        for (size_t i = 0; i < num_connections; i++) {
+          inst->connections.emplace_back(symbol(),
+                                         take<Connection>(first + i));
+        }
+        return inst;
+      }
+      case NodeKind::WIRE:
+      case NodeKind::REG: {
+        auto value = take<DeclarationValue>(children(1));
+        if (kind == NodeKind::WIRE) {
+          return std::make_unique<Wire>(std::move(value));
+        }
+        return std::make_unique<Reg>(std::move(value));
+      }
+      case NodeKind::CONTINUOUS_ASSIGN:
+        return assign<ContinuousAssign>();
+      case NodeKind::BLOCKING_ASSIGN:
+        return assign<BlockingAssign>();
+      case NodeKind::NON_BLOCKING_ASSIGN:
+        return assign<NonBlockingAssign>();
+      case NodeKind::STAR:
+        return std::make_unique<Star>();
+      case NodeKind::ALWAYS: {
+        size_t num_items = count();
+        size_t num_statements = count();
+        size_t first = children(num_items + num_statements);
+        std::vector<
+            std::variant<std::unique_ptr<Identifier>, std::unique_ptr<PosEdge>,
+                         std::unique_ptr<NegEdge>, std::unique_ptr<Star>>>
+            sensitivity_list;
+        std::vector<std::variant<std::unique_ptr<BehavioralStatement>,
+                                 std::unique_ptr<Declaration>>>
+            body;
+        for (size_t i = 0; i < num_items; i++) {
+          sensitivity_list.push_back(
+              take<typename decltype(sensitivity_list)::value_type>(first +
+                                                                    i));
+        }
+        for (size_t i = num_items; i < num_items + num_statements; i++) {
+          body.push_back(take<typename decltype(body)::value_type>(first + i));
+        }
+        return std::make_unique<Always>(std::move(sensitivity_list),
+                                        std::move(body));
+      }
+      case NodeKind::MODULE:
+      case NodeKind::STRING_BODY_MODULE: {
+        std::string name = string();
+        std::string string_body;
+        if (kind == NodeKind::STRING_BODY_MODULE) string_body = string();
+        size_t num_parameters = count(2);
+        size_t num_ports = count();
+        size_t num_statements = kind == NodeKind::MODULE ? count() : 0;
+        size_t i = children(2 * num_parameters + num_ports + num_statements);
+        Parameters parameters;
+        parameters.reserve(num_parameters);
+        for (size_t j = 0; j < num_parameters; j++, i += 2) {
+          parameters.emplace_back(take<std::unique_ptr<Identifier>>(i),
+                                  take<std::unique_ptr<Expression>>(i + 1));
+        }
+        std::vector<std::unique_ptr<AbstractPort>> ports;
+        ports.reserve(num_ports);
+        for (size_t j = 0; j < num_ports; j++) {
+          ports.push_back(take<std::unique_ptr<AbstractPort>>(i++));
+        }
+        if (kind == NodeKind::STRING_BODY_MODULE) {
+          return std::make_unique<StringBodyModule>(
+              std::move(name), std::move(ports), std::move(string_body),
+              std::move(parameters));
+        }
+        std::vector<std::variant<std::unique_ptr<StructuralStatement>,
+                                 std::unique_ptr<Declaration>>>
+            body;
+        body.reserve(num_statements);
+        for (size_t j = 0; j < num_statements; j++) {
+          body.push_back(take<typename decltype(body)::value_type>(i++));
+        }
+        return std::make_unique<Module>(std::move(name), std::move(ports),
+                                        std::move(body),
+                                        std::move(parameters));
+      }
+      case NodeKind::STRING_MODULE:
+        return std::make_unique<StringModule>(string());
+      case NodeKind::FILE: {
+        size_t first = children(count());
+        EmitOptions options;
+        options.compact = varint() != 0;
+        std::vector<std::unique_ptr<AbstractModule>> modules;
+        modules.reserve(stack.size() - first);
+        for (size_t i = first; i < stack.size(); i++) {
+          modules.push_back(take<std::unique_ptr<AbstractModule>>(i));
+        }
+        auto file = std::make_unique<File>(modules);
+        file->emit_options = options;
+        return file;
+      }
+      default:
+        corrupt();
+    }
+  }
+
+  template <typename T>
+  std::unique_ptr<Node> assign() {
+    std::string_view prefix = strings[stringIndex()];
+    size_t first = children(2);
+    auto node =
+        std::make_unique<T>(take<AssignTarget>(first),
+                            take<std::unique_ptr<Expression>>(first + 1));
+    node->setPrefix(prefix);
+    return node;
+  }
+
+ public:
+  Reader() : table(SymbolTable::current()){};
+
+  std::unique_ptr<Node> read(std::string_view data) {
+    if (data.size() < kHeaderSize + kTrailerSize ||
+        data.compare(0, sizeof(kMagic), std::string_view(kMagic, 8)) != 0) {
+      throw std::runtime_error("vAST::deserialize: not a serialized tree");
+    }
+    auto fixed = [&](size_t offset, size_t size) {
+      uint64_t value = 0;
+      for (size_t i = 0; i < size; i++) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(data[offset + i]))
+                 << (8 * i);
+      }
+      return value;
+    };
+    uint64_t version = fixed(sizeof(kMagic), 4);
+    if (version != kFormatVersion) {
+      throw std::runtime_error("vAST::deserialize: unsupported version " +
+                               std::to_string(version));
+    }
+    size_t trailer = data.size() - kTrailerSize;
+    uint64_t table_offset = fixed(trailer, 8);
+    uint64_t num_records = fixed(trailer + 8, 8);
+    if (table_offset < kHeaderSize || table_offset > trailer) corrupt();
+
+    // String table
+    cur = data.data() + table_offset;
+    end = data.data() + trailer;
+    uint64_t num_strings = varint();
+    if (num_strings > static_cast<size_t>(end - cur)) corrupt();
+    strings.reserve(num_strings);
+    for (uint64_t i = 0; i < num_strings; i++) {
+      uint64_t size = varint();
+      if (size > static_cast<size_t>(end - cur)) corrupt();
+      strings.emplace_back(cur, size);
+      cur += size;
+    }
+    symbols.resize(num_strings);
+
+    // Records
+    cur = data.data() + kHeaderSize;
+    end = data.data() + table_offset;
+    for (uint64_t i = 0; i < num_records; i++) {
+      uint8_t kind = byte();
+      if (kind == kNullRecord) {
+        stack.emplace_back();
+        continue;
+      }
+      first_child = stack.size();
+      std::unique_ptr<Node> node = record(kind);
+      stack.resize(first_child);
+      stack.push_back(std::move(node));
+    }
+    if (cur != end || stack.size() != 1 || !stack.back()) corrupt();
+    return std::move(stack.back());
+  }
+};
+
+}  // namespace
+
+void serialize(const Node &root, Sink &sink) {
+  Writer writer(sink);
+  writer.write(root);
+}
+
+size_t save_binary(const Node &root, const std::string &path) {
+  detail::FdGuard guard{open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)};
+  if (guard.fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "vAST::save_binary cannot open " + path);
+  }
+  FdSink sink(guard.fd);
+  serialize(root, sink);
+  sink.flush();
+  int fd = guard.fd;
+  guard.fd = -1;
+  if (close(fd) != 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "vAST::save_binary close failed");
+  }
+  return sink.bytesWritten();
+}
+
+std::unique_ptr<Node> deserialize(std::string_view data) {
+  Reader reader;
+  return reader.read(data);
+}
+
+std::unique_ptr<Node> load_binary(const std::string &path) {
+  detail::MappedFile file(path, "vAST::load_binary");
+  return deserialize(file.view());
+}
+
+}  // namespace verilogAST
@@ -0,0 +1,109 @@
+#include "verilogAST/sink.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+namespace verilogAST {
+
+StringSink::StringSink(size_t initial_capacity) {
+  buffer.resize(initial_capacity);
+  begin = cur = buffer.data();
+  end = begin + buffer.size();
+}
+
+void StringSink::overflow(const char *data, size_t size) {
+  size_t used = cur - begin;
+  buffer.resize(std::max({buffer.size() * 2, used + size, size_t(256)}));
+  begin = buffer.data();
+  cur = begin + used;
+  end = begin + buffer.size();
+  std::memcpy(cur, data, size);
+  cur += size;
+}
+
+std::string StringSink::release() {
+  buffer.resize(cur - begin);
+  std::string result = std::move(buffer);
+  buffer = std::string();
+  begin = cur = end = nullptr;
+  drained = 0;
+  return result;
+}
+
+OStreamSink::OStreamSink(std::ostream &os, size_t buffer_size) : os(os) {
+  buffer.resize(buffer_size);
+  begin = cur = buffer.data();
+  end = begin + buffer.size();
+}
+
+OStreamSink::~OStreamSink() { flush(); }
+
+void OStreamSink::flush() {
+  os.write(begin, cur - begin);
+  drained += cur - begin;
+  cur = begin;
+}
+
+void OStreamSink::overflow(const char *data, size_t size) {
+  flush();
+  if (size > static_cast<size_t>(end - begin)) {
+    // Too large to be worth buffering
+    os.write(data, size);
+    drained += size;
+    return;
+  }
+  std::memcpy(cur, data, size);
+  cur += size;
+}
+
+// Writes all of [data, data + size) to `fd`, retrying on partial writes
+static void write_all(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t n = ::write(fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw std::system_error(errno, std::generic_category(),
+                              "vAST::FdSink write failed");
+    }
+    data += n;
+    size -= n;
+  }
+}
+
+FdSink::FdSink(int fd, size_t buffer_size) : fd(fd) {
+  buffer.resize(buffer_size);
+  begin = cur = buffer.data();
+  end = begin + buffer.size();
+}
+
+FdSink::~FdSink() {
+  try {
+    flush();
+  } catch (const std::system_error &) {
+  }
+}
+
+void FdSink::flush() {
+  // Reset the window first so a failed write is not retried on destruction
+  size_t size = cur - begin;
+  cur = begin;
+  write_all(fd, begin, size);
+  drained += size;
+}
+
+void FdSink::overflow(const char *data, size_t size) {
+  flush();
+  if (size > static_cast<size_t>(end - begin)) {
+    write_all(fd, data, size);
+    drained += size;
+    return;
+  }
+  std::memcpy(cur, data, size);
+  cur += size;
+}
+
+}  // namespace verilogAST
@@ -0,0 +1,326 @@
+#include "structural.hpp"
+
+#include <algorithm>
+
+#include "children.hpp"
+
+namespace verilogAST {
+
+namespace detail {
+
+namespace {
+
+size_t hash_string(std::string_view str) {
+  return std::hash<std::string_view>()(str);
+}
+
+// Calls `f(child)` for every child slot of `node` in source order, with
+// nullptr for empty slots
+template <typename F>
+void for_each_child_node(const Node &node, F &&f) {
+  for_each_child(const_cast<Node &>(node), [&](auto &slot) {
+    f(static_cast<const Node *>(slot_node(slot)));
+  });
+}
+
+// The Assign part of an assignment statement
+const Assign &as_assign(const Node &node) {
+  switch (node.kind()) {
+    case NodeKind::CONTINUOUS_ASSIGN:
+      return static_cast<const ContinuousAssign &>(node);
+    case NodeKind::BLOCKING_ASSIGN:
+      return static_cast<const BlockingAssign &>(node);
+    default:
+      return static_cast<const NonBlockingAssign &>(node);
+  }
+}
+
+}  // namespace
+
+size_t local_hash(const Node &node, bool ignore_name) {
+  size_t hash = node.kind();
+  switch (node.kind()) {
+    case NodeKind::NUMERIC_LITERAL: {
+      auto &literal = static_cast<const NumericLiteral &>(node);
+      if (literal.isInteger()) {
+        // Short digits are formatted without allocating
+        StringSink digits(15);
+        literal.emitDigits(digits);
+        hash = hash_combine(hash, hash_string(digits.view()));
+      } else {
+        hash = hash_combine(hash, hash_string(literal.value()));
+      }
+      hash = hash_combine(hash, literal.size);
+      hash = hash_combine(hash, literal._signed);
+      return hash_combine(hash, literal.radix);
+    }
+    case NodeKind::IDENTIFIER:
+      return hash_combine(hash,
+                          static_cast<const Identifier &>(node).value.hash());
+    case NodeKind::STRING:
+      return hash_combine(hash,
+                          hash_string(static_cast<const String &>(node).value));
+    case NodeKind::BINARY_OP:
+      return hash_combine(hash, static_cast<const BinaryOp &>(node).op);
+    case NodeKind::UNARY_OP:
+      return hash_combine(hash, static_cast<const UnaryOp &>(node).op);
+    case NodeKind::CONCAT:
+      return hash_combine(hash, static_cast<const Concat &>(node).args.size());
+    case NodeKind::PORT: {
+      auto &port = static_cast<const Port &>(node);
+      hash = hash_combine(hash, port.direction);
+      return hash_combine(hash, port.data_type);
+    }
+    case NodeKind::STRING_PORT:
+      return hash_combine(
+          hash, hash_string(static_cast<const StringPort &>(node).value));
+    case NodeKind::SINGLE_LINE_COMMENT: {
+      auto &comment = static_cast<const SingleLineComment &>(node);
+      return hash_combine(hash, hash_string(comment.value));
+    }
+    case NodeKind::BLOCK_COMMENT:
+      return hash_combine(
+          hash, hash_string(static_cast<const BlockComment &>(node).value));
+    case NodeKind::MODULE_INSTANTIATION: {
+      auto &inst = static_cast<const ModuleInstantiation &>(node);
+      hash = hash_combine(hash, inst.module_name.hash());
+      hash = hash_combine(hash, inst.instance_name.hash());
+      hash = hash_combine(hash, inst.parameters.size());
+      for (auto &conn : inst.connections) {
+        hash = hash_combine(hash, conn.first.hash());
+      }
+      return hash;
+    }
+    case NodeKind::CONTINUOUS_ASSIGN:
+    case NodeKind::BLOCKING_ASSIGN:
+    case NodeKind::NON_BLOCKING_ASSIGN:
+      // The prefix is implied by the class, unless edited
+      return hash_combine(hash, hash_string(as_assign(node).prefix()));
+    case NodeKind::ALWAYS: {
+      auto &always = static_cast<const Always &>(node);
+      hash = hash_combine(hash, always.sensitivity_list.size());
+      return hash_combine(hash, always.body.size());
+    }
+    case NodeKind::MODULE:
+    case NodeKind::STRING_BODY_MODULE: {
+      auto &module = static_cast<const Module &>(node);
+      if (!ignore_name) hash = hash_combine(hash, hash_string(module.name));
+      hash = hash_combine(hash, module.parameters.size());
+      hash = hash_combine(hash, module.ports.size());
+      hash = hash_combine(hash, module.body.size());
+      if (node.kind() == NodeKind::STRING_BODY_MODULE) {
+        auto &body = static_cast<const StringBodyModule &>(node).body;
+        hash = hash_combine(hash, hash_string(body));
+      }
+      return hash;
+    }
+    case NodeKind::STRING_MODULE: {
+      auto &module = static_cast<const StringModule &>(node);
+      return hash_combine(hash, hash_string(module.definition));
+    }
+    case NodeKind::FILE:
+      return hash_combine(hash, static_cast<const File &>(node).modules.size());
+    default:
+      // Index, Slice, TernaryOp, NegEdge, PosEdge, Vector, Star and the
+      // declarations only have children
+      return hash;
+  }
+}
+
+bool local_equal(const Node &a, const Node &b, bool ignore_name) {
+  if (a.kind() != b.kind()) return false;
+  switch (a.kind()) {
+    case NodeKind::NUMERIC_LITERAL: {
+      auto &x = static_cast<const NumericLiteral &>(a);
+      auto &y = static_cast<const NumericLiteral &>(b);
+      if (x.size != y.size || x._signed != y._signed || x.radix != y.radix) {
+        return false;
+      }
+      // Integer literals equal digit literals that are written the same way
+      if (x.isInteger() && y.isInteger()) {
+        size_t n = std::max(x.numWords(), y.numWords());
+        for (size_t i = 0; i < n; i++) {
+          if ((i < x.numWords() ? x.wordAt(i) : 0) !=
+              (i < y.numWords() ? y.wordAt(i) : 0)) {
+            return false;
+          }
+        }
+        return true;
+      }
+      if (!x.isInteger() && !y.isInteger()) return x.value() == y.value();
+      return x.digits() == y.digits();
+    }
+    case NodeKind::IDENTIFIER:
+      return static_cast<const Identifier &>(a).value ==
+             static_cast<const Identifier &>(b).value;
+    case NodeKind::STRING:
+      return static_cast<const String &>(a).value ==
+             static_cast<const String &>(b).value;
+    case NodeKind::BINARY_OP:
+      return static_cast<const BinaryOp &>(a).op ==
+             static_cast<const BinaryOp &>(b).op;
+    case NodeKind::UNARY_OP:
+      return static_cast<const UnaryOp &>(a).op ==
+             static_cast<const UnaryOp &>(b).op;
+    case NodeKind::CONCAT:
+      return static_cast<const Concat &>(a).args.size() ==
+             static_cast<const Concat &>(b).args.size();
+    case NodeKind::PORT: {
+      auto &x = static_cast<const Port &>(a);
+      auto &y = static_cast<const Port &>(b);
+      return x.direction == y.direction && x.data_type == y.data_type;
+    }
+    case NodeKind::STRING_PORT:
+      return static_cast<const StringPort &>(a).value ==
+             static_cast<const StringPort &>(b).value;
+    case NodeKind::SINGLE_LINE_COMMENT:
+      return static_cast<const SingleLineComment &>(a).value ==
+             static_cast<const SingleLineComment &>(b).value;
+    case NodeKind::BLOCK_COMMENT:
+      return static_cast<const BlockComment &>(a).value ==
+             static_cast<const BlockComment &>(b).value;
+    case NodeKind::MODULE_INSTANTIATION: {
+      auto &x = static_cast<const ModuleInstantiation &>(a);
+      auto &y = static_cast<const ModuleInstantiation &>(b);
+      if (x.module_name != y.module_name ||
+          x.instance_name != y.instance_name ||
+          x.parameters.size() != y.parameters.size() ||
+          x.connections.size() != y.connections.size()) {
+        return false;
+      }
+      for (size_t i = 0; i < x.connections.size(); i++) {
+        if (x.connections[i].first != y.connections[i].first) return false;
+      }
+      return true;
+    }
+    case NodeKind::CONTINUOUS_ASSIGN:
+    case NodeKind::BLOCKING_ASSIGN:
+    case NodeKind::NON_BLOCKING_ASSIGN:
+      return as_assign(a).prefix() == as_assign(b).prefix();
+    case NodeKind::ALWAYS: {
+      auto &x = static_cast<const Always &>(a);
+      auto &y = static_cast<const Always &>(b);
+      return x.sensitivity_list.size() == y.sensitivity_list.size() &&
+             x.body.size() == y.body.size();
+    }
+    case NodeKind::MODULE:
+    case NodeKind::STRING_BODY_MODULE: {
+      auto &x = static_cast<const Module &>(a);
+      auto &y = static_cast<const Module &>(b);
+      if ((!ignore_name && x.name != y.name) ||
+          x.parameters.size() != y.parameters.size() ||
+          x.ports.size() != y.ports.size() ||
+          x.body.size() != y.body.size()) {
+        return false;
+      }
+      return a.kind() == NodeKind::MODULE ||
+             static_cast<const StringBodyModule &>(a).body ==
+                 static_cast<const StringBodyModule &>(b).body;
+    }
+    case NodeKind::STRING_MODULE:
+      return static_cast<const StringModule &>(a).definition ==
+             static_cast<const StringModule &>(b).definition;
+    case NodeKind::FILE:
+      return static_cast<const File &>(a).modules.size() ==
+             static_cast<const File &>(b).modules.size();
+    default:
+      return true;
+  }
+}
+
+namespace {
+
+// Combines the local hash of `node` with the (already memoized) hashes of its
+// children
+size_t combine_children(const Node &node, bool ignore_name) {
+  size_t hash = local_hash(node, ignore_name);
+  for_each_child_node(node, [&](const Node *child) {
+    hash = hash_combine(hash, child ? child->hash() : 0);
+  });
+  return hash;
+}
+
+bool structurally_equal(const Node &a, const Node &b, bool ignore_root_name) {
+  if (&a == &b) return true;
+  // Hashes all of the nodes of both trees, so that the hashes of their
+  // subtrees can be compared below without recomputing them
+  a.hash();
+  b.hash();
+  if (ignore_root_name) {
+    if (combine_children(a, true) != combine_children(b, true) ||
+        !local_equal(a, b, true)) {
+      return false;
+    }
+  } else if (a.hash() != b.hash() || !local_equal(a, b)) {
+    return false;
+  }
+
+  std::vector<std::pair<const Node *, const Node *>> stack{{&a, &b}};
+  std::vector<const Node *> a_children, b_children;
+  bool root = true;
+  while (!stack.empty()) {
+    auto [x, y] = stack.back();
+    stack.pop_back();
+    // The roots have been compared above
+    if (!root) {
+      if (x == y) continue;
+      if (x->hash() != y->hash() || !local_equal(*x, *y)) return false;
+    }
+    root = false;
+    a_children.clear();
+    b_children.clear();
+    for_each_child_node(*x, [&](const Node *c) { a_children.push_back(c); });
+    for_each_child_node(*y, [&](const Node *c) { b_children.push_back(c); });
+    if (a_children.size() != b_children.size()) return false;
+    for (size_t i = 0; i < a_children.size(); i++) {
+      if (!a_children[i] || !b_children[i]) {
+        if (a_children[i] != b_children[i]) return false;
+        continue;
+      }
+      stack.push_back({a_children[i], b_children[i]});
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+size_t hash_ignoring_name(const Node &module) {
+  module.hash();
+  return combine_children(module, true);
+}
+
+bool equal_ignoring_name(const Node &a, const Node &b) {
+  return structurally_equal(a, b, true);
+}
+
+}  // namespace detail
+
+size_t Node::hash() const {
+  if (hash_memo) return hash_memo;
+  // Post-order over the nodes that have not been hashed yet
+  std::vector<std::pair<const Node *, bool>> stack{{this, false}};
+  while (!stack.empty()) {
+    auto [node, leaving] = stack.back();
+    if (leaving) {
+      stack.pop_back();
+      // Folded to the width of the memo, zero marks a hash that has not
+      // been computed
+      size_t hash = detail::combine_children(*node, false);
+      uint32_t folded = static_cast<uint32_t>(hash ^ (hash >> 32)) & kHashMask;
+      node->hash_memo = folded ? folded : 1;
+      continue;
+    }
+    stack.back().second = true;
+    detail::for_each_child_node(*node, [&](const Node *child) {
+      if (child && !child->hash_memo) stack.push_back({child, false});
+    });
+  }
+  return hash_memo;
+}
+
+bool Node::structurallyEqual(const Node &other) const {
+  return detail::structurally_equal(*this, other, false);
+}
+
+}  // namespace verilogAST
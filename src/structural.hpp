@@ -0,0 +1,27 @@
+// Internal helpers for comparing nodes structurally (see Node::hash)
+#pragma once
+#ifndef VERILOGAST_STRUCTURAL_H
+#define VERILOGAST_STRUCTURAL_H
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+namespace detail {
+
+inline size_t hash_combine(size_t seed, size_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// Hash and equality of the fields of a node other than its children.  With
+// `ignore_name` the name of a module is not taken into account.
+size_t local_hash(const Node &node, bool ignore_name = false);
+bool local_equal(const Node &a, const Node &b, bool ignore_name = false);
+
+// Same as `module.hash()` and `a.structurallyEqual(b)`, except that the names
+// of the modules at the root are not taken into account
+size_t hash_ignoring_name(const Node &module);
+bool equal_ignoring_name(const Node &a, const Node &b);
+
+}  // namespace detail
+}  // namespace verilogAST
+#endif
@@ -0,0 +1,63 @@
+#include "verilogAST/symbol.hpp"
+
+#include <limits>
+#include <stdexcept>
+
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+static thread_local SymbolTable *current_table = nullptr;
+
+Symbol SymbolTable::intern(std::string_view name) {
+  size_t hash = std::hash<std::string_view>()(name);
+  // The top bits pick the shard, the maps of the shards use the low ones
+  Shard &shard = shards[(hash >> 32) % kNumShards];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(name);
+  if (it != shard.index.end()) return Symbol(it->second);
+  uint32_t id = num_entries.load(std::memory_order_relaxed);
+  do {
+    if (id == std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error("vAST::SymbolTable is full");
+    }
+  } while (!num_entries.compare_exchange_weak(id, id + 1,
+                                              std::memory_order_relaxed));
+  shard.entries.push_back(
+      {std::string(name), this, id, Identifier::needsEscape(name), hash});
+  const detail::SymbolEntry *entry = &shard.entries.back();
+  shard.index.emplace(entry->name, entry);
+  return Symbol(entry);
+}
+
+size_t SymbolTable::size() const {
+  return num_entries.load(std::memory_order_relaxed);
+}
+
+void SymbolTable::clear() {
+  for (Shard &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.index.clear();
+    shard.entries.clear();
+  }
+  num_entries.store(0, std::memory_order_relaxed);
+}
+
+SymbolTable &SymbolTable::global() {
+  // Intentionally leaked so that nodes in other static objects never outlive
+  // their names
+  static SymbolTable *table = new SymbolTable();
+  return *table;
+}
+
+SymbolTable &SymbolTable::current() {
+  return current_table ? *current_table : global();
+}
+
+SymbolTable::Scope::Scope(SymbolTable &table) : previous(current_table) {
+  current_table = &table;
+}
+
+SymbolTable::Scope::~Scope() { current_table = previous; }
+
+}  // namespace verilogAST
@@ -0,0 +1,81 @@
+#include "verilogAST/thread_pool.hpp"
+
+namespace verilogAST {
+
+ThreadPool::ThreadPool(unsigned num_threads) {
+  if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+  for (unsigned i = 1; i < num_threads; i++) {
+    workers.emplace_back([this] { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  work_ready.notify_all();
+  for (auto &worker : workers) worker.join();
+}
+
+void ThreadPool::runIterations() {
+  for (size_t i = next++; i < count; i = next++) {
+    try {
+      (*body)(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) error = std::current_exception();
+      // Skip the remaining iterations
+      next = count;
+    }
+  }
+}
+
+void ThreadPool::workerLoop() {
+  size_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      // `body` is reset once a loop has finished, so a worker that wakes up
+      // too late never joins a loop whose caller has already returned
+      work_ready.wait(lock, [&] {
+        return stopping || (generation != seen_generation && body);
+      });
+      if (stopping) return;
+      seen_generation = generation;
+      active_workers++;
+    }
+    runIterations();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      active_workers--;
+    }
+    work_done.notify_one();
+  }
+}
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)> &fn) {
+  if (n == 0) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    body = &fn;
+    count = n;
+    next = 0;
+    error = nullptr;
+    generation++;
+  }
+  if (n > 1) work_ready.notify_all();
+  runIterations();
+
+  std::exception_ptr result;
+  {
+    // Workers may still be finishing their last iteration
+    std::unique_lock<std::mutex> lock(mutex);
+    work_done.wait(lock, [&] { return active_workers == 0; });
+    body = nullptr;
+    result = error;
+  }
+  if (result) std::rethrow_exception(result);
+}
+
+}  // namespace verilogAST
@@ -0,0 +1,177 @@
+#include "verilogAST/transformer.hpp"
+
+#include <algorithm>
+
+#include "children.hpp"
+
+namespace verilogAST {
+
+void walk(const Node &root, Visitor &visitor) {
+  struct Entry {
+    const Node *node;
+    bool leaving;
+  };
+  std::vector<Entry> stack{{&root, false}};
+  while (!stack.empty()) {
+    Entry entry = stack.back();
+    stack.pop_back();
+    if (entry.leaving) {
+      visitor.leave(*entry.node);
+      continue;
+    }
+    if (!visitor.enter(*entry.node)) continue;
+    stack.push_back({entry.node, true});
+    // Children are pushed in reverse so that they are popped in source order
+    size_t first_child = stack.size();
+    detail::for_each_child(const_cast<Node &>(*entry.node), [&](auto &slot) {
+      if (const Node *child = detail::slot_node(slot)) {
+        stack.push_back({child, false});
+      }
+    });
+    std::reverse(stack.begin() + first_child, stack.end());
+  }
+}
+
+namespace {
+
+// Passes the expression held by a slot through `Transformer::transform` and
+// stores the result back into the slot
+typedef void (*ApplyFn)(Transformer &, void *slot);
+
+[[noreturn]] void bad_replacement() {
+  throw std::runtime_error(
+      "vAST::Transformer::transform returned an expression that does not fit "
+      "its parent");
+}
+
+template <typename T>
+void apply_unique(Transformer &transformer, void *slot) {
+  auto &ptr = *static_cast<std::unique_ptr<T> *>(slot);
+  T *old = ptr.get();
+  std::unique_ptr<Expression> result =
+      transformer.transform(std::unique_ptr<Expression>(ptr.release()));
+  if constexpr (std::is_same_v<T, Expression>) {
+    if (!result) bad_replacement();
+    ptr = std::move(result);
+  } else {
+    // Only check the class of the result if it actually changed
+    if (result.get() != old &&
+        (!result || !detail::is_a<T>(result->kind()))) {
+      bad_replacement();
+    }
+    ptr.reset(static_cast<T *>(result.release()));
+  }
+}
+
+template <typename... Ts>
+void apply_variant(Transformer &transformer, void *slot) {
+  auto &var = *static_cast<std::variant<std::unique_ptr<Ts>...> *>(slot);
+  std::unique_ptr<Expression> expr = std::visit(
+      [](auto &ptr) -> std::unique_ptr<Expression> {
+        using T = typename std::decay_t<decltype(ptr)>::element_type;
+        if constexpr (std::is_base_of_v<Expression, T>) {
+          return std::unique_ptr<Expression>(ptr.release());
+        } else {
+          return nullptr;
+        }
+      },
+      var);
+  if (!expr) return;
+  Expression *old = expr.get();
+  std::unique_ptr<Expression> result = transformer.transform(std::move(expr));
+  if (result.get() == old) {
+    // Same node, goes back into the same (now empty) alternative
+    std::visit(
+        [&](auto &ptr) {
+          using T = typename std::decay_t<decltype(ptr)>::element_type;
+          if constexpr (std::is_base_of_v<Expression, T>) {
+            ptr.reset(static_cast<T *>(result.release()));
+          }
+        },
+        var);
+    return;
+  }
+  // Store into the first alternative that the result is an instance of
+  bool stored = false;
+  auto try_store = [&](auto *tag) {
+    using T = std::remove_pointer_t<decltype(tag)>;
+    if constexpr (std::is_base_of_v<Expression, T>) {
+      if (!stored && result && detail::is_a<T>(result->kind())) {
+        var = std::unique_ptr<T>(static_cast<T *>(result.release()));
+        stored = true;
+      }
+    }
+  };
+  (try_store(static_cast<Ts *>(nullptr)), ...);
+  if (!stored) bad_replacement();
+}
+
+template <typename T>
+constexpr ApplyFn apply_fn(std::unique_ptr<T> *) {
+  if constexpr (std::is_base_of_v<Expression, T>) {
+    return &apply_unique<T>;
+  } else {
+    return nullptr;
+  }
+}
+
+template <typename... Ts>
+constexpr ApplyFn apply_fn(std::variant<std::unique_ptr<Ts>...> *) {
+  if constexpr ((std::is_base_of_v<Expression, Ts> || ...)) {
+    return &apply_variant<Ts...>;
+  } else {
+    return nullptr;
+  }
+}
+
+struct TransformEntry {
+  Node *node;
+  // Slot holding `node` (nullptr for the root of `Transformer::run(Node &)`)
+  void *slot;
+  ApplyFn apply;
+  bool leaving;
+};
+
+void run_transformer(Transformer &transformer, TransformEntry root) {
+  std::vector<TransformEntry> stack{root};
+  while (!stack.empty()) {
+    TransformEntry entry = stack.back();
+    stack.pop_back();
+    if (entry.leaving) {
+      if (is_expression(entry.node->kind())) {
+        if (entry.apply) entry.apply(transformer, entry.slot);
+      } else {
+        transformer.leave(*entry.node);
+      }
+      continue;
+    }
+    // Conservatively assume that every visited node gets edited
+    entry.node->invalidateHash();
+    if (!transformer.enter(*entry.node)) continue;
+    entry.leaving = true;
+    stack.push_back(entry);
+    size_t first_child = stack.size();
+    detail::for_each_child(*entry.node, [&](auto &slot) {
+      if (Node *child = detail::slot_node(slot)) {
+        stack.push_back({child, &slot, apply_fn(&slot), false});
+      }
+    });
+    std::reverse(stack.begin() + first_child, stack.end());
+  }
+}
+
+}  // namespace
+
+void Transformer::run(Node &root) {
+  run_transformer(*this, {&root, nullptr, nullptr, false});
+}
+
+std::unique_ptr<Expression> Transformer::run(
+    std::unique_ptr<Expression> root) {
+  if (!root) return root;
+  run_transformer(*this,
+                  {root.get(), &root, &apply_unique<Expression>, false});
+  return root;
+}
+
+}  // namespace verilogAST
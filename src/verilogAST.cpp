@@ -1,379 +1,1188 @@
 #include "verilogAST.hpp"
 
-#include <regex>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <unordered_map>
 #include <unordered_set>
 
-// Helper function to join a vector of strings with a specified separator ala
-// Python's ",".join(...)
-std::string join(std::vector<std::string> vec, std::string separator) {
-  std::string result;
-  for (size_t i = 0; i < vec.size(); i++) {
-    if (i > 0) result += separator;
-    result += vec[i];
+#include "children.hpp"
+#include "precedence.hpp"
+#include "verilogAST/emit_stats.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+constexpr const char *kKindNames[kNumNodeKinds] = {
+    "NumericLiteral",
+    "Identifier",
+    "String",
+    "Index",
+    "Slice",
+    "BinaryOp",
+    "UnaryOp",
+    "TernaryOp",
+    "Concat",
+    "NegEdge",
+    "PosEdge",
+    "Vector",
+    "Port",
+    "StringPort",
+    "SingleLineComment",
+    "BlockComment",
+    "ModuleInstantiation",
+    "Wire",
+    "Reg",
+    "ContinuousAssign",
+    "BlockingAssign",
+    "NonBlockingAssign",
+    "Star",
+    "Always",
+    "Module",
+    "StringBodyModule",
+    "StringModule",
+    "File"};
+
+}  // namespace
+
+const char *kind_name(NodeKind::NodeKind kind) { return kKindNames[kind]; }
+
+std::string Node::toString() const {
+  StringSink sink;
+  emit(sink);
+  return sink.release();
+}
+
+namespace {
+
+constexpr char kDigitChars[] = "0123456789ABCDEF";
+
+// Writes `chunk` as exactly `width` decimal digits, padded with zeros
+void emit_padded(Sink &sink, uint32_t chunk, unsigned width) {
+  char buf[10];
+  for (unsigned i = width; i-- > 0; chunk /= 10) {
+    buf[i] = kDigitChars[chunk % 10];
   }
-  return result;
+  sink.write(buf, width);
 }
 
-namespace verilogAST {
-std::string NumericLiteral::toString() {
-  std::string signed_str = _signed ? "s" : "";
+// Writes the number made of the 32 bit `halves`, least significant first, in
+// decimal
+void emit_wide_decimal(Sink &sink, std::vector<uint32_t> halves) {
+  // Dividing by 10^9 on 32 bit halves keeps the intermediates in 64 bits,
+  // the chunks of 9 digits come out least significant first
+  constexpr uint32_t kChunk = 1000000000;
+  std::vector<uint32_t> chunks;
+  while (!halves.empty()) {
+    uint64_t remainder = 0;
+    for (size_t i = halves.size(); i-- > 0;) {
+      uint64_t current = (remainder << 32) | halves[i];
+      halves[i] = current / kChunk;
+      remainder = current % kChunk;
+    }
+    chunks.push_back(remainder);
+    while (!halves.empty() && halves.back() == 0) halves.pop_back();
+  }
+  char buf[16];
+  char *end = std::to_chars(buf, buf + sizeof(buf), chunks.back()).ptr;
+  sink.write(buf, end - buf);
+  for (size_t i = chunks.size() - 1; i-- > 0;) emit_padded(sink, chunks[i], 9);
+}
+
+}  // namespace
+
+NumericLiteral::NumericLiteral(uint64_t word, unsigned int size, bool _signed,
+                               Radix radix)
+    : size(size), word(word), radix(radix), _signed(_signed), form(WORD) {
+  if (size < 64) this->word &= (uint64_t(1) << size) - 1;
+}
+
+NumericLiteral::NumericLiteral(const std::vector<uint64_t> &words,
+                               unsigned int size, bool _signed, Radix radix)
+    : size(size), word(0), radix(radix), _signed(_signed), form(WORD) {
+  size_t num_words = std::min<size_t>(words.size(), (size + 63) / 64);
+  if (num_words > 1) {
+    // Wide literals keep their words out of line
+    form = WORDS;
+    this->words = new uint64_t[num_words + 1];
+    this->words[0] = num_words;
+    std::copy(words.begin(), words.begin() + num_words, this->words + 1);
+  } else if (num_words == 1) {
+    word = words[0];
+  }
+  if (size % 64 != 0 && num_words == (size + 63) / 64) {
+    uint64_t &top = form == WORDS ? this->words[num_words] : word;
+    top &= (uint64_t(1) << size % 64) - 1;
+  }
+}
+
+NumericLiteral::NumericLiteral(const NumericLiteral &other)
+    : Expression(other),
+      size(other.size),
+      word(other.word),
+      radix(other.radix),
+      _signed(other._signed),
+      form(other.form) {
+  if (form == DIGITS) {
+    new (&text) std::string(other.text);
+  } else if (form == WORDS) {
+    words = new uint64_t[other.words[0] + 1];
+    std::copy(other.words, other.words + other.words[0] + 1, words);
+  }
+}
+
+NumericLiteral::~NumericLiteral() {
+  if (form == DIGITS) {
+    text.~basic_string();
+  } else if (form == WORDS) {
+    delete[] words;
+  }
+}
 
-  std::string radix_str;
+void NumericLiteral::emitDigits(Sink &sink) const {
+  if (!isInteger()) {
+    sink << text;
+    return;
+  }
+  // Most significant non-zero word
+  size_t top = numWords() - 1;
+  while (top > 0 && wordAt(top) == 0) top--;
+  if (radix == DECIMAL) {
+    if (top == 0) {
+      char buf[20];
+      char *end = std::to_chars(buf, buf + sizeof(buf), wordAt(0)).ptr;
+      sink.write(buf, end - buf);
+      return;
+    }
+    std::vector<uint32_t> halves;
+    halves.reserve(2 * (top + 1));
+    for (size_t i = 0; i <= top; i++) {
+      halves.push_back(static_cast<uint32_t>(wordAt(i)));
+      halves.push_back(static_cast<uint32_t>(wordAt(i) >> 32));
+    }
+    emit_wide_decimal(sink, std::move(halves));
+    return;
+  }
+  if (top == 0 && wordAt(0) == 0) {
+    sink << '0';
+    return;
+  }
+  // Power of two radices take a fixed number of bits per digit, which may
+  // straddle two words
+  unsigned shift = radix == BINARY ? 1 : radix == OCTAL ? 3 : 4;
+  uint64_t mask = (uint64_t(1) << shift) - 1;
+  size_t bits = 64 * top + 64 - __builtin_clzll(wordAt(top));
+  char buf[64];
+  size_t n = 0;
+  for (size_t digit = (bits + shift - 1) / shift; digit-- > 0;) {
+    size_t bit = digit * shift;
+    size_t i = bit / 64;
+    unsigned offset = bit % 64;
+    uint64_t group = wordAt(i) >> offset;
+    if (offset + shift > 64 && i < top) {
+      group |= wordAt(i + 1) << (64 - offset);
+    }
+    buf[n++] = kDigitChars[group & mask];
+    if (n == sizeof(buf)) {
+      sink.write(buf, n);
+      n = 0;
+    }
+  }
+  sink.write(buf, n);
+}
+
+std::string NumericLiteral::digits() const {
+  if (!isInteger()) return text;
+  // Short digits stay within the string object
+  StringSink sink(15);
+  emitDigits(sink);
+  return sink.release();
+}
+
+void NumericLiteral::emit(Sink &sink) const {
+  // 32 bit unsigned decimals are emitted as plain digits, everything else
+  // needs a base, including decimals (`8'd7`, as `8'7` is not valid Verilog)
+  if (size == 32 && !_signed && radix == DECIMAL) {
+    emitDigits(sink);
+    return;
+  }
+  if (size != 32) {
+    char size_str[16];
+    char *size_end =
+        std::to_chars(size_str, size_str + sizeof(size_str), size).ptr;
+    sink.write(size_str, size_end - size_str);
+  }
+  sink << '\'';
+  if (_signed) sink << 's';
   switch (radix) {
     case BINARY:
-      radix_str = "b";
+      sink << 'b';
       break;
     case OCTAL:
-      radix_str = "o";
+      sink << 'o';
       break;
     case HEX:
-      radix_str = "h";
+      sink << 'h';
       break;
     case DECIMAL:
-      radix_str = "";
+      sink << 'd';
       break;
   }
-  std::string size_str = std::to_string(size);
-  if (size_str == "32") {
-    size_str = "";
-  }
-
-  std::string separator = "";
-  if (size_str + signed_str + radix_str != "") {
-    separator = "'";
-  }
-  return size_str + separator + signed_str + radix_str + value;
-}
-
-std::string Identifier::toString() {
-  static std::unordered_set<std::string> sKeywords{
-      // clang-format off
-      "accept_on",     "dist",          "local",                "randomize",       "task",
-      "alias",         "do",            "localparam",           "randsequence",    "this",
-      "always",        "edge",          "logic",                "rcmos",           "time",
-      "always_comb",   "else",          "longint",              "real",            "timeprecision",
-      "always_ff",     "end",           "macromodule",          "realtime",        "timeunit",
-      "always_latch",  "enum",          "matches",              "ref",             "tran",
-      "and",           "event",         "modport",              "reg",             "tranif0",
-      "assert",        "eventually",    "module",               "reject_on",       "tranif1",
-      "assign",        "expect",        "nand",                 "release",         "tri",
-      "assume",        "export",        "negedge",              "repeat",          "tri0",
-      "automatic",     "extends",       "nettype",              "restrict",        "tri1",
-      "begin",         "extern",        "new",                  "return",          "triand",
-      "bind",          "final",         "nexttime",             "rnmos",           "trior",
-      "bins",          "first_match",   "nmos",                 "rpmos",           "trireg",
-      "binsof",        "for",           "nor",                  "rtran",           "type",
-      "bit",           "force",         "noshowcancelled",      "rtranif0",        "type_option",
-      "break",         "foreach",       "not",                  "rtranif1",        "typedef",
-      "buf",           "forever",       "notif0",               "s_always",        "union",
-      "bufif0",        "fork",          "notif1",               "s_eventually",    "unique",
-      "bufif1",        "function",      "null",                 "s_nexttime",      "unique0",
-      "byte",          "generate",      "option",               "scalared",        "unsigned",
-      "case",          "genvar",        "or",                   "sequence",        "untyped",
-      "casex",         "global",        "output",               "shortint",        "use",
-      "casez",         "if",            "package",              "shortreal",       "uwire",
-      "cell",          "iff",           "packed",               "showcancelled",   "var",
-      "chandle",       "ifnone",        "parameter",            "signed",          "vectored",
-      "checker",       "ignore_bins",   "pmos",                 "soft",            "virtual",
-      "class",         "illegal_bins",  "posedge",              "solve",           "void",
-      "clocking",      "implements",    "primitive",            "specify",         "wait",
-      "cmos",          "import",        "priority",             "specparam",       "wait_order",
-      "config",        "initial",       "program",              "static",          "wand",
-      "const",         "inout",         "property",             "std",             "weak",
-      "constraint",    "input",         "property_expr",        "string",          "weak0",
-      "context",       "instance",      "protected",            "strong",          "weak1",
-      "continue",      "int",           "pull0",                "strong0",         "while",
-      "cover",         "integer",       "pull1",                "strong1",         "wildcard",
-      "covergroup",    "interconnect",  "pulldown",             "struct",          "wire",
-      "coverpoint",    "interface",     "pullup",               "super",           "with",
-      "cross",         "intersect",     "pulsestyle_ondetect",  "supply0",         "wor",
-      "deassign",      "join",          "pulsestyle_onevent",   "supply1",         "xnor",
-      "default",       "join_any",      "pure",                 "sync_accept_on",  "xor",
-      "defparam",      "join_none",     "rand",                 "sync_reject_on",
-      "design",        "let",           "randc",                "table",
-      "disable",       "liblist",       "randcase",             "tagged",
-      // clang-format on
-  };
-  static std::regex sSimpleIdentifierRE{"^[a-zA-Z$_][a-zA-Z$_0-9]*$"};
-  if (sKeywords.count(value) || !std::regex_match(value, sSimpleIdentifierRE))
-    return "\\" + value + " ";
+  emitDigits(sink);
+}
+
+namespace {
+
+// Reserved words (IEEE 1800-2017 Annex B), any identifier matching one of
+// these must be escaped
+constexpr std::string_view kKeywords[] = {
+    // clang-format off
+    "accept_on",     "dist",          "local",                "randomize",       "task",
+    "alias",         "do",            "localparam",           "randsequence",    "this",
+    "always",        "edge",          "logic",                "rcmos",           "time",
+    "always_comb",   "else",          "longint",              "real",            "timeprecision",
+    "always_ff",     "end",           "macromodule",          "realtime",        "timeunit",
+    "always_latch",  "enum",          "matches",              "ref",             "tran",
+    "and",           "event",         "modport",              "reg",             "tranif0",
+    "assert",        "eventually",    "module",               "reject_on",       "tranif1",
+    "assign",        "expect",        "nand",                 "release",         "tri",
+    "assume",        "export",        "negedge",              "repeat",          "tri0",
+    "automatic",     "extends",       "nettype",              "restrict",        "tri1",
+    "begin",         "extern",        "new",                  "return",          "triand",
+    "bind",          "final",         "nexttime",             "rnmos",           "trior",
+    "bins",          "first_match",   "nmos",                 "rpmos",           "trireg",
+    "binsof",        "for",           "nor",                  "rtran",           "type",
+    "bit",           "force",         "noshowcancelled",      "rtranif0",        "type_option",
+    "break",         "foreach",       "not",                  "rtranif1",        "typedef",
+    "buf",           "forever",       "notif0",               "s_always",        "union",
+    "bufif0",        "fork",          "notif1",               "s_eventually",    "unique",
+    "bufif1",        "function",      "null",                 "s_nexttime",      "unique0",
+    "byte",          "generate",      "option",               "scalared",        "unsigned",
+    "case",          "genvar",        "or",                   "sequence",        "untyped",
+    "casex",         "global",        "output",               "shortint",        "use",
+    "casez",         "if",            "package",              "shortreal",       "uwire",
+    "cell",          "iff",           "packed",               "showcancelled",   "var",
+    "chandle",       "ifnone",        "parameter",            "signed",          "vectored",
+    "checker",       "ignore_bins",   "pmos",                 "soft",            "virtual",
+    "class",         "illegal_bins",  "posedge",              "solve",           "void",
+    "clocking",      "implements",    "primitive",            "specify",         "wait",
+    "cmos",          "import",        "priority",             "specparam",       "wait_order",
+    "config",        "initial",       "program",              "static",          "wand",
+    "const",         "inout",         "property",             "std",             "weak",
+    "constraint",    "input",         "property_expr",        "string",          "weak0",
+    "context",       "instance",      "protected",            "strong",          "weak1",
+    "continue",      "int",           "pull0",                "strong0",         "while",
+    "cover",         "integer",       "pull1",                "strong1",         "wildcard",
+    "covergroup",    "interconnect",  "pulldown",             "struct",          "wire",
+    "coverpoint",    "interface",     "pullup",               "super",           "with",
+    "cross",         "intersect",     "pulsestyle_ondetect",  "supply0",         "wor",
+    "deassign",      "join",          "pulsestyle_onevent",   "supply1",         "xnor",
+    "default",       "join_any",      "pure",                 "sync_accept_on",  "xor",
+    "defparam",      "join_none",     "rand",                 "sync_reject_on",
+    "design",        "let",           "randc",                "table",
+    "disable",       "liblist",       "randcase",             "tagged",
+    // clang-format on
+};
+
+constexpr size_t kNumKeywords = sizeof(kKeywords) / sizeof(kKeywords[0]);
+
+constexpr size_t max_keyword_length() {
+  size_t length = 0;
+  for (auto keyword : kKeywords) {
+    if (keyword.size() > length) length = keyword.size();
+  }
+  return length;
+}
+constexpr size_t kMaxKeywordLength = max_keyword_length();
+
+// FNV-1a, usable in constant expressions
+constexpr uint32_t hash_keyword(std::string_view str) {
+  uint32_t hash = 2166136261u;
+  for (char c : str) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  return hash;
+}
+
+// Open addressing table of indices into kKeywords (offset by one so that zero
+// marks an empty slot), built at compile time
+constexpr size_t kKeywordTableSize = 1024;
+
+struct KeywordTable {
+  uint16_t slots[kKeywordTableSize] = {};
+  // Longest probe sequence needed by any keyword
+  size_t max_probe = 0;
+};
+
+constexpr KeywordTable make_keyword_table() {
+  KeywordTable table;
+  for (size_t i = 0; i < kNumKeywords; i++) {
+    size_t slot = hash_keyword(kKeywords[i]) & (kKeywordTableSize - 1);
+    size_t probe = 1;
+    while (table.slots[slot] != 0) {
+      slot = (slot + 1) & (kKeywordTableSize - 1);
+      probe++;
+    }
+    table.slots[slot] = static_cast<uint16_t>(i + 1);
+    if (probe > table.max_probe) table.max_probe = probe;
+  }
+  return table;
+}
+
+constexpr KeywordTable kKeywordTable = make_keyword_table();
+static_assert(kKeywordTable.max_probe <= 3,
+              "keyword hash table has too many collisions");
+
+constexpr bool is_keyword(std::string_view str) {
+  // All keywords are lower case (with underscores and digits)
+  if (str.size() < 2 || str.size() > kMaxKeywordLength || str[0] < 'a' ||
+      str[0] > 'z') {
+    return false;
+  }
+  size_t slot = hash_keyword(str) & (kKeywordTableSize - 1);
+  for (size_t i = 0; i < kKeywordTable.max_probe; i++) {
+    uint16_t entry = kKeywordTable.slots[slot];
+    if (entry == 0) return false;
+    if (kKeywords[entry - 1] == str) return true;
+    slot = (slot + 1) & (kKeywordTableSize - 1);
+  }
+  return false;
+}
+
+static_assert(is_keyword("module") && is_keyword("wire") &&
+                  is_keyword("tagged") && !is_keyword("x") &&
+                  !is_keyword("modules"),
+              "keyword lookup is broken");
+
+// Character classes for simple identifiers: `[a-zA-Z$_][a-zA-Z$_0-9]*`
+enum : uint8_t { kIdStart = 1, kIdPart = 2 };
+
+constexpr std::array<uint8_t, 256> make_identifier_classes() {
+  std::array<uint8_t, 256> classes{};
+  for (int c = 'a'; c <= 'z'; c++) classes[c] = kIdStart | kIdPart;
+  for (int c = 'A'; c <= 'Z'; c++) classes[c] = kIdStart | kIdPart;
+  for (int c = '0'; c <= '9'; c++) classes[c] = kIdPart;
+  classes['_'] = kIdStart | kIdPart;
+  classes['$'] = kIdStart | kIdPart;
+  return classes;
+}
+
+constexpr std::array<uint8_t, 256> kIdentifierClasses =
+    make_identifier_classes();
+
+}  // namespace
+
+bool Identifier::needsEscape(std::string_view name) {
+  if (name.empty() ||
+      !(kIdentifierClasses[static_cast<uint8_t>(name[0])] & kIdStart)) {
+    return true;
+  }
+  for (char c : name.substr(1)) {
+    if (!(kIdentifierClasses[static_cast<uint8_t>(c)] & kIdPart)) return true;
+  }
+  return is_keyword(name);
+}
+
+void Identifier::emit(Sink &sink) const {
+  if (value.needsEscape())
+    sink << '\\' << value.str() << ' ';
   else
-    return value;
+    sink << value.str();
 }
 
-std::string String::toString() { return "\"" + value + "\""; }
+void String::emit(Sink &sink) const { sink << '"' << value << '"'; }
+
+namespace {
+
+// Binary operators, padded with the surrounding spaces, indexed by BinOp
+constexpr std::string_view kBinOpStrings[] = {
+    " << ", " >> ", " && ", " || ", " == ", " != ", " + ",
+    " - ",  " * ",  " / ",  " ** ", " % ",  " <<< ", " >>> "};
+static_assert(sizeof(kBinOpStrings) / sizeof(kBinOpStrings[0]) ==
+                  BinOp::ARSHIFT + 1,
+              "kBinOpStrings does not match BinOp");
 
-std::string Index::toString() {
-  return id->toString() + '[' + index->toString() + ']';
+// Unary operators, followed by a space, indexed by UnOp
+constexpr std::string_view kUnOpStrings[] = {"! ",  "~ ",  "& ", "~& ",
+                                             "| ",  "~| ", "^ ", "~^ ",
+                                             "^~ ", "+ ",  "- "};
+static_assert(sizeof(kUnOpStrings) / sizeof(kUnOpStrings[0]) ==
+                  UnOp::MINUS + 1,
+              "kUnOpStrings does not match UnOp");
+
+// Text of `op` without the surrounding spaces in compact mode
+std::string_view binop_string(BinOp::BinOp op, bool compact) {
+  std::string_view text = kBinOpStrings[op];
+  return compact ? text.substr(1, text.size() - 2) : text;
 }
 
-std::string Slice::toString() {
-  return id->toString() + '[' + high_index->toString() + ':' +
-         low_index->toString() + ']';
+std::string_view unop_string(UnOp::UnOp op, bool compact) {
+  std::string_view text = kUnOpStrings[op];
+  return compact ? text.substr(0, text.size() - 1) : text;
 }
 
-std::string Vector::toString() {
-  return "[" + msb->toString() + ':' + lsb->toString() + "] " + id->toString();
+// `text` in readable mode, `compact_text` in compact mode
+std::string_view layout(const Sink &sink, std::string_view text,
+                        std::string_view compact_text) {
+  return sink.options.compact ? compact_text : text;
 }
 
-std::string BinaryOp::toString() {
-  std::string op_str;
-  switch (op) {
-    case BinOp::LSHIFT:
-      op_str = "<<";
-      break;
-    case BinOp::RSHIFT:
-      op_str = ">>";
-      break;
-    case BinOp::AND:
-      op_str = "&&";
-      break;
-    case BinOp::OR:
-      op_str = "||";
-      break;
-    case BinOp::EQ:
-      op_str = "==";
-      break;
-    case BinOp::NEQ:
-      op_str = "!=";
-      break;
-    case BinOp::ADD:
-      op_str = "+";
-      break;
-    case BinOp::SUB:
-      op_str = "-";
-      break;
-    case BinOp::MUL:
-      op_str = "*";
-      break;
-    case BinOp::DIV:
-      op_str = "/";
-      break;
-    case BinOp::POW:
-      op_str = "**";
-      break;
-    case BinOp::MOD:
-      op_str = "%";
-      break;
-    case BinOp::ALSHIFT:
-      op_str = "<<<";
-      break;
-    case BinOp::ARSHIFT:
-      op_str = ">>>";
-      break;
+// Parentheses are only emitted where the precedence (or associativity) of
+// the operators would otherwise regroup the operands
+bool needs_parens(const Expression &operand, unsigned min_precedence) {
+  return detail::precedence(operand) < min_precedence;
+}
+
+// Whether the first token emitted for `operand` is a unary operator, found by
+// following the left operands that are not parenthesized
+bool starts_with_unary(const Expression &operand) {
+  const Expression *expr = &operand;
+  while (true) {
+    switch (expr->kind()) {
+      case NodeKind::UNARY_OP:
+        return true;
+      case NodeKind::BINARY_OP: {
+        auto &binary_op = static_cast<const BinaryOp &>(*expr);
+        expr = binary_op.left.get();
+        if (needs_parens(*expr, detail::kBinOpPrecedence[binary_op.op])) {
+          return false;
+        }
+        break;
+      }
+      case NodeKind::TERNARY_OP:
+        expr = static_cast<const TernaryOp &>(*expr).cond.get();
+        if (needs_parens(*expr, detail::kTernaryPrecedence + 1)) return false;
+        break;
+      default:
+        return false;
+    }
   }
-  return left->toString() + ' ' + op_str + ' ' + right->toString();
 }
 
-std::string UnaryOp::toString() {
-  std::string op_str;
-  switch (op) {
-    case UnOp::NOT:
-      op_str = "!";
-      break;
-    case UnOp::INVERT:
-      op_str = "~";
-      break;
-    case UnOp::AND:
-      op_str = "&";
-      break;
-    case UnOp::NAND:
-      op_str = "~&";
-      break;
-    case UnOp::OR:
-      op_str = "|";
-      break;
-    case UnOp::NOR:
-      op_str = "~|";
-      break;
-    case UnOp::XOR:
-      op_str = "^";
-      break;
-    case UnOp::NXOR:
-      op_str = "~^";
-      break;
-    case UnOp::XNOR:
-      op_str = "^~";
-      break;
-    case UnOp::PLUS:
-      op_str = "+";
-      break;
-    case UnOp::MINUS:
-      op_str = "-";
-      break;
+// In compact mode an operand starting with a unary operator that directly
+// follows another operator is separated by a space, as e.g. `a--b`, `a&&&b`
+// or `~&b` would lex differently
+bool needs_space(const Expression &operand, bool parens, bool compact) {
+  return compact && !parens && starts_with_unary(operand);
+}
+
+void emit_operand(Sink &sink, const Expression &operand, bool parens) {
+  if (parens) sink << '(';
+  operand.emit(sink);
+  if (parens) sink << ')';
+}
+
+// Pending work while emitting an expression: `text` is written first, then
+// `node` (if any) is emitted
+struct EmitItem {
+  std::string_view text;
+  const Expression *node;
+};
+
+// Work stack reused by successive `emit_expression` calls on a thread, so
+// that emission does not allocate in the steady state
+thread_local std::vector<EmitItem> emit_stack;
+
+// Emits an expression tree with an explicit stack rather than recursion, used
+// once the recursive `emit` gets too deep (see `EmitDepth`) so that
+// arbitrarily deep trees (e.g. long reduction chains) can be emitted.  Items
+// are pushed in reverse order of output.
+void emit_expression(Sink &sink, const Expression &root) {
+  // Taking the thread's stack (rather than sharing it) keeps this reentrant,
+  // e.g. for expression subclasses defined outside of the library
+  std::vector<EmitItem> stack;
+  stack.swap(emit_stack);
+  stack.clear();
+  stack.push_back({{}, &root});
+  bool compact = sink.options.compact;
+  // Pushes `text` followed by `operand`, in parentheses or after a space
+  auto push_operand = [&stack](std::string_view text,
+                               const Expression *operand, bool parens,
+                               bool space) {
+    if (parens) {
+      stack.push_back({")", nullptr});
+      stack.push_back({"(", operand});
+    } else if (space) {
+      stack.push_back({" ", operand});
+    } else {
+      stack.push_back({text, operand});
+      return;
+    }
+    if (!text.empty()) stack.push_back({text, nullptr});
+  };
+  while (!stack.empty()) {
+    EmitItem item = stack.back();
+    stack.pop_back();
+    if (!item.text.empty()) sink << item.text;
+    if (!item.node) continue;
+    const Expression &node = *item.node;
+    switch (node.kind()) {
+      case NodeKind::NUMERIC_LITERAL:
+        static_cast<const NumericLiteral &>(node).NumericLiteral::emit(sink);
+        break;
+      case NodeKind::IDENTIFIER:
+        static_cast<const Identifier &>(node).Identifier::emit(sink);
+        break;
+      case NodeKind::STRING:
+        static_cast<const String &>(node).String::emit(sink);
+        break;
+      case NodeKind::INDEX: {
+        auto &index = static_cast<const Index &>(node);
+        stack.push_back({"]", nullptr});
+        stack.push_back({"[", index.index.get()});
+        stack.push_back({{}, index.id.get()});
+        break;
+      }
+      case NodeKind::SLICE: {
+        auto &slice = static_cast<const Slice &>(node);
+        stack.push_back({"]", nullptr});
+        stack.push_back({":", slice.low_index.get()});
+        stack.push_back({"[", slice.high_index.get()});
+        stack.push_back({{}, slice.id.get()});
+        break;
+      }
+      case NodeKind::BINARY_OP: {
+        auto &binary_op = static_cast<const BinaryOp &>(node);
+        // Left associative
+        unsigned precedence = detail::kBinOpPrecedence[binary_op.op];
+        bool parens = needs_parens(*binary_op.right, precedence + 1);
+        push_operand(binop_string(binary_op.op, compact),
+                     binary_op.right.get(), parens,
+                     needs_space(*binary_op.right, parens, compact));
+        push_operand({}, binary_op.left.get(),
+                     needs_parens(*binary_op.left, precedence), false);
+        break;
+      }
+      case NodeKind::UNARY_OP: {
+        auto &unary_op = static_cast<const UnaryOp &>(node);
+        bool parens =
+            needs_parens(*unary_op.operand, detail::kUnaryPrecedence);
+        push_operand(unop_string(unary_op.op, compact),
+                     unary_op.operand.get(), parens,
+                     needs_space(*unary_op.operand, parens, compact));
+        break;
+      }
+      case NodeKind::TERNARY_OP: {
+        auto &ternary_op = static_cast<const TernaryOp &>(node);
+        stack.push_back(
+            {compact ? ":" : " : ", ternary_op.false_value.get()});
+        stack.push_back({compact ? "?" : " ? ", ternary_op.true_value.get()});
+        // Right associative
+        push_operand({}, ternary_op.cond.get(),
+                     needs_parens(*ternary_op.cond,
+                                  detail::kTernaryPrecedence + 1),
+                     false);
+        break;
+      }
+      case NodeKind::CONCAT: {
+        auto &args = static_cast<const Concat &>(node).args;
+        stack.push_back({"}", nullptr});
+        for (size_t i = args.size(); i-- > 1;) {
+          stack.push_back({",", args[i].get()});
+        }
+        stack.push_back({"{", args.empty() ? nullptr : args[0].get()});
+        break;
+      }
+      case NodeKind::NEG_EDGE:
+        stack.push_back(
+            {"negedge ", static_cast<const NegEdge &>(node).value.get()});
+        break;
+      case NodeKind::POS_EDGE:
+        stack.push_back(
+            {"posedge ", static_cast<const PosEdge &>(node).value.get()});
+        break;
+      default:
+        // Expression subclasses defined outside of the library
+        node.emit(sink);
+        break;
+    }
+  }
+  stack.swap(emit_stack);
+}
+
+// Tracks the nesting of the recursive expression `emit`s into a sink.
+// Recursion is faster than `emit_expression` for trees of a typical depth,
+// beyond `kMaxEmitDepth` the remaining subtree is emitted iteratively.
+constexpr unsigned kMaxEmitDepth = 256;
+
+class EmitDepth {
+  Sink &sink;
+
+ public:
+  explicit EmitDepth(Sink &sink) : sink(sink) { sink.expression_depth++; }
+  ~EmitDepth() { sink.expression_depth--; }
+  bool tooDeep() const { return sink.expression_depth > kMaxEmitDepth; }
+};
+
+// Moves the expression held by `slot` onto `work` if it has children of its
+// own, leaves are simply destroyed along with their parent
+template <typename T>
+void detach_expression(std::unique_ptr<T> &slot,
+                       std::vector<std::unique_ptr<Expression>> &work) {
+  if constexpr (std::is_base_of_v<Expression, T>) {
+    if (slot && slot->kind() > NodeKind::STRING) {
+      work.emplace_back(slot.release());
+    }
+  }
+}
+
+template <typename... Ts>
+void detach_expression(std::variant<std::unique_ptr<Ts>...> &slot,
+                       std::vector<std::unique_ptr<Expression>> &work) {
+  std::visit([&work](auto &ptr) { detach_expression(ptr, work); }, slot);
+}
+
+}  // namespace
+
+namespace detail {
+
+void dismantle(Expression &root) {
+  std::vector<std::unique_ptr<Expression>> work;
+  auto detach_children = [&work](Node &node) {
+    for_each_child(node, [&work](auto &slot) { detach_expression(slot, work); });
+  };
+  detach_children(root);
+  while (!work.empty()) {
+    std::unique_ptr<Expression> node = std::move(work.back());
+    work.pop_back();
+    // Detached before `node` is destroyed, so its destructor has nothing left
+    // to recurse into
+    detach_children(*node);
   }
-  return op_str + ' ' + operand->toString();
 }
 
-std::string TernaryOp::toString() {
-  return cond->toString() + " ? " + true_value->toString() + " : " +
-         false_value->toString();
+}  // namespace detail
+
+void Index::emit(Sink &sink) const {
+  EmitDepth depth(sink);
+  if (depth.tooDeep()) return emit_expression(sink, *this);
+  id->emit(sink);
+  sink << '[';
+  index->emit(sink);
+  sink << ']';
+}
+
+Index::~Index() { detail::dismantle(*this); }
+
+void Slice::emit(Sink &sink) const {
+  EmitDepth depth(sink);
+  if (depth.tooDeep()) return emit_expression(sink, *this);
+  id->emit(sink);
+  sink << '[';
+  high_index->emit(sink);
+  sink << ':';
+  low_index->emit(sink);
+  sink << ']';
+}
+
+Slice::~Slice() { detail::dismantle(*this); }
+
+void Vector::emit(Sink &sink) const {
+  sink << '[';
+  msb->emit(sink);
+  sink << ':';
+  lsb->emit(sink);
+  sink << layout(sink, "] ", "]");
+  id->emit(sink);
+}
+
+void BinaryOp::emit(Sink &sink) const {
+  EmitDepth depth(sink);
+  if (depth.tooDeep()) return emit_expression(sink, *this);
+  bool compact = sink.options.compact;
+  // Left associative
+  unsigned precedence = detail::kBinOpPrecedence[op];
+  emit_operand(sink, *left, needs_parens(*left, precedence));
+  sink << binop_string(op, compact);
+  bool parens = needs_parens(*right, precedence + 1);
+  if (needs_space(*right, parens, compact)) sink << ' ';
+  emit_operand(sink, *right, parens);
 }
 
-std::string Concat::toString() {
-  std::vector<std::string> arg_strs;
-  for (auto &arg : args) {
-    arg_strs.push_back(arg->toString());
+BinaryOp::~BinaryOp() { detail::dismantle(*this); }
+
+void UnaryOp::emit(Sink &sink) const {
+  EmitDepth depth(sink);
+  if (depth.tooDeep()) return emit_expression(sink, *this);
+  bool compact = sink.options.compact;
+  sink << unop_string(op, compact);
+  bool parens = needs_parens(*operand, detail::kUnaryPrecedence);
+  if (needs_space(*operand, parens, compact)) sink << ' ';
+  emit_operand(sink, *operand, parens);
+}
+
+UnaryOp::~UnaryOp() { detail::dismantle(*this); }
+
+void TernaryOp::emit(Sink &sink) const {
+  EmitDepth depth(sink);
+  if (depth.tooDeep()) return emit_expression(sink, *this);
+  // Right associative
+  emit_operand(sink, *cond,
+               needs_parens(*cond, detail::kTernaryPrecedence + 1));
+  sink << layout(sink, " ? ", "?");
+  true_value->emit(sink);
+  sink << layout(sink, " : ", ":");
+  false_value->emit(sink);
+}
+
+TernaryOp::~TernaryOp() { detail::dismantle(*this); }
+
+void Concat::emit(Sink &sink) const {
+  EmitDepth depth(sink);
+  if (depth.tooDeep()) return emit_expression(sink, *this);
+  sink << '{';
+  for (size_t i = 0; i < args.size(); i++) {
+    if (i > 0) sink << ',';
+    args[i]->emit(sink);
   }
-  return "{" + join(arg_strs, ",") + "}";
+  sink << '}';
 }
 
-std::string NegEdge::toString() { return "negedge " + value->toString(); }
+Concat::~Concat() { detail::dismantle(*this); }
 
-std::string PosEdge::toString() { return "posedge " + value->toString(); }
+void NegEdge::emit(Sink &sink) const {
+  EmitDepth depth(sink);
+  if (depth.tooDeep()) return emit_expression(sink, *this);
+  sink << "negedge ";
+  value->emit(sink);
+}
+
+NegEdge::~NegEdge() { detail::dismantle(*this); }
+
+void PosEdge::emit(Sink &sink) const {
+  EmitDepth depth(sink);
+  if (depth.tooDeep()) return emit_expression(sink, *this);
+  sink << "posedge ";
+  value->emit(sink);
+}
+
+PosEdge::~PosEdge() { detail::dismantle(*this); }
 
 template <typename... Ts>
-std::string variant_to_string(std::variant<Ts...> &value) {
-  return std::visit(
-      [](auto &&value) -> std::string { return value->toString(); }, value);
+void emit_variant(Sink &sink, const std::variant<Ts...> &value) {
+  std::visit([&sink](auto &&value) { value->emit(sink); }, value);
 }
 
-std::string Port::toString() {
-  std::string value_str =
-      variant_to_string<std::unique_ptr<Identifier>, std::unique_ptr<Vector>>(
-          value);
-  std::string direction_str;
+void Port::emit(Sink &sink) const {
   switch (direction) {
     case INPUT:
-      direction_str = "input";
+      sink << "input";
       break;
     case OUTPUT:
-      direction_str = "output";
+      sink << "output";
       break;
     case INOUT:
-      direction_str = "inout";
+      sink << "inout";
       break;
   }
 
-  std::string data_type_str;
   switch (data_type) {
     case WIRE:
-      data_type_str = "";
       break;
     case REG:
-      data_type_str = "reg ";
+      sink << " reg";
       break;
   }
-  return direction_str + " " + data_type_str + value_str;
+  // A vector starts with `[`, which needs no space in compact mode
+  if (!sink.options.compact ||
+      !std::holds_alternative<std::unique_ptr<Vector>>(value)) {
+    sink << ' ';
+  }
+  emit_variant(sink, value);
 }
 
-std::string Module::emitModuleHeader() {
-  std::string module_header_str = "module " + name;
+void Module::emitModuleHeader(Sink &sink) const {
+  sink << "module " << name;
 
   // emit parameter string
   if (!parameters.empty()) {
-    module_header_str += " #(";
-    std::vector<std::string> param_strs;
-    for (auto &it : parameters) {
-      param_strs.push_back("parameter " + it.first->toString() + " = " +
-                           it.second->toString());
+    sink << layout(sink, " #(", "#(");
+    for (size_t i = 0; i < parameters.size(); i++) {
+      if (i > 0) sink << layout(sink, ", ", ",");
+      sink << "parameter ";
+      parameters[i].first->emit(sink);
+      sink << layout(sink, " = ", "=");
+      parameters[i].second->emit(sink);
     }
-    module_header_str += join(param_strs, ", ");
-    module_header_str += ")";
+    sink << ')';
   }
 
   // emit port string
-  module_header_str += " (";
-  std::vector<std::string> ports_strs;
-  for (auto &it : ports) ports_strs.push_back(it->toString());
-  module_header_str += join(ports_strs, ", ");
-  module_header_str += ");\n";
-  return module_header_str;
+  sink << layout(sink, " (", "(");
+  for (size_t i = 0; i < ports.size(); i++) {
+    if (i > 0) sink << layout(sink, ", ", ",");
+    ports[i]->emit(sink);
+  }
+  sink << ");\n";
+}
+
+void Module::emit(Sink &sink) const {
+  if (!sink.stats) {
+    emitCached(sink);
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  size_t bytes = sink.bytesWritten();
+  emitCached(sink);
+  auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start);
+  sink.stats->record(*this, sink.bytesWritten() - bytes, time);
+}
+
+void Module::emitCached(Sink &sink) const {
+  if (!cache_emission) {
+    if (emission_cache) {
+      unregisterEmission();
+      emission_cache.reset();
+    }
+    emitUncached(sink);
+    return;
+  }
+  if (!emission_cache || !emission_current ||
+      emission_cache->options != sink.options ||
+      emission_cache->name != name ||
+      emission_cache->num_ports != ports.size() ||
+      emission_cache->body_size != bodySize()) {
+    StringSink module_sink;
+    module_sink.options = sink.options;
+    emitUncached(module_sink);
+    if (!emission_cache) emission_cache = std::make_unique<EmissionCache>();
+    emission_cache->text = module_sink.release();
+    emission_cache->options = sink.options;
+    emission_cache->name = name;
+    emission_cache->num_ports = ports.size();
+    emission_cache->body_size = bodySize();
+    registerEmission();
+  }
+  sink << emission_cache->text;
+}
+
+size_t Module::bodySize() const {
+  if (kind() == NodeKind::STRING_BODY_MODULE) {
+    return static_cast<const StringBodyModule *>(this)->body.size();
+  }
+  return body.size();
+}
+
+namespace {
+
+// Module whose cached text holds each node with `emission_current` set.
+// Modules are emitted concurrently, so the map is shared under a lock.
+struct EmissionOwners {
+  std::mutex mutex;
+  std::unordered_map<const Node *, const Module *> owners;
+};
+
+EmissionOwners &emission_owners() {
+  // Leaked, as nodes may be destroyed during static destruction
+  static auto *owners = new EmissionOwners();
+  return *owners;
+}
+
+}  // namespace
+
+void Node::releaseEmission() const {
+  emission_current = 0;
+  EmissionOwners &registry = emission_owners();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = registry.owners.find(this);
+  if (it == registry.owners.end()) return;
+  it->second->emission_current = 0;
+  registry.owners.erase(it);
+}
+
+void Module::registerEmission() const {
+  EmissionOwners &registry = emission_owners();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::vector<const Node *> stack{this};
+  while (!stack.empty()) {
+    const Node *node = stack.back();
+    stack.pop_back();
+    if (!node) continue;
+    node->emission_current = 1;
+    if (node != this) registry.owners[node] = this;
+    // for_each_child only needs a non-const node to hand out mutable slots
+    detail::for_each_child(const_cast<Node &>(*node), [&](auto &slot) {
+      stack.push_back(detail::slot_node(slot));
+    });
+  }
 }
 
-std::string Module::toString() {
-  std::string module_str = "";
-  module_str += emitModuleHeader();
+void Module::unregisterEmission() const {
+  EmissionOwners &registry = emission_owners();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::vector<const Node *> stack{this};
+  while (!stack.empty()) {
+    const Node *node = stack.back();
+    stack.pop_back();
+    if (!node) continue;
+    if (node->emission_current && node != this) {
+      auto it = registry.owners.find(node);
+      if (it != registry.owners.end() && it->second == this) {
+        registry.owners.erase(it);
+      }
+    }
+    node->emission_current = 0;
+    detail::for_each_child(const_cast<Node &>(*node), [&](auto &slot) {
+      stack.push_back(detail::slot_node(slot));
+    });
+  }
+}
+
+Module::~Module() {
+  // The nodes are destroyed after this, without looking up their owner
+  if (emission_cache) unregisterEmission();
+}
+
+void Module::emitUncached(Sink &sink) const {
+  emitModuleHeader(sink);
 
   // emit body
   for (auto &statement : body) {
-    module_str += variant_to_string<std::unique_ptr<StructuralStatement>,
-                                    std::unique_ptr<Declaration>>(statement) +
-                  "\n";
+    emit_variant(sink, statement);
+    sink << '\n';
   }
 
-  module_str += "endmodule\n";
-  return module_str;
+  sink << "endmodule\n";
+}
+
+void StringBodyModule::emitUncached(Sink &sink) const {
+  emitModuleHeader(sink);
+  sink << body;
+  sink << "\nendmodule\n";
 }
 
-std::string StringBodyModule::toString() {
-  std::string module_str = "";
-  module_str += emitModuleHeader();
-  module_str += body;
-  module_str += "\nendmodule\n";
-  return module_str;
+ModuleInstantiation::ModuleInstantiation(
+    std::string_view module_name, Parameters parameters,
+    std::string_view instance_name,
+    std::map<std::string, Connection> connections)
+    : module_name(SymbolTable::current().intern(module_name)),
+      parameters(std::move(parameters)),
+      instance_name(SymbolTable::current().intern(instance_name)) {
+  SymbolTable &symbols = SymbolTable::current();
+  this->connections.reserve(connections.size());
+  for (auto &it : connections) {
+    this->connections.emplace_back(symbols.intern(it.first),
+                                   std::move(it.second));
+  }
 }
 
-std::string ModuleInstantiation::toString() {
-  std::string module_inst_str = "";
-  module_inst_str += module_name;
+ConnectionIndex::ConnectionIndex(const ModuleInstantiation &inst) {
+  positions.reserve(inst.connections.size());
+  for (size_t i = 0; i < inst.connections.size(); i++) {
+    positions.emplace(inst.connections[i].first, i);
+  }
+}
+
+void ModuleInstantiation::emit(Sink &sink) const {
+  sink << module_name.str();
   if (!parameters.empty()) {
-    module_inst_str += " #(";
-    std::vector<std::string> param_strs;
-    for (auto &it : parameters) {
-      param_strs.push_back("." + it.first->toString() + "(" +
-                           it.second->toString() + ")");
-    }
-    module_inst_str += join(param_strs, ", ");
-    module_inst_str += ")";
-  }
-  module_inst_str += " " + instance_name + "(";
-  if (!connections.empty()) {
-    std::vector<std::string> param_strs;
-    for (auto &it : connections) {
-      param_strs.push_back("." + it.first + "(" + variant_to_string(it.second) +
-                           ")");
+    sink << layout(sink, " #(", "#(");
+    for (size_t i = 0; i < parameters.size(); i++) {
+      if (i > 0) sink << layout(sink, ", ", ",");
+      sink << '.';
+      parameters[i].first->emit(sink);
+      sink << '(';
+      parameters[i].second->emit(sink);
+      sink << ')';
     }
-    module_inst_str += join(param_strs, ", ");
+    sink << ')';
+  }
+  sink << ' ' << instance_name.str() << '(';
+  bool first = true;
+  for (auto &it : connections) {
+    if (!first) sink << layout(sink, ", ", ",");
+    first = false;
+    sink << '.' << it.first.str() << '(';
+    emit_variant(sink, it.second);
+    sink << ')';
   }
-  module_inst_str += ");";
-  return module_inst_str;
+  sink << ");";
+}
+
+void Declaration::emit(Sink &sink) const {
+  sink << decl();
+  // A vector starts with `[`, which needs no space in compact mode
+  if (!sink.options.compact ||
+      !std::holds_alternative<std::unique_ptr<Vector>>(value)) {
+    sink << ' ';
+  }
+  emit_variant(sink, value);
+  sink << ';';
+}
+
+std::string_view Assign::prefix() const {
+  if (auto str = reinterpret_cast<const std::string *>(tagged_prefix &
+                                                       ~kKindMask)) {
+    return *str;
+  }
+  return assignKind() == AssignKind::CONTINUOUS ? "assign " : "";
+}
+
+namespace {
+
+// Pool of the prefixes set with `Assign::setPrefix`.  There are only a few
+// distinct ones (e.g. delays), so they are kept for the lifetime of the
+// program, apart from the names in the SymbolTables.
+const std::string &intern_prefix(std::string_view prefix) {
+  static std::mutex mutex;
+  // Never destroyed, assignments may be destroyed during static destruction
+  static auto *pool = new std::unordered_set<std::string>();
+  std::lock_guard<std::mutex> lock(mutex);
+  // Elements of an unordered_set do not move when it grows
+  return *pool->emplace(prefix).first;
 }
 
-std::string Declaration::toString() {
-  return decl + " " + variant_to_string(value) + ";";
+}  // namespace
+
+void Assign::setPrefix(std::string_view prefix) {
+  // Assign is not a Node, the statement is found from the kind
+  switch (assignKind()) {
+    case AssignKind::CONTINUOUS:
+      static_cast<ContinuousAssign *>(this)->invalidateHash();
+      break;
+    case AssignKind::BLOCKING:
+      static_cast<BlockingAssign *>(this)->invalidateHash();
+      break;
+    case AssignKind::NON_BLOCKING:
+      static_cast<NonBlockingAssign *>(this)->invalidateHash();
+      break;
+  }
+  tagged_prefix &= kKindMask;
+  if (prefix == (assignKind() == AssignKind::CONTINUOUS ? "assign " : "")) {
+    return;
+  }
+  static_assert(alignof(std::string) > kKindMask);
+  tagged_prefix |= reinterpret_cast<uintptr_t>(&intern_prefix(prefix));
 }
 
-std::string Assign::toString() {
-  return prefix + variant_to_string(target) + " " + symbol + " " +
-         value->toString() + ";";
+void Assign::emit(Sink &sink) const {
+  sink << prefix();
+  emit_variant(sink, target);
+  if (sink.options.compact) {
+    sink << symbol();
+  } else {
+    sink << ' ' << symbol() << ' ';
+  }
+  value->emit(sink);
+  sink << ';';
 }
 
-std::string Always::toString() {
-  std::string always_str = "";
-  always_str += "always @(";
+void Always::emit(Sink &sink) const {
+  sink << layout(sink, "always @(", "always@(");
 
   // emit sensitivity string
-  std::vector<std::string> sensitivity_strs;
-  for (auto &it : sensitivity_list) {
-    sensitivity_strs.push_back(variant_to_string(it));
+  for (size_t i = 0; i < sensitivity_list.size(); i++) {
+    if (i > 0) sink << layout(sink, ", ", ",");
+    emit_variant(sink, sensitivity_list[i]);
   }
-  always_str += join(sensitivity_strs, ", ");
-  always_str += ") begin\n";
+  sink << layout(sink, ") begin\n", ")begin\n");
 
   // emit body
   for (auto &statement : body) {
-    always_str += variant_to_string<std::unique_ptr<BehavioralStatement>,
-                                    std::unique_ptr<Declaration>>(statement) +
-                  "\n";
+    emit_variant(sink, statement);
+    sink << '\n';
+  }
+
+  sink << "end\n";
+}
+
+namespace {
+
+// Sets the options of a sink to those of a file for the lifetime of the
+// scope object
+class FileOptionsScope {
+  Sink &sink;
+  EmitOptions saved;
+  size_t start_bytes;
+  size_t start_stats_bytes;
+
+ public:
+  FileOptionsScope(Sink &sink, const File &file)
+      : sink(sink),
+        saved(sink.options),
+        start_bytes(sink.bytesWritten()),
+        start_stats_bytes(sink.stats ? sink.stats->bytes : 0) {
+    sink.options = file.emit_options;
+  }
+  ~FileOptionsScope() { sink.options = saved; }
+
+  // Counts every byte written since the start of the scope in the stats of
+  // the sink, if any, including those between the modules
+  void recordBytes() {
+    if (sink.stats) {
+      sink.stats->bytes =
+          start_stats_bytes + (sink.bytesWritten() - start_bytes);
+    }
   }
+};
 
-  always_str += "end\n";
-  return always_str;
+}  // namespace
+
+void File::emit(Sink &sink) const {
+  FileOptionsScope scope(sink, *this);
+  for (size_t i = 0; i < modules.size(); i++) {
+    if (i > 0 && !emit_options.compact) sink << '\n';
+    modules[i]->emit(sink);
+  }
+  scope.recordBytes();
 }
 
-std::string File::toString() {
-  std::string file_str = "";
+void File::emit(Sink &sink, ThreadPool &pool) const {
+  // Modules are emitted in windows so that only a bounded number of emitted
+  // modules are held in memory before being written out in order
+  size_t window = 4 * pool.size();
+  std::vector<std::string> outputs(std::min(window, modules.size()));
+  // Each module records into its own stats, merged in order
+  std::vector<EmitStats> stats(sink.stats ? outputs.size() : 0);
+  FileOptionsScope scope(sink, *this);
+  for (size_t start = 0; start < modules.size(); start += window) {
+    size_t count = std::min(window, modules.size() - start);
+    pool.parallelFor(count, [&](size_t i) {
+      StringSink module_sink;
+      module_sink.options = emit_options;
+      if (sink.stats) module_sink.stats = &stats[i];
+      modules[start + i]->emit(module_sink);
+      outputs[i] = module_sink.release();
+    });
+    for (size_t i = 0; i < count; i++) {
+      if (start + i > 0 && !emit_options.compact) sink << '\n';
+      sink << outputs[i];
+      outputs[i] = std::string();
+      if (sink.stats) {
+        sink.stats->merge(stats[i]);
+        stats[i].clear();
+      }
+    }
+  }
+  scope.recordBytes();
+}
 
-  std::vector<std::string> file_strs;
+void File::cacheEmission(bool enable) {
   for (auto &module : modules) {
-    file_strs.push_back(module->toString());
+    if (module->kind() == NodeKind::MODULE ||
+        module->kind() == NodeKind::STRING_BODY_MODULE) {
+      static_cast<Module &>(*module).cache_emission = enable;
+    }
   }
+}
 
-  return join(file_strs, "\n");
+std::string File::toString(ThreadPool &pool) const {
+  StringSink sink;
+  emit(sink, pool);
+  return sink.release();
+}
+
+std::unique_ptr<Identifier> make_id(std::string_view name) {
+  return std::make_unique<Identifier>(name);
 }
 
-std::unique_ptr<Identifier> make_id(std::string name) {
+std::unique_ptr<Identifier> make_id(Symbol name) {
   return std::make_unique<Identifier>(name);
 }
 
@@ -0,0 +1,260 @@
+#include "width.hpp"
+
+#include <algorithm>
+
+#include "children.hpp"
+#include "constant.hpp"
+#include "structural.hpp"
+
+namespace verilogAST {
+namespace detail {
+
+namespace {
+
+struct DeclareNet {
+  NetWidths &widths;
+
+  void operator()(const std::unique_ptr<Identifier> &id) {
+    widths[id->value] = 1;
+  }
+  void operator()(const std::unique_ptr<Vector> &vector) {
+    widths[vector->id->value] = range_width(*vector->msb, *vector->lsb);
+  }
+  // Arrays
+  void operator()(const std::unique_ptr<Index> &index) {
+    widths[index->id->value] = kUnknownWidth;
+  }
+  void operator()(const std::unique_ptr<Slice> &slice) {
+    widths[slice->id->value] = kUnknownWidth;
+  }
+};
+
+}  // namespace
+
+NetWidths net_widths(const Module &module) {
+  NetWidths widths;
+  DeclareNet declare{widths};
+  for (auto &port : module.ports) {
+    if (port->kind() == NodeKind::PORT) {
+      std::visit(declare, static_cast<const Port &>(*port).value);
+    }
+  }
+  for (auto &statement : module.body) {
+    if (auto decl = std::get_if<std::unique_ptr<Declaration>>(&statement)) {
+      std::visit(declare, (*decl)->value);
+    }
+  }
+  return widths;
+}
+
+unsigned range_width(const Expression &high, const Expression &low) {
+  std::optional<Constant> msb = evaluate(high);
+  std::optional<Constant> lsb = evaluate(low);
+  if (!msb || !lsb) return kUnknownWidth;
+  uint64_t width = (msb->value > lsb->value ? msb->value - lsb->value
+                                            : lsb->value - msb->value) +
+                   1;
+  return width < kUnboundedWidth ? width : kUnknownWidth;
+}
+
+void Analyzer::leave(const Node &node) {
+  auto &expr = static_cast<const Expression &>(node);
+  // Slots of the children, in the same order as they were walked
+  slots.clear();
+  for_each_child(const_cast<Node &>(node), [&](auto &slot) {
+    if (!slot_node(slot)) return;
+    if constexpr (std::is_same_v<std::decay_t<decltype(slot)>,
+                                 std::unique_ptr<Expression>>) {
+      slots.push_back(&slot);
+    } else {
+      slots.push_back(nullptr);
+    }
+  });
+  size_t num_children = slots.size();
+  // The children are the last entries of `pending`
+  size_t *children = pending.data() + pending.size() - num_children;
+
+  size_t index = infos.size();
+  ExprInfo info;
+  info.expr = &expr;
+  info.slot = root_slot;
+  info.size = 1;
+  info.statement = statement;
+  info.hash = local_hash(expr);
+  info.width = kUnknownWidth;
+  info.is_signed = false;
+  info.stable = true;
+  info.opaque = false;
+  for (size_t i = 0; i < num_children; i++) {
+    ExprInfo &child = infos[children[i]];
+    child.parent = index;
+    child.slot = slots[i];
+    info.size += child.size;
+    info.hash = hash_combine(info.hash, child.hash);
+    info.opaque |= child.opaque;
+  }
+  auto child = [&](size_t i) -> ExprInfo & { return infos[children[i]]; };
+  auto set_modes = [&](ContextMode mode) {
+    for (size_t i = 0; i < num_children; i++) child(i).mode = mode;
+  };
+
+  switch (expr.kind()) {
+    case NodeKind::NUMERIC_LITERAL: {
+      auto &literal = static_cast<const NumericLiteral &>(expr);
+      info.width = literal.size;
+      info.is_signed = literal._signed;
+      break;
+    }
+    case NodeKind::IDENTIFIER:
+      info.width =
+          net_width(widths, static_cast<const Identifier &>(expr).value);
+      break;
+    case NodeKind::STRING:
+      break;
+    case NodeKind::INDEX:
+      if (child(0).width != kUnknownWidth) info.width = 1;
+      break;
+    case NodeKind::SLICE: {
+      auto &slice = static_cast<const Slice &>(expr);
+      if (child(0).width != kUnknownWidth) {
+        info.width = range_width(*slice.high_index, *slice.low_index);
+      }
+      break;
+    }
+    case NodeKind::BINARY_OP: {
+      ExprInfo &left = child(0);
+      ExprInfo &right = child(1);
+      switch (static_cast<const BinaryOp &>(expr).op) {
+        case BinOp::EQ:
+        case BinOp::NEQ: {
+          unsigned operands = max_width(left.width, right.width);
+          left.mode = right.mode = FIXED;
+          left.context = right.context =
+              operands == kUnknownWidth ? kUnboundedWidth : operands;
+          info.width = 1;
+          break;
+        }
+        case BinOp::AND:
+        case BinOp::OR:
+          info.width = 1;
+          break;
+        case BinOp::ADD:
+        case BinOp::SUB:
+        case BinOp::MUL:
+        case BinOp::DIV:
+        case BinOp::MOD: {
+          BinOp::BinOp op = static_cast<const BinaryOp &>(expr).op;
+          info.width = max_width(left.width, right.width);
+          info.is_signed = left.is_signed && right.is_signed;
+          // No carry into the bits of a wider context
+          info.stable = (op == BinOp::DIV || op == BinOp::MOD) &&
+                        left.stable && right.stable;
+          set_modes(INHERITED);
+          break;
+        }
+        case BinOp::LSHIFT:
+        case BinOp::ALSHIFT:
+        case BinOp::POW:
+          info.width = left.width;
+          info.is_signed = left.is_signed;
+          info.stable = false;
+          left.mode = INHERITED;
+          break;
+        case BinOp::RSHIFT:
+        case BinOp::ARSHIFT:
+          info.width = left.width;
+          info.is_signed = left.is_signed;
+          info.stable = left.stable && !left.is_signed;
+          left.mode = INHERITED;
+          break;
+      }
+      break;
+    }
+    case NodeKind::UNARY_OP:
+      switch (static_cast<const UnaryOp &>(expr).op) {
+        case UnOp::INVERT:
+        case UnOp::MINUS:
+        case UnOp::PLUS:
+          info.width = child(0).width;
+          info.is_signed = child(0).is_signed;
+          info.stable = static_cast<const UnaryOp &>(expr).op == UnOp::PLUS &&
+                        child(0).stable;
+          set_modes(INHERITED);
+          break;
+        default:
+          info.width = 1;
+          break;
+      }
+      break;
+    case NodeKind::TERNARY_OP: {
+      ExprInfo &true_value = child(1);
+      ExprInfo &false_value = child(2);
+      info.width = max_width(true_value.width, false_value.width);
+      info.is_signed = true_value.is_signed && false_value.is_signed;
+      info.stable = true_value.stable && false_value.stable;
+      true_value.mode = false_value.mode = INHERITED;
+      break;
+    }
+    case NodeKind::CONCAT: {
+      uint64_t width = 0;
+      for (size_t i = 0; i < num_children; i++) {
+        if (child(i).width == kUnknownWidth) {
+          width = kUnknownWidth;
+          break;
+        }
+        width += child(i).width;
+      }
+      if (width < kUnboundedWidth) info.width = width;
+      break;
+    }
+    default:
+      // Edges and expression classes defined outside of the library
+      info.stable = false;
+      info.opaque = true;
+      break;
+  }
+  infos.push_back(info);
+  pending.resize(pending.size() - num_children);
+  pending.push_back(index);
+}
+
+// Assigns the context width of the nodes [first, root] top down
+void compute_contexts(std::vector<ExprInfo> &infos, size_t first, size_t root,
+                      unsigned target_width) {
+  ExprInfo &info = infos[root];
+  info.context = target_width == kUnknownWidth || info.width == kUnknownWidth
+                     ? kUnboundedWidth
+                     : std::max(target_width, info.width);
+  for (size_t i = root; i-- > first;) {
+    ExprInfo &node = infos[i];
+    if (node.width == kUnknownWidth) {
+      node.context = kUnboundedWidth;
+    } else if (node.mode == SELF_DETERMINED) {
+      node.context = node.width;
+    } else if (node.mode == INHERITED) {
+      node.context = std::max(node.width, infos[node.parent].context);
+    }
+  }
+}
+
+unsigned target_width(
+    const NetWidths &widths,
+    const std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
+                       std::unique_ptr<Slice>> &target) {
+  if (auto id = std::get_if<std::unique_ptr<Identifier>>(&target)) {
+    return net_width(widths, (*id)->value);
+  }
+  if (auto index = std::get_if<std::unique_ptr<Index>>(&target)) {
+    return net_width(widths, (*index)->id->value) == kUnknownWidth
+               ? kUnknownWidth
+               : 1;
+  }
+  auto &slice = std::get<std::unique_ptr<Slice>>(target);
+  if (net_width(widths, slice->id->value) == kUnknownWidth) {
+    return kUnknownWidth;
+  }
+  return range_width(*slice->high_index, *slice->low_index);
+}
+
+}  // namespace detail
+}  // namespace verilogAST
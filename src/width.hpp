@@ -0,0 +1,120 @@
+// Internal helpers for the widths of expressions, shared by the passes
+#pragma once
+#ifndef VERILOGAST_WIDTH_H
+#define VERILOGAST_WIDTH_H
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "verilogAST.hpp"
+#include "verilogAST/transformer.hpp"
+
+namespace verilogAST {
+namespace detail {
+
+constexpr unsigned kUnknownWidth = 0;
+// Width of a context that may be arbitrarily wide
+constexpr unsigned kUnboundedWidth = std::numeric_limits<unsigned>::max();
+constexpr size_t kNoParent = std::numeric_limits<size_t>::max();
+
+// Declared width of the nets of a module, kUnknownWidth if it is not constant
+// (e.g. parameterized) or the net is an array
+typedef std::unordered_map<Symbol, unsigned> NetWidths;
+
+// Widths of the ports and declarations of `module`
+NetWidths net_widths(const Module &module);
+
+// Width of the range [high:low], kUnknownWidth if it is not constant
+unsigned range_width(const Expression &high, const Expression &low);
+
+inline unsigned net_width(const NetWidths &widths, Symbol name) {
+  auto it = widths.find(name);
+  return it == widths.end() ? kUnknownWidth : it->second;
+}
+
+inline unsigned max_width(unsigned a, unsigned b) {
+  if (a == kUnknownWidth || b == kUnknownWidth) return kUnknownWidth;
+  return std::max(a, b);
+}
+
+// How the width of the context of an expression is determined from its parent
+enum ContextMode {
+  // The expression is self-determined (e.g. an argument of `{...}`)
+  SELF_DETERMINED,
+  // The expression is extended to the width of its parent's context
+  INHERITED,
+  // Fixed by the parent (e.g. both operands of `==`)
+  FIXED
+};
+
+// Everything known about one expression node in a right-hand side.  Nodes are
+// numbered in post-order, so the subtree of node `i` is the range
+// [i - size + 1, i].
+struct ExprInfo {
+  const Expression *expr;
+  // Slot holding `expr`, nullptr if it cannot hold an Identifier
+  std::unique_ptr<Expression> *slot;
+  size_t size;
+  size_t parent = kNoParent;
+  size_t statement;
+  size_t hash;
+  // Self-determined width, kUnknownWidth if it depends on unknown widths
+  unsigned width;
+  // Width of the context the expression is evaluated in
+  unsigned context = kUnboundedWidth;
+  ContextMode mode = SELF_DETERMINED;
+  bool is_signed;
+  // True if evaluating the expression in a wider context yields its
+  // self-determined value zero extended (e.g. `a & b`, but not `a + b`)
+  bool stable;
+  // True if the subtree contains an expression class defined outside of the
+  // library, which can not be compared
+  bool opaque;
+  // True if the node is part of an occurrence that gets replaced
+  bool dead = false;
+  // True once the memoized hash of `expr` has been reset
+  bool invalidated = false;
+};
+
+// Numbers the expression nodes of right-hand sides in post-order and computes
+// their ExprInfo bottom up
+class Analyzer : public Visitor {
+  std::vector<ExprInfo> &infos;
+  const NetWidths &widths;
+  // Indices of the nodes whose parent has not been left yet
+  std::vector<size_t> pending;
+  std::vector<std::unique_ptr<Expression> *> slots;
+  size_t statement = 0;
+  std::unique_ptr<Expression> *root_slot = nullptr;
+
+ public:
+  Analyzer(std::vector<ExprInfo> &infos, const NetWidths &widths)
+      : infos(infos), widths(widths) {}
+
+  // Analyzes the expression held by `slot`, which is the right-hand side of
+  // the `statement`th statement of the module
+  void run(std::unique_ptr<Expression> &slot, size_t statement) {
+    this->statement = statement;
+    root_slot = &slot;
+    walk(*slot, *this);
+    pending.clear();
+  }
+
+  void leave(const Node &node) override;
+};
+
+// Assigns the context width of the nodes [first, root] top down
+void compute_contexts(std::vector<ExprInfo> &infos, size_t first, size_t root,
+                      unsigned target_width);
+
+// Width of an assignment target
+unsigned target_width(
+    const NetWidths &widths,
+    const std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
+                       std::unique_ptr<Slice>> &target);
+
+}  // namespace detail
+}  // namespace verilogAST
+#endif
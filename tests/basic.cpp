@@ -1,3 +1,12 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <optional>
+#include <sstream>
+
 #include "common.cpp"
 #include "gtest/gtest.h"
 #include "verilogAST.hpp"
@@ -8,7 +17,7 @@ namespace {
 
 TEST(BasicTests, TestNumericLiteral) {
   vAST::NumericLiteral n0("23", 16, false, vAST::DECIMAL);
-  EXPECT_EQ(n0.toString(), "16'23");
+  EXPECT_EQ(n0.toString(), "16'd23");
 
   vAST::NumericLiteral n1("DEADBEEF", 32, false, vAST::HEX);
   EXPECT_EQ(n1.toString(), "'hDEADBEEF");
@@ -20,16 +29,68 @@ TEST(BasicTests, TestNumericLiteral) {
   EXPECT_EQ(n3.toString(), "24'o764");
 
   vAST::NumericLiteral n4("764", 8, false);
-  EXPECT_EQ(n4.toString(), "8'764");
+  EXPECT_EQ(n4.toString(), "8'd764");
 
   vAST::NumericLiteral n5("764", 8);
-  EXPECT_EQ(n5.toString(), "8'764");
+  EXPECT_EQ(n5.toString(), "8'd764");
 
   vAST::NumericLiteral n6("764");
   EXPECT_EQ(n6.toString(), "764");
 
   vAST::NumericLiteral n7("764", 8, true);
-  EXPECT_EQ(n7.toString(), "8's764");
+  EXPECT_EQ(n7.toString(), "8'sd764");
+
+  // Decimals that are sized or signed always spell out their base
+  vAST::NumericLiteral n8("3", 32, true);
+  EXPECT_EQ(n8.toString(), "'sd3");
+  EXPECT_EQ(vAST::NumericLiteral(7, 8).toString(), "8'd7");
+  EXPECT_EQ(vAST::NumericLiteral(3, 4, true).toString(), "4'sd3");
+}
+
+TEST(BasicTests, TestIntegerLiteral) {
+  vAST::NumericLiteral n0(23, 16);
+  EXPECT_TRUE(n0.isInteger());
+  EXPECT_EQ(n0.toString(), "16'd23");
+
+  EXPECT_EQ(vAST::NumericLiteral(0xDEADBEEF, 32, false, vAST::HEX).toString(),
+            "'hDEADBEEF");
+  EXPECT_EQ(vAST::NumericLiteral(25, 6, false, vAST::BINARY).toString(),
+            "6'b11001");
+  EXPECT_EQ(vAST::NumericLiteral(500, 24, false, vAST::OCTAL).toString(),
+            "24'o764");
+  EXPECT_EQ(vAST::NumericLiteral(0, 8, false, vAST::HEX).toString(), "8'h0");
+  EXPECT_EQ(vAST::NumericLiteral(764).toString(), "764");
+  // Bits above the size are dropped, negative values are two's complement
+  EXPECT_EQ(vAST::NumericLiteral(0x1FF, 8, false, vAST::HEX).toString(),
+            "8'hFF");
+  EXPECT_EQ(vAST::NumericLiteral(-1, 8, true).toString(), "8'sd255");
+
+  // Wide literals, with digits straddling words
+  std::vector<uint64_t> words = {UINT64_MAX, 0x5};
+  EXPECT_EQ(vAST::NumericLiteral(words, 100).toString(),
+            "100'h5FFFFFFFFFFFFFFFF");
+  EXPECT_EQ(vAST::NumericLiteral(words, 100, false, vAST::OCTAL).toString(),
+            "100'o13777777777777777777777");
+  EXPECT_EQ(vAST::NumericLiteral(words, 100, false, vAST::DECIMAL).toString(),
+            "100'd110680464442257309695");
+  EXPECT_EQ(vAST::NumericLiteral(words, 66, false, vAST::BINARY).toString(),
+            "66'b" + std::string(65, '1'));
+  // Copies of wide literals own their words
+  auto wide = std::make_unique<vAST::NumericLiteral>(words, 100);
+  std::unique_ptr<vAST::NumericLiteral> copy = vAST::clone(*wide);
+  wide.reset();
+  EXPECT_EQ(copy->toString(), "100'h5FFFFFFFFFFFFFFFF");
+  // Zero high words do not change the value
+  EXPECT_TRUE(vAST::NumericLiteral(std::vector<uint64_t>{7, 0}, 100)
+                  .structurallyEqual(vAST::NumericLiteral(7, 100, false,
+                                                          vAST::HEX)));
+
+  // Integer literals equal digit literals written the same way
+  vAST::NumericLiteral digits("17", 8, false, vAST::HEX);
+  vAST::NumericLiteral integer(0x17, 8, false, vAST::HEX);
+  EXPECT_EQ(integer.digits(), "17");
+  EXPECT_TRUE(integer.structurallyEqual(digits));
+  EXPECT_EQ(integer.hash(), digits.hash());
 }
 
 TEST(BasicTests, TestIdentifier) {
@@ -47,6 +108,148 @@ TEST(BasicTests, TestIdentifierKeyword) {
   EXPECT_EQ(id.toString(), "\\or ");
 }
 
+TEST(BasicTests, TestIdentifierNeedsEscape) {
+  EXPECT_FALSE(vAST::Identifier::needsEscape("_x$0"));
+  EXPECT_FALSE(vAST::Identifier::needsEscape("$display"));
+  EXPECT_FALSE(vAST::Identifier::needsEscape("modules"));
+  EXPECT_FALSE(vAST::Identifier::needsEscape("Module"));
+  EXPECT_TRUE(vAST::Identifier::needsEscape(""));
+  EXPECT_TRUE(vAST::Identifier::needsEscape("0x"));
+  EXPECT_TRUE(vAST::Identifier::needsEscape("a.b"));
+  EXPECT_TRUE(vAST::Identifier::needsEscape("tri0"));
+  EXPECT_TRUE(vAST::Identifier::needsEscape("pulsestyle_ondetect"));
+  EXPECT_TRUE(vAST::Identifier::needsEscape("tagged"));
+}
+
+TEST(BasicTests, TestSymbolTable) {
+  vAST::SymbolTable symbols;
+  {
+    vAST::SymbolTable::Scope scope(symbols);
+    std::unique_ptr<vAST::Identifier> clk0 = vAST::make_id("clk");
+    std::unique_ptr<vAST::Identifier> clk1 = vAST::make_id("clk");
+    std::unique_ptr<vAST::Identifier> kw = vAST::make_id("wire");
+    EXPECT_EQ(clk0->toString(), "clk");
+    EXPECT_EQ(kw->toString(), "\\wire ");
+  }
+  EXPECT_EQ(symbols.size(), 2u);
+
+  vAST::Symbol a = symbols.intern("a");
+  EXPECT_EQ(a, symbols.intern("a"));
+  EXPECT_NE(a, symbols.intern("b"));
+  EXPECT_EQ(a.id(), symbols.intern("a").id());
+  EXPECT_EQ(a, "a");
+  // Symbols from different tables compare by name
+  EXPECT_EQ(a, vAST::SymbolTable::global().intern("a"));
+  EXPECT_EQ(std::hash<vAST::Symbol>()(a),
+            std::hash<vAST::Symbol>()(vAST::SymbolTable::global().intern("a")));
+  EXPECT_EQ(&vAST::SymbolTable::current(), &vAST::SymbolTable::global());
+
+  symbols.clear();
+  EXPECT_EQ(symbols.size(), 0u);
+  EXPECT_EQ(symbols.intern("b").id(), 0u);
+  EXPECT_EQ(symbols.size(), 1u);
+}
+
+TEST(BasicTests, TestSymbolTableThreads) {
+  // Threads interning overlapping names get one symbol per name, with dense
+  // ids
+  vAST::SymbolTable symbols;
+  vAST::ThreadPool pool(8);
+  size_t num_names = 4096;
+  std::vector<std::optional<vAST::Symbol>> interned(4 * num_names);
+  pool.parallelFor(interned.size(), [&](size_t i) {
+    interned[i] = symbols.intern("n" + std::to_string(i % num_names));
+  });
+  ASSERT_EQ(symbols.size(), num_names);
+  std::vector<bool> ids(num_names);
+  for (size_t i = 0; i < interned.size(); i++) {
+    EXPECT_EQ(&interned[i]->str(), &interned[i % num_names]->str());
+    ASSERT_LT(interned[i]->id(), num_names);
+    ids[interned[i]->id()] = true;
+  }
+  EXPECT_EQ(size_t(std::count(ids.begin(), ids.end(), true)), num_names);
+}
+
+TEST(BasicTests, TestArena) {
+  vAST::Arena arena(256);
+  std::unique_ptr<vAST::Expression> expr;
+  {
+    vAST::Arena::Scope scope(arena);
+    EXPECT_EQ(vAST::Arena::current(), &arena);
+    expr = vAST::make_id("x");
+    for (int i = 0; i < 64; i++) {
+      expr = vAST::make_binop(std::move(expr), vAST::BinOp::ADD,
+                              vAST::make_num(std::to_string(i)));
+    }
+  }
+  EXPECT_EQ(vAST::Arena::current(), nullptr);
+  EXPECT_GT(arena.bytesAllocated(), 64 * sizeof(vAST::BinaryOp));
+  EXPECT_GE(arena.bytesReserved(), arena.bytesAllocated());
+  EXPECT_EQ(expr->toString().substr(0, 9), "x + 0 + 1");
+
+  EXPECT_EQ(vAST::Arena::owner(expr.get()), &arena);
+
+  // Nodes created outside the scope still come from the heap
+  size_t allocated = arena.bytesAllocated();
+  auto heap = vAST::make_id("y");
+  EXPECT_EQ(arena.bytesAllocated(), allocated);
+  EXPECT_EQ(vAST::Arena::owner(heap.get()), nullptr);
+
+  // Nodes are freed where they were allocated, whatever the current arena
+  // is when they are deleted, including when their construction throws
+  {
+    vAST::Arena::Scope scope(arena);
+    std::unique_ptr<vAST::Expression> heap_id;
+    {
+      vAST::Arena::Scope heap_scope(nullptr);
+      heap_id = vAST::make_id("z");
+      EXPECT_THROW(std::make_unique<vAST::Always>(
+                       decltype(vAST::Always::sensitivity_list)(),
+                       decltype(vAST::Always::body)()),
+                   std::runtime_error);
+    }
+    auto arena_id = vAST::make_id("w");
+    heap_id.reset();
+    vAST::Identifier local("v");
+  }
+  {
+    vAST::Arena::Scope scope(arena);
+    EXPECT_THROW(std::make_unique<vAST::Always>(
+                     decltype(vAST::Always::sensitivity_list)(),
+                     decltype(vAST::Always::body)()),
+                 std::runtime_error);
+    // `new` allocates the outer node before its operands are created
+    std::unique_ptr<vAST::Expression> nested(new vAST::UnaryOp(
+        std::unique_ptr<vAST::Expression>(new vAST::UnaryOp(
+            vAST::make_id("u"), vAST::UnOp::INVERT)),
+        vAST::UnOp::NOT));
+    EXPECT_EQ(vAST::Arena::owner(nested.get()), &arena);
+    nested.reset();
+    auto fail = []() -> std::unique_ptr<vAST::Expression> {
+      throw std::runtime_error("operand");
+    };
+    EXPECT_THROW(new vAST::UnaryOp(fail(), vAST::UnOp::NOT),
+                 std::runtime_error);
+    vAST::Identifier local("v");
+  }
+
+  // Discarding skips the destructors of the arena nodes, but still destroys
+  // the literals and the heap nodes of the tree
+  std::vector<std::unique_ptr<vAST::Expression>> args;
+  {
+    vAST::Arena::Scope scope(arena);
+    args.push_back(std::move(expr));
+    args.push_back(vAST::make_num(std::string(100, '1')));
+  }
+  args.push_back(std::move(heap));
+  std::unique_ptr<vAST::Node> concat;
+  {
+    vAST::Arena::Scope scope(arena);
+    concat = std::make_unique<vAST::Concat>(std::move(args));
+  }
+  arena.discard(std::move(concat));
+}
+
 TEST(BasicTests, TestString) {
   vAST::String str("mystring");
   EXPECT_EQ(str.toString(), "\"mystring\"");
@@ -132,6 +335,132 @@ TEST(BasicTests, TestConcat) {
   EXPECT_EQ(concat.toString(), "{x,y}");
 }
 
+TEST(BasicTests, TestNestedExpressions) {
+  std::vector<std::unique_ptr<vAST::Expression>> args;
+  args.push_back(std::make_unique<vAST::Slice>(
+      vAST::make_id("x"),
+      vAST::make_binop(vAST::make_id("w"), vAST::BinOp::SUB,
+                       vAST::make_num("1")),
+      vAST::make_num("0")));
+  args.push_back(std::make_unique<vAST::TernaryOp>(
+      std::make_unique<vAST::UnaryOp>(vAST::make_id("c"), vAST::UnOp::NOT),
+      std::make_unique<vAST::Index>(vAST::make_id("y"), vAST::make_num("2")),
+      vAST::make_id("z")));
+  vAST::PosEdge edge(std::make_unique<vAST::Concat>(std::move(args)));
+  EXPECT_EQ(edge.toString(), "posedge {x[w - 1:0],! c ? y[2] : z}");
+}
+
+TEST(BasicTests, TestDeepExpression) {
+  // Deep enough to overflow the call stack if emission or destruction
+  // recursed once per level
+  const size_t depth = 500000;
+  std::unique_ptr<vAST::Expression> expr = vAST::make_id("x");
+  for (size_t i = 0; i < depth; i++) {
+    expr = vAST::make_binop(std::move(expr), vAST::BinOp::OR,
+                            std::make_unique<vAST::UnaryOp>(
+                                vAST::make_id("x"), vAST::UnOp::INVERT));
+  }
+  std::string str = expr->toString();
+  EXPECT_EQ(str.size(), 1 + depth * 7);
+  EXPECT_EQ(str.substr(0, 16), "x || ~ x || ~ x ");
+  expr.reset();
+}
+
+TEST(BasicTests, TestParentheses) {
+  auto binop = [](std::unique_ptr<vAST::Expression> left, vAST::BinOp::BinOp op,
+                  std::unique_ptr<vAST::Expression> right) {
+    return vAST::make_binop(std::move(left), op, std::move(right));
+  };
+  // Only where precedence or associativity requires them
+  EXPECT_EQ(binop(binop(vAST::make_id("a"), vAST::BinOp::ADD,
+                        vAST::make_id("b")),
+                  vAST::BinOp::MUL, vAST::make_id("c"))
+                ->toString(),
+            "(a + b) * c");
+  EXPECT_EQ(binop(vAST::make_id("a"), vAST::BinOp::SUB,
+                  binop(vAST::make_id("b"), vAST::BinOp::SUB,
+                        vAST::make_id("c")))
+                ->toString(),
+            "a - (b - c)");
+  EXPECT_EQ(binop(binop(vAST::make_id("a"), vAST::BinOp::SUB,
+                        vAST::make_id("b")),
+                  vAST::BinOp::SUB, vAST::make_id("c"))
+                ->toString(),
+            "a - b - c");
+  vAST::UnaryOp unary(binop(vAST::make_id("a"), vAST::BinOp::ADD,
+                            vAST::make_id("b")),
+                      vAST::UnOp::INVERT);
+  EXPECT_EQ(unary.toString(), "~ (a + b)");
+  vAST::TernaryOp ternary(
+      std::make_unique<vAST::TernaryOp>(vAST::make_id("a"), vAST::make_id("b"),
+                                        vAST::make_id("c")),
+      vAST::make_id("d"),
+      std::make_unique<vAST::TernaryOp>(vAST::make_id("e"), vAST::make_id("f"),
+                                        vAST::make_id("g")));
+  EXPECT_EQ(ternary.toString(), "(a ? b : c) ? d : e ? f : g");
+
+  // The iterative emission of deep trees inserts the same parentheses
+  std::unique_ptr<vAST::Expression> expr = vAST::make_id("x");
+  for (int i = 0; i < 1000; i++) {
+    expr = binop(vAST::make_id("x"), vAST::BinOp::SUB, std::move(expr));
+  }
+  std::string str = expr->toString();
+  EXPECT_EQ(str.substr(0, 14), "x - (x - (x - ");
+  EXPECT_EQ(str.substr(str.size() - 1004), "x - x" + std::string(999, ')'));
+  EXPECT_EQ(std::count(str.begin(), str.end(), '('), 999);
+}
+
+TEST(BasicTests, TestCompact) {
+  vAST::StringSink sink;
+  sink.options.compact = true;
+  vAST::BinaryOp binop(
+      vAST::make_binop(vAST::make_id("a"), vAST::BinOp::ADD,
+                       std::make_unique<vAST::UnaryOp>(vAST::make_id("b"),
+                                                       vAST::UnOp::MINUS)),
+      vAST::BinOp::MUL,
+      std::make_unique<vAST::UnaryOp>(
+          std::make_unique<vAST::UnaryOp>(vAST::make_id("or"),
+                                          vAST::UnOp::AND),
+          vAST::UnOp::INVERT));
+  binop.emit(sink);
+  // Unary operators after another operator keep a space, escaped names keep
+  // their terminating space
+  EXPECT_EQ(sink.release(), "(a+ -b)* ~ &\\or ");
+
+  // The space also applies to a unary operator at the start of a right
+  // operand, below its leftmost operands
+  vAST::BinaryOp sub(
+      vAST::make_id("a"), vAST::BinOp::SUB,
+      vAST::make_binop(std::make_unique<vAST::UnaryOp>(vAST::make_id("b"),
+                                                       vAST::UnOp::MINUS),
+                       vAST::BinOp::MUL, vAST::make_id("c")));
+  sub.emit(sink);
+  EXPECT_EQ(sink.release(), "a- -b*c");
+  vAST::BinaryOp land(
+      vAST::make_id("a"), vAST::BinOp::AND,
+      vAST::make_binop(std::make_unique<vAST::UnaryOp>(vAST::make_id("b"),
+                                                       vAST::UnOp::AND),
+                       vAST::BinOp::EQ, vAST::make_id("c")));
+  land.emit(sink);
+  EXPECT_EQ(sink.release(), "a&& &b==c");
+  vAST::BinaryOp ternary(
+      vAST::make_id("a"), vAST::BinOp::SUB,
+      std::make_unique<vAST::TernaryOp>(
+          vAST::make_binop(std::make_unique<vAST::UnaryOp>(
+                               vAST::make_id("b"), vAST::UnOp::MINUS),
+                           vAST::BinOp::ADD, vAST::make_id("c")),
+          vAST::make_id("d"), vAST::make_id("e")));
+  ternary.emit(sink);
+  EXPECT_EQ(sink.release(), "a-(-b+c?d:e)");
+
+  sink.options.compact = true;
+  vAST::Port port(vAST::make_vector(vAST::make_id("x"), vAST::make_num("7"),
+                                    vAST::make_num("0")),
+                  vAST::OUTPUT, vAST::REG);
+  port.emit(sink);
+  EXPECT_EQ(sink.release(), "output reg[7:0]x");
+}
+
 TEST(BasicTests, TestNegEdge) {
   vAST::NegEdge neg_edge(vAST::make_id("clk"));
 
@@ -184,6 +513,27 @@ TEST(BasicTests, TestModuleInst) {
             "test_module_inst(.a(a), .b(b[0]), .c(c[31:0]));");
 }
 
+TEST(BasicTests, TestModuleInstOrder) {
+  vAST::SymbolTable &symbols = vAST::SymbolTable::current();
+  vAST::Connections connections;
+  connections.emplace_back(symbols.intern("z"), vAST::make_id("a"));
+  connections.emplace_back(
+      symbols.intern("y"),
+      std::make_unique<vAST::Index>(vAST::make_id("b"), vAST::make_num("0")));
+  connections.emplace_back(symbols.intern("x"), vAST::make_id("c"));
+  vAST::ModuleInstantiation module_inst("test_module", vAST::Parameters(),
+                                        "test_module_inst",
+                                        std::move(connections));
+  // Connections are emitted in the order they were given
+  EXPECT_EQ(module_inst.toString(),
+            "test_module test_module_inst(.z(a), .y(b[0]), .x(c));");
+
+  vAST::ConnectionIndex index(module_inst);
+  EXPECT_EQ(index.find(symbols.intern("y")), 1u);
+  EXPECT_EQ(index.find(symbols.intern("x")), 2u);
+  EXPECT_EQ(index.find(symbols.intern("w")), vAST::ConnectionIndex::npos);
+}
+
 TEST(BasicTests, TestModule) {
   std::string name = "test_module";
 
@@ -253,6 +603,8 @@ TEST(BasicTests, TestDeclaration) {
       std::make_unique<vAST::NumericLiteral>("31"),
       std::make_unique<vAST::NumericLiteral>("0")));
   EXPECT_EQ(reg_vec.toString(), "reg [31:0] x;");
+  EXPECT_EQ(wire.decl(), "wire");
+  EXPECT_EQ(reg_vec.decl(), "reg");
 }
 
 TEST(BasicTests, TestAssign) {
@@ -268,6 +620,28 @@ TEST(BasicTests, TestAssign) {
       std::make_unique<vAST::Identifier>("a"),
       std::make_unique<vAST::Identifier>("b"));
   EXPECT_EQ(non_blocking_assign.toString(), "a <= b;");
+  EXPECT_EQ(non_blocking_assign.assignKind(), vAST::AssignKind::NON_BLOCKING);
+
+  // Edited prefixes are kept per node, restoring the default drops them
+  cont_assign.setPrefix("assign #1 ");
+  EXPECT_EQ(cont_assign.toString(), "assign #1 a = b;");
+  EXPECT_EQ(cont_assign.assignKind(), vAST::AssignKind::CONTINUOUS);
+  non_blocking_assign.setPrefix("#2 ");
+  EXPECT_EQ(non_blocking_assign.toString(), "#2 a <= b;");
+  EXPECT_EQ(non_blocking_assign.symbol(), "<=");
+  cont_assign.setPrefix("assign ");
+  EXPECT_EQ(cont_assign.toString(), "assign a = b;");
+  EXPECT_EQ(blocking_assign.prefix(), "");
+
+  // Prefixes are not names, they stay out of the SymbolTables and outlive
+  // them
+  {
+    vAST::SymbolTable symbols;
+    vAST::SymbolTable::Scope scope(symbols);
+    blocking_assign.setPrefix("#3 ");
+    EXPECT_EQ(symbols.size(), 0u);
+  }
+  EXPECT_EQ(blocking_assign.toString(), "#3 a = b;");
 }
 
 TEST(BasicTests, TestAlways) {
@@ -342,6 +716,101 @@ TEST(BasicTests, File) {
       ".c(c[31:0]));\nendmodule\n";
   EXPECT_EQ(file.toString(), expected_str);
 }
+TEST(BasicTests, FileCompact) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  modules.push_back(
+      std::make_unique<vAST::Module>("test_module0", make_simple_ports(),
+                                     make_simple_body(), make_simple_params()));
+  modules.push_back(std::make_unique<vAST::Module>(
+      "test_module1", make_simple_ports(), make_simple_body(),
+      vAST::Parameters()));
+  vAST::File file(modules);
+  file.emit_options.compact = true;
+  std::string expected_str =
+      "module test_module0#(parameter param0=0,parameter param1=1)(input i,"
+      "output o);\nother_module#(.param0(0),.param1(1)) other_module_inst("
+      ".a(a),.b(b[0]),.c(c[31:0]));\nendmodule\n"
+      "module test_module1(input i,output o);\nother_module#(.param0(0),"
+      ".param1(1)) other_module_inst(.a(a),.b(b[0]),.c(c[31:0]));\n"
+      "endmodule\n";
+  EXPECT_EQ(file.toString(), expected_str);
+  vAST::ThreadPool pool(2);
+  EXPECT_EQ(file.toString(pool), expected_str);
+  // Cached modules are emitted again when the layout changes
+  file.cacheEmission();
+  EXPECT_EQ(file.toString(), expected_str);
+  file.emit_options.compact = false;
+  EXPECT_EQ(file.toString().substr(0, 28), "module test_module0 #(parame");
+}
+
+TEST(BasicTests, FileParallel) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  for (int i = 0; i < 100; i++) {
+    modules.push_back(std::make_unique<vAST::Module>(
+        "test_module" + std::to_string(i), make_simple_ports(),
+        make_simple_body(), make_simple_params()));
+  }
+  modules.push_back(
+      std::make_unique<vAST::StringModule>("module x; endmodule\n"));
+  vAST::File file(modules);
+
+  std::string serial = file.toString();
+  for (unsigned num_threads : {1, 3, 8}) {
+    vAST::ThreadPool pool(num_threads);
+    EXPECT_EQ(pool.size(), num_threads);
+    EXPECT_EQ(file.toString(pool), serial);
+    // Pools are reusable
+    EXPECT_EQ(file.toString(pool), serial);
+  }
+}
+
+TEST(BasicTests, FileWriteTo) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  for (int i = 0; i < 50; i++) {
+    modules.push_back(std::make_unique<vAST::Module>(
+        "test_module" + std::to_string(i), make_simple_ports(),
+        make_simple_body(), make_simple_params()));
+  }
+  vAST::File file(modules);
+  std::string expected = file.toString();
+
+  char path[] = "/tmp/verilogAST_writeToXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  vAST::ThreadPool pool(4);
+  for (bool use_mmap : {false, true}) {
+    for (vAST::ThreadPool *p : {(vAST::ThreadPool *)nullptr, &pool}) {
+      vAST::WriteOptions options;
+      // Small buffers so that the output spans many buffers/windows
+      options.buffer_size = 100;
+      options.use_mmap = use_mmap;
+      options.pool = p;
+      EXPECT_EQ(file.writeTo(path, options), expected.size());
+      std::ifstream in(path);
+      std::stringstream contents;
+      contents << in.rdbuf();
+      EXPECT_EQ(contents.str(), expected);
+    }
+  }
+  unlink(path);
+
+  EXPECT_THROW(file.writeTo("/nonexistent/dir/out.v"), std::system_error);
+}
+
+TEST(BasicTests, ThreadPoolException) {
+  vAST::ThreadPool pool(4);
+  std::atomic<int> calls{0};
+  EXPECT_THROW(pool.parallelFor(1000,
+                                [&](size_t i) {
+                                  calls++;
+                                  if (i == 10) throw std::runtime_error("x");
+                                }),
+               std::runtime_error);
+  EXPECT_LE(calls.load(), 1000);
+}
+
 TEST(BasicTests, Comment) {
   vAST::SingleLineComment single_line_comment("Test comment");
   EXPECT_EQ(single_line_comment.toString(), "// Test comment");
@@ -350,6 +819,39 @@ TEST(BasicTests, Comment) {
             "/*\nTest comment\non multiple lines\n*/");
 }
 
+TEST(BasicTests, TestSinks) {
+  std::vector<std::unique_ptr<vAST::Expression>> args;
+  args.push_back(vAST::make_id("x"));
+  args.push_back(vAST::make_id("y"));
+  vAST::Concat concat(std::move(args));
+
+  // Start with a tiny buffer to exercise growth
+  vAST::StringSink string_sink(1);
+  concat.emit(string_sink);
+  string_sink << ';';
+  EXPECT_EQ(string_sink.bytesWritten(), 6u);
+  EXPECT_EQ(string_sink.release(), "{x,y};");
+
+  std::ostringstream os;
+  {
+    vAST::OStreamSink os_sink(os, 2);
+    concat.emit(os_sink);
+  }
+  EXPECT_EQ(os.str(), "{x,y}");
+
+  FILE *tmp = std::tmpfile();
+  ASSERT_NE(tmp, nullptr);
+  vAST::FdSink fd_sink(fileno(tmp), 4);
+  concat.emit(fd_sink);
+  fd_sink.flush();
+  EXPECT_EQ(fd_sink.bytesWritten(), 5u);
+  char buf[8] = {0};
+  std::rewind(tmp);
+  EXPECT_EQ(std::fread(buf, 1, sizeof(buf), tmp), 5u);
+  EXPECT_EQ(std::string(buf), "{x,y}");
+  std::fclose(tmp);
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include "verilogAST.hpp"
+#include "verilogAST/parser.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+const char *kSource =
+    "module test_module #(parameter N = 8) (input clk, input [N - 1:0] a, "
+    "output reg [7:0] x);\n"
+    "wire [7:0] w;\n"
+    "reg r[3];\n"
+    "assign w = a + 8'hF0 - ~ a[0] ? {a[3:0],a[7:4]} : 8'sd3;\n"
+    "always @(posedge clk, negedge a, *) begin\n"
+    "x <= w;\n"
+    "r = \"s\";\n"
+    "end\n"
+    "\n"
+    "other #(.N(N)) inst(.i(a[0]), .j({a,w}), .k(w[3:0]), .l(x));\n"
+    "endmodule\n";
+
+TEST(CloneTests, TestFile) {
+  auto file = vAST::parse(kSource);
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::StringPort>("input i"));
+  file->modules.push_back(std::make_unique<vAST::StringBodyModule>(
+      "string_body", std::move(ports), "assign o = i;", vAST::Parameters()));
+  file->modules.push_back(
+      std::make_unique<vAST::StringModule>("module string;\nendmodule\n"));
+  auto &module = static_cast<vAST::Module &>(*file->modules[0]);
+  module.cache_emission = true;
+  auto &assign = static_cast<vAST::ContinuousAssign &>(
+      *std::get<std::unique_ptr<vAST::StructuralStatement>>(module.body[2]));
+  assign.setPrefix("assign #1 ");
+
+  std::unique_ptr<vAST::File> copy = vAST::clone(*file);
+  EXPECT_TRUE(copy->structurallyEqual(*file));
+  EXPECT_EQ(copy->toString(), file->toString());
+  auto &copied_module = static_cast<vAST::Module &>(*copy->modules[0]);
+  EXPECT_TRUE(copied_module.cache_emission);
+
+  // The copy does not share nodes with the original
+  std::get<std::unique_ptr<vAST::Identifier>>(
+      static_cast<vAST::Port &>(*copied_module.ports[0]).value)
+      ->value = vAST::SymbolTable::current().intern("clock");
+  copied_module.invalidateHash();
+  copy->invalidateHash();
+  EXPECT_FALSE(copy->structurallyEqual(*file));
+  EXPECT_EQ(file->toString().find("clock"), std::string::npos);
+}
+
+TEST(CloneTests, TestExpression) {
+  std::unique_ptr<vAST::Expression> expr = vAST::make_binop(
+      vAST::make_id("a"), vAST::BinOp::ADD,
+      std::make_unique<vAST::TernaryOp>(
+          vAST::make_id("c"), vAST::make_num("1"),
+          std::make_unique<vAST::Index>(vAST::make_id("b"),
+                                        vAST::make_num("0"))));
+  std::unique_ptr<vAST::Expression> copy = vAST::clone(*expr);
+  EXPECT_NE(copy.get(), expr.get());
+  EXPECT_EQ(copy->toString(), "a + (c ? 1 : b[0])");
+  EXPECT_EQ(copy->hash(), expr->hash());
+}
+
+TEST(CloneTests, TestDeep) {
+  std::unique_ptr<vAST::Expression> expr = vAST::make_id("a");
+  for (int i = 0; i < 100000; i++) {
+    expr = std::make_unique<vAST::UnaryOp>(std::move(expr), vAST::UnOp::INVERT);
+  }
+  EXPECT_TRUE(vAST::clone(*expr)->structurallyEqual(*expr));
+}
+
+TEST(CloneTests, TestArena) {
+  auto file = vAST::parse(kSource);
+  vAST::Arena arena;
+  std::unique_ptr<vAST::File> copy;
+  {
+    vAST::Arena::Scope scope(arena);
+    copy = vAST::clone(*file);
+  }
+  EXPECT_GT(arena.bytesAllocated(), sizeof(vAST::Module));
+  EXPECT_EQ(copy->toString(), kSource);
+
+  // Copying into an arena reserves exactly the bytes of the tree up front
+  vAST::Arena small(64);
+  std::unique_ptr<vAST::File> other = vAST::clone(*file, small);
+  EXPECT_EQ(vAST::Arena::current(), nullptr);
+  EXPECT_EQ(small.bytesReserved(), small.bytesAllocated());
+  EXPECT_EQ(other->toString(), kSource);
+  small.discard(std::move(other));
+}
+
+}  // namespace
@@ -0,0 +1,132 @@
+#include "verilogAST/connectivity.hpp"
+
+#include "gtest/gtest.h"
+#include "verilogAST.hpp"
+#include "verilogAST/parser.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+vAST::Module &module_at(vAST::File &file, size_t i) {
+  return static_cast<vAST::Module &>(*file.modules[i]);
+}
+
+vAST::Symbol symbol(const char *name) {
+  return vAST::SymbolTable::current().intern(name);
+}
+
+// Emitted endpoints, to compare them as strings
+std::vector<std::string> strings(vAST::Connectivity::Endpoints endpoints) {
+  std::vector<std::string> result;
+  for (const vAST::Node *node : endpoints) result.push_back(node->toString());
+  return result;
+}
+
+TEST(ConnectivityTests, TestAssigns) {
+  auto file = vAST::parse(
+      "module m (input [7:0] a, input [7:0] b, output [7:0] x);\n"
+      "wire [7:0] t;\n"
+      "wire unused;\n"
+      "assign t[3:0] = a[b] + a;\n"
+      "assign t[7:4] = b[3:0];\n"
+      "assign x = t;\n"
+      "endmodule\n");
+  vAST::Module &module = module_at(*file, 0);
+  vAST::Connectivity graph(module);
+  EXPECT_EQ(graph.numNets(), 5u);
+  EXPECT_EQ(graph.find(symbol("a")), 0u);
+  EXPECT_EQ(graph.find(symbol("unused")), 4u);
+  EXPECT_EQ(graph.find(symbol("c")), vAST::Connectivity::npos);
+  for (size_t i = 0; i < graph.numNets(); i++) {
+    EXPECT_EQ(graph.find(graph.name(i)), i);
+  }
+
+  auto a = graph.find(symbol("a"));
+  EXPECT_EQ(strings(graph.drivers(a)),
+            std::vector<std::string>{"input [7:0] a"});
+  // Read twice by the same assignment, listed once
+  EXPECT_EQ(strings(graph.loads(a)),
+            std::vector<std::string>{"assign t[3:0] = a[b] + a;"});
+
+  auto t = graph.find(symbol("t"));
+  EXPECT_EQ(strings(graph.drivers(t)),
+            (std::vector<std::string>{"assign t[3:0] = a[b] + a;",
+                                      "assign t[7:4] = b[3:0];"}));
+  EXPECT_EQ(strings(graph.loads(t)),
+            std::vector<std::string>{"assign x = t;"});
+
+  auto b = graph.find(symbol("b"));
+  EXPECT_EQ(graph.loads(b).size(), 2u);
+  EXPECT_EQ(graph.loads(b)[1], graph.drivers(t)[1]);
+
+  auto x = graph.find(symbol("x"));
+  EXPECT_EQ(strings(graph.drivers(x)),
+            std::vector<std::string>{"assign x = t;"});
+  EXPECT_EQ(strings(graph.loads(x)),
+            std::vector<std::string>{"output [7:0] x"});
+
+  auto unused = graph.find(symbol("unused"));
+  EXPECT_TRUE(graph.drivers(unused).empty());
+  EXPECT_TRUE(graph.loads(unused).empty());
+}
+
+TEST(ConnectivityTests, TestAlways) {
+  auto file = vAST::parse(
+      "module m (input clk, input d, input i, output reg q);\n"
+      "reg [1:0] r;\n"
+      "always @(posedge clk) begin\n"
+      "    r[i] <= d;\n"
+      "    q <= r[i];\n"
+      "end\n"
+      "endmodule\n");
+  vAST::Connectivity graph(module_at(*file, 0));
+  auto clk = graph.find(symbol("clk"));
+  ASSERT_EQ(graph.loads(clk).size(), 1u);
+  EXPECT_EQ(graph.loads(clk)[0]->kind(), vAST::NodeKind::ALWAYS);
+  EXPECT_EQ(strings(graph.drivers(graph.find(symbol("r")))),
+            std::vector<std::string>{"r[i] <= d;"});
+  EXPECT_EQ(strings(graph.loads(graph.find(symbol("i")))),
+            (std::vector<std::string>{"r[i] <= d;", "q <= r[i];"}));
+  EXPECT_EQ(strings(graph.drivers(graph.find(symbol("q")))),
+            std::vector<std::string>{"q <= r[i];"});
+}
+
+TEST(ConnectivityTests, TestInstances) {
+  auto file = vAST::parse(
+      "module child (input a, output b, inout c);\n"
+      "endmodule\n"
+      "\n"
+      "module top (input x, output y, inout z);\n"
+      "wire w;\n"
+      "child u0 (.a(x), .b(w), .c(z));\n"
+      "other u1 (.p(w), .q(y));\n"
+      "endmodule\n");
+  vAST::Module &top = module_at(*file, 1);
+  auto &u0 = *std::get<std::unique_ptr<vAST::StructuralStatement>>(top.body[1]);
+  auto &u1 = *std::get<std::unique_ptr<vAST::StructuralStatement>>(top.body[2]);
+
+  // Port directions are found in the file
+  vAST::Connectivity graph(top, file.get());
+  auto x = graph.find(symbol("x"));
+  auto w = graph.find(symbol("w"));
+  auto z = graph.find(symbol("z"));
+  ASSERT_EQ(graph.loads(x).size(), 1u);
+  EXPECT_EQ(graph.loads(x)[0], &u0);
+  EXPECT_EQ(graph.drivers(x).size(), 1u);
+  ASSERT_EQ(graph.drivers(w).size(), 2u);
+  EXPECT_EQ(graph.drivers(w)[0], &u0);
+  // The ports of `other` are unknown
+  EXPECT_EQ(graph.drivers(w)[1], &u1);
+  ASSERT_EQ(graph.loads(w).size(), 1u);
+  EXPECT_EQ(graph.loads(w)[0], &u1);
+  EXPECT_EQ(graph.drivers(z).size(), 2u);
+  EXPECT_EQ(graph.loads(z).size(), 2u);
+
+  // Without the file every connection drives and reads
+  vAST::Connectivity unresolved(top);
+  EXPECT_EQ(unresolved.drivers(unresolved.find(symbol("x"))).size(), 2u);
+  EXPECT_EQ(unresolved.loads(unresolved.find(symbol("w"))).size(), 2u);
+}
+
+}  // namespace
@@ -0,0 +1,152 @@
+#include "gtest/gtest.h"
+#include "verilogAST.hpp"
+#include "verilogAST/passes.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+typedef std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                                 std::unique_ptr<vAST::Declaration>>>
+    Body;
+
+std::unique_ptr<vAST::AbstractPort> port(std::string name,
+                                         vAST::Direction direction,
+                                         std::string msb = "7") {
+  return std::make_unique<vAST::Port>(
+      std::make_unique<vAST::Vector>(vAST::make_id(name), vAST::make_num(msb),
+                                     vAST::make_num("0")),
+      direction, vAST::WIRE);
+}
+
+// Module with 8 bit inputs a, b and c and 8 bit outputs x, y and z, the
+// bit width of `z` is given by `z_msb`
+vAST::Module make_module(Body body, std::string z_msb = "7") {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(port("a", vAST::INPUT));
+  ports.push_back(port("b", vAST::INPUT));
+  ports.push_back(port("c", vAST::INPUT));
+  ports.push_back(port("x", vAST::OUTPUT));
+  ports.push_back(port("y", vAST::OUTPUT));
+  ports.push_back(port("z", vAST::OUTPUT, z_msb));
+  return vAST::Module("test_module", std::move(ports), std::move(body),
+                      vAST::Parameters());
+}
+
+const char *kHeader =
+    "module test_module (input [7:0] a, input [7:0] b, input [7:0] c, "
+    "output [7:0] x, output [7:0] y, output [7:0] z);\n";
+
+std::unique_ptr<vAST::Expression> binop(
+    std::unique_ptr<vAST::Expression> left, vAST::BinOp::BinOp op,
+    std::unique_ptr<vAST::Expression> right) {
+  return std::make_unique<vAST::BinaryOp>(std::move(left), op,
+                                          std::move(right));
+}
+
+std::unique_ptr<vAST::Expression> a_plus_b() {
+  return binop(vAST::make_id("a"), vAST::BinOp::ADD, vAST::make_id("b"));
+}
+
+std::unique_ptr<vAST::Expression> low_half_concat() {
+  std::vector<std::unique_ptr<vAST::Expression>> args;
+  args.push_back(std::make_unique<vAST::Slice>(
+      vAST::make_id("a"), vAST::make_num("3"), vAST::make_num("0")));
+  args.push_back(std::make_unique<vAST::Slice>(
+      vAST::make_id("b"), vAST::make_num("3"), vAST::make_num("0")));
+  return std::make_unique<vAST::Concat>(std::move(args));
+}
+
+std::unique_ptr<vAST::StructuralStatement> assign(
+    std::string target, std::unique_ptr<vAST::Expression> value) {
+  return std::make_unique<vAST::ContinuousAssign>(vAST::make_id(target),
+                                                  std::move(value));
+}
+
+TEST(CSETests, TestConcat) {
+  Body body;
+  body.push_back(assign(
+      "x", binop(low_half_concat(), vAST::BinOp::EQ, vAST::make_id("c"))));
+  body.push_back(assign("y", low_half_concat()));
+  vAST::Module module = make_module(std::move(body));
+  vAST::eliminate_common_subexpressions(module);
+  // The slices only occur once in the hoisted concatenation
+  EXPECT_EQ(module.toString(), std::string(kHeader) +
+                                   "wire [7:0] _cse_0;\n"
+                                   "assign _cse_0 = {a[3:0],b[3:0]};\n"
+                                   "assign x = _cse_0 == c;\n"
+                                   "assign y = _cse_0;\n"
+                                   "endmodule\n");
+}
+
+TEST(CSETests, TestNested) {
+  Body body;
+  body.push_back(
+      assign("x", binop(a_plus_b(), vAST::BinOp::MUL, vAST::make_id("c"))));
+  body.push_back(
+      assign("y", binop(a_plus_b(), vAST::BinOp::MUL, vAST::make_id("c"))));
+  body.push_back(assign("z", a_plus_b()));
+  vAST::Module module = make_module(std::move(body));
+  vAST::eliminate_common_subexpressions(module);
+  EXPECT_EQ(module.toString(), std::string(kHeader) +
+                                   "wire [7:0] _cse_0;\n"
+                                   "wire [7:0] _cse_1;\n"
+                                   "assign _cse_0 = a + b;\n"
+                                   "assign _cse_1 = _cse_0 * c;\n"
+                                   "assign x = _cse_1;\n"
+                                   "assign y = _cse_1;\n"
+                                   "assign z = _cse_0;\n"
+                                   "endmodule\n");
+}
+
+TEST(CSETests, TestWiderContext) {
+  // The carry of `a + b` is kept in the 9 bit `z`
+  Body body;
+  body.push_back(assign("x", a_plus_b()));
+  body.push_back(assign("z", a_plus_b()));
+  vAST::Module module = make_module(std::move(body), "8");
+  std::string expected = module.toString();
+  vAST::eliminate_common_subexpressions(module);
+  EXPECT_EQ(module.toString(), expected);
+}
+
+TEST(CSETests, TestUnknownWidth) {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(port("a", vAST::INPUT, "N"));
+  ports.push_back(port("x", vAST::OUTPUT, "N"));
+  ports.push_back(port("y", vAST::OUTPUT, "N"));
+  Body body;
+  for (std::string target : {"x", "y"}) {
+    body.push_back(assign(target, binop(vAST::make_id("a"),
+                                        vAST::BinOp::RSHIFT,
+                                        vAST::make_num("1"))));
+  }
+  vAST::Parameters parameters;
+  parameters.push_back(
+      std::make_pair(vAST::make_id("N"), vAST::make_num("7")));
+  vAST::Module module("test_module", std::move(ports), std::move(body),
+                      std::move(parameters));
+  std::string expected = module.toString();
+  vAST::eliminate_common_subexpressions(module);
+  EXPECT_EQ(module.toString(), expected);
+}
+
+TEST(CSETests, TestFreshNames) {
+  Body body;
+  body.push_back(std::make_unique<vAST::Wire>(vAST::make_id("_cse_0")));
+  body.push_back(assign("x", a_plus_b()));
+  body.push_back(assign("_cse_0", vAST::make_id("c")));
+  body.push_back(assign("y", a_plus_b()));
+  vAST::Module module = make_module(std::move(body));
+  vAST::eliminate_common_subexpressions(module);
+  EXPECT_EQ(module.toString(), std::string(kHeader) +
+                                   "wire _cse_0;\n"
+                                   "wire [7:0] _cse_1;\n"
+                                   "assign _cse_1 = a + b;\n"
+                                   "assign x = _cse_1;\n"
+                                   "assign _cse_0 = c;\n"
+                                   "assign y = _cse_1;\n"
+                                   "endmodule\n");
+}
+
+}  // namespace
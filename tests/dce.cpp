@@ -0,0 +1,133 @@
+#include "gtest/gtest.h"
+#include "verilogAST.hpp"
+#include "verilogAST/parser.hpp"
+#include "verilogAST/passes.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+vAST::Module &first_module(vAST::File &file) {
+  return static_cast<vAST::Module &>(*file.modules[0]);
+}
+
+TEST(DCETests, TestAssignChain) {
+  auto file = vAST::parse(
+      "module m (input [7:0] a, input [7:0] b, output [7:0] x);\n"
+      "wire [7:0] t0;\n"
+      "wire [7:0] t1;\n"
+      "wire [7:0] unused0;\n"
+      "wire [7:0] unused1;\n"
+      "assign t0 = a + b;\n"
+      "assign t1[3:0] = t0[3:0];\n"
+      "assign t1[7:4] = t0[7:4];\n"
+      "assign unused0 = a - t1;\n"
+      "assign unused1 = unused0;\n"
+      "assign x = t1;\n"
+      "endmodule\n");
+  EXPECT_EQ(vAST::eliminate_dead_code(first_module(*file)), 4u);
+  EXPECT_EQ(file->toString(),
+            "module m (input [7:0] a, input [7:0] b, output [7:0] x);\n"
+            "wire [7:0] t0;\n"
+            "wire [7:0] t1;\n"
+            "assign t0 = a + b;\n"
+            "assign t1[3:0] = t0[3:0];\n"
+            "assign t1[7:4] = t0[7:4];\n"
+            "assign x = t1;\n"
+            "endmodule\n");
+  // Nothing left to remove
+  EXPECT_EQ(vAST::eliminate_dead_code(*file), 0u);
+}
+
+TEST(DCETests, TestInstancesAndAlways) {
+  auto file = vAST::parse(
+      "module m #(parameter N = 8) (input clk, input [7:0] a, "
+      "output [7:0] x);\n"
+      "wire [N - 1:0] to_inst;\n"
+      "wire [7:0] from_inst;\n"
+      "wire [7:0] dead;\n"
+      "reg [7:0] r;\n"
+      "reg [7:0] dead_reg;\n"
+      "assign to_inst = a;\n"
+      "assign dead = from_inst;\n"
+      "other inst(.i(to_inst), .o(from_inst));\n"
+      "always @(posedge clk) begin\n"
+      "r <= a;\n"
+      "end\n"
+      "\n"
+      "assign x = r;\n"
+      "endmodule\n");
+  EXPECT_EQ(vAST::eliminate_dead_code(*file), 3u);
+  EXPECT_EQ(file->toString(),
+            "module m #(parameter N = 8) (input clk, input [7:0] a, "
+            "output [7:0] x);\n"
+            "wire [N - 1:0] to_inst;\n"
+            "wire [7:0] from_inst;\n"
+            "reg [7:0] r;\n"
+            "assign to_inst = a;\n"
+            "other inst(.i(to_inst), .o(from_inst));\n"
+            "always @(posedge clk) begin\n"
+            "r <= a;\n"
+            "end\n"
+            "\n"
+            "assign x = r;\n"
+            "endmodule\n");
+}
+
+TEST(DCETests, TestStringPorts) {
+  auto file = vAST::parse(
+      "module m ();\n"
+      "wire y;\n"
+      "wire z;\n"
+      "assign y = 1;\n"
+      "assign z = y;\n"
+      "endmodule\n");
+  auto &module = first_module(*file);
+  module.ports.push_back(std::make_unique<vAST::StringPort>("output y"));
+  size_t hash = module.hash();
+  EXPECT_EQ(vAST::eliminate_dead_code(module), 2u);
+  EXPECT_NE(module.hash(), hash);
+  EXPECT_EQ(module.toString(),
+            "module m (output y);\n"
+            "wire y;\n"
+            "assign y = 1;\n"
+            "endmodule\n");
+
+  // Names are matched as whole words, `data` does not keep `a` alive
+  file = vAST::parse(
+      "module m ();\n"
+      "wire [7:0] data;\n"
+      "wire a;\n"
+      "assign data = 1;\n"
+      "assign a = 1;\n"
+      "endmodule\n");
+  auto &words = first_module(*file);
+  words.ports.push_back(
+      std::make_unique<vAST::StringPort>("output [7:0] data"));
+  EXPECT_EQ(vAST::eliminate_dead_code(words), 2u);
+  EXPECT_EQ(words.toString(),
+            "module m (output [7:0] data);\n"
+            "wire [7:0] data;\n"
+            "assign data = 1;\n"
+            "endmodule\n");
+
+  // Escaped names are matched too, without adding the words of the text to
+  // the symbol table
+  vAST::SymbolTable symbols;
+  vAST::SymbolTable::Scope scope(symbols);
+  file = vAST::parse(
+      "module m ();\n"
+      "wire \\y[0] ;\n"
+      "wire z;\n"
+      "assign \\y[0]  = z;\n"
+      "assign z = 1;\n"
+      "endmodule\n");
+  auto &escaped = first_module(*file);
+  escaped.ports.push_back(
+      std::make_unique<vAST::StringPort>("output \\y[0] , output w"));
+  size_t size = symbols.size();
+  EXPECT_EQ(vAST::eliminate_dead_code(escaped), 0u);
+  EXPECT_EQ(symbols.size(), size);
+}
+
+}  // namespace
@@ -0,0 +1,126 @@
+#include "verilogAST/emit_stats.hpp"
+
+#include "gtest/gtest.h"
+#include "verilogAST.hpp"
+#include "verilogAST/parser.hpp"
+#include "verilogAST/thread_pool.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+const char *kText =
+    "module a (input [7:0] x, output y);\n"
+    "assign y = x[0] + x[1];\n"
+    "endmodule\n"
+    "\n"
+    "module b (input \\a.b , output out);\n"
+    "a inst(.x(\\a.b ), .y(out));\n"
+    "endmodule\n";
+
+TEST(EmitStatsTests, TestCounters) {
+  auto file = vAST::parse(kText);
+  vAST::EmitStats stats;
+  vAST::StringSink sink;
+  sink.stats = &stats;
+  file->emit(sink);
+  EXPECT_EQ(sink.view(), std::string(kText));
+
+  EXPECT_EQ(stats.bytes, std::string(kText).size());
+  EXPECT_EQ(stats.nodes[vAST::NodeKind::FILE], 0u);
+  EXPECT_EQ(stats.nodes[vAST::NodeKind::MODULE], 2u);
+  EXPECT_EQ(stats.nodes[vAST::NodeKind::PORT], 4u);
+  EXPECT_EQ(stats.nodes[vAST::NodeKind::BINARY_OP], 1u);
+  EXPECT_EQ(stats.nodes[vAST::NodeKind::INDEX], 2u);
+  EXPECT_EQ(stats.nodes[vAST::NodeKind::MODULE_INSTANTIATION], 1u);
+  // Ports, the assign and the connections
+  EXPECT_EQ(stats.nodes[vAST::NodeKind::IDENTIFIER], 9u);
+  EXPECT_EQ(stats.escaped_identifiers, 2u);
+
+  ASSERT_EQ(stats.modules.size(), 2u);
+  EXPECT_EQ(stats.modules[0].name, "a");
+  EXPECT_EQ(stats.modules[0].bytes, 70u);
+  EXPECT_EQ(stats.modules[1].name, "b");
+  // The blank line between the modules only counts for the file
+  EXPECT_EQ(stats.modules[0].bytes + stats.modules[1].bytes + 1, stats.bytes);
+  EXPECT_EQ(stats.time, stats.modules[0].time + stats.modules[1].time);
+
+  // Counters accumulate until cleared
+  file->emit(sink);
+  EXPECT_EQ(stats.bytes, 2 * std::string(kText).size());
+  EXPECT_EQ(stats.modules.size(), 4u);
+  stats.clear();
+  EXPECT_EQ(stats.bytes, 0u);
+  EXPECT_EQ(stats.nodes[vAST::NodeKind::MODULE], 0u);
+  EXPECT_TRUE(stats.modules.empty());
+
+  // Modules also record themselves when emitted on their own, other nodes
+  // do not
+  file->modules[0]->emit(sink);
+  EXPECT_EQ(stats.bytes, 70u);
+  EXPECT_EQ(stats.modules.size(), 1u);
+  stats.clear();
+  static_cast<vAST::Module &>(*file->modules[0]).ports[0]->emit(sink);
+  EXPECT_EQ(stats.bytes, 0u);
+  EXPECT_EQ(stats.nodes[vAST::NodeKind::PORT], 0u);
+}
+
+TEST(EmitStatsTests, TestParallel) {
+  auto file = vAST::parse(kText);
+  vAST::EmitStats serial;
+  vAST::StringSink serial_sink;
+  serial_sink.stats = &serial;
+  file->emit(serial_sink);
+
+  vAST::ThreadPool pool(2);
+  vAST::EmitStats parallel;
+  vAST::StringSink parallel_sink;
+  parallel_sink.stats = &parallel;
+  file->emit(parallel_sink, pool);
+  EXPECT_EQ(parallel_sink.view(), std::string(kText));
+  EXPECT_EQ(parallel.bytes, serial.bytes);
+  EXPECT_EQ(parallel.nodes, serial.nodes);
+  EXPECT_EQ(parallel.escaped_identifiers, serial.escaped_identifiers);
+  ASSERT_EQ(parallel.modules.size(), 2u);
+  EXPECT_EQ(parallel.modules[0].name, "a");
+  EXPECT_EQ(parallel.modules[1].name, "b");
+  EXPECT_EQ(parallel.modules[1].bytes, serial.modules[1].bytes);
+}
+
+TEST(EmitStatsTests, TestCachedAndCompact) {
+  auto file = vAST::parse(kText);
+  file->cacheEmission(true);
+  file->emit_options.compact = true;
+  std::string compact = file->toString();
+  vAST::EmitStats stats;
+  vAST::StringSink sink;
+  sink.stats = &stats;
+  // Cached modules are counted as well
+  file->emit(sink);
+  EXPECT_EQ(sink.view(), compact);
+  EXPECT_EQ(stats.bytes, compact.size());
+  EXPECT_EQ(stats.nodes[vAST::NodeKind::MODULE], 2u);
+  EXPECT_EQ(stats.escaped_identifiers, 2u);
+}
+
+TEST(EmitStatsTests, TestJson) {
+  vAST::EmitStats stats;
+  stats.bytes = 10;
+  stats.escaped_identifiers = 1;
+  stats.time = std::chrono::nanoseconds(30);
+  stats.nodes[vAST::NodeKind::IDENTIFIER] = 3;
+  stats.nodes[vAST::NodeKind::BINARY_OP] = 1;
+  stats.modules.push_back({"top", 10, std::chrono::nanoseconds(20)});
+  stats.modules.push_back({"a\"b\\\n", 0, std::chrono::nanoseconds(0)});
+  EXPECT_EQ(stats.toJson(),
+            "{\"bytes\": 10, \"time_ns\": 30, \"escaped_identifiers\": 1, "
+            "\"nodes\": {\"Identifier\": 3, \"BinaryOp\": 1}, "
+            "\"modules\": [{\"name\": \"top\", \"bytes\": 10, "
+            "\"time_ns\": 20}, {\"name\": \"a\\\"b\\\\\\n\", \"bytes\": 0, "
+            "\"time_ns\": 0}]}");
+  EXPECT_STREQ(vAST::kind_name(vAST::NodeKind::MODULE_INSTANTIATION),
+               "ModuleInstantiation");
+  EXPECT_STREQ(vAST::kind_name(vAST::NodeKind::FILE), "File");
+}
+
+}  // namespace
@@ -0,0 +1,285 @@
+#include "gtest/gtest.h"
+#include "verilogAST.hpp"
+#include "verilogAST/passes.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+std::unique_ptr<vAST::NumericLiteral> num(std::string value, unsigned size,
+                                          bool _signed = false,
+                                          vAST::Radix radix = vAST::DECIMAL) {
+  return std::make_unique<vAST::NumericLiteral>(value, size, _signed, radix);
+}
+
+std::unique_ptr<vAST::Expression> binop(
+    std::unique_ptr<vAST::Expression> left, vAST::BinOp::BinOp op,
+    std::unique_ptr<vAST::Expression> right) {
+  return std::make_unique<vAST::BinaryOp>(std::move(left), op,
+                                          std::move(right));
+}
+
+std::string fold(std::unique_ptr<vAST::Expression> expr) {
+  return vAST::fold_constants(std::move(expr))->toString();
+}
+
+TEST(FoldConstantsTests, TestArithmetic) {
+  // width - 1
+  EXPECT_EQ(fold(binop(vAST::make_num("8"), vAST::BinOp::SUB,
+                       vAST::make_num("1"))),
+            "7");
+  EXPECT_EQ(fold(binop(num("3", 8), vAST::BinOp::ADD, num("4", 4))), "8'd7");
+  EXPECT_EQ(fold(binop(num("3", 8, true), vAST::BinOp::MUL, num("4", 8, true))),
+            "8'sd12");
+  EXPECT_EQ(fold(binop(num("ff", 16, false, vAST::HEX), vAST::BinOp::DIV,
+                       num("1_0", 8, false, vAST::BINARY))),
+            "16'h7F");
+  EXPECT_EQ(fold(binop(num("1", 8), vAST::BinOp::LSHIFT, vAST::make_num("7"))),
+            "8'd128");
+  EXPECT_EQ(fold(binop(num("2", 4), vAST::BinOp::POW, num("3", 4))), "4'd8");
+  EXPECT_EQ(fold(binop(vAST::make_num("5"), vAST::BinOp::EQ,
+                       num("5", 3, false, vAST::OCTAL))),
+            "1'b1");
+  // Nested operations fold bottom up
+  EXPECT_EQ(fold(binop(binop(vAST::make_num("2"), vAST::BinOp::MUL,
+                             vAST::make_num("4")),
+                       vAST::BinOp::SUB, vAST::make_num("1"))),
+            "7");
+}
+
+TEST(FoldConstantsTests, TestUnfoldable) {
+  // Overflows the width of the operation
+  EXPECT_EQ(fold(binop(num("255", 8), vAST::BinOp::ADD, num("1", 8))),
+            "8'd255 + 8'd1");
+  EXPECT_EQ(fold(binop(num("1", 8), vAST::BinOp::LSHIFT, num("8", 8))),
+            "8'd1 << 8'd8");
+  // Negative result
+  EXPECT_EQ(fold(binop(num("1", 8), vAST::BinOp::SUB, num("2", 8))),
+            "8'd1 - 8'd2");
+  // Negative signed operand
+  EXPECT_EQ(fold(binop(num("ff", 8, true, vAST::HEX), vAST::BinOp::ADD,
+                       num("1", 8, true))),
+            "8'shff + 8'sd1");
+  // Unknown digits
+  EXPECT_EQ(fold(binop(num("x", 8, false, vAST::HEX), vAST::BinOp::ADD,
+                       num("1", 8))),
+            "8'hx + 8'd1");
+  EXPECT_EQ(fold(binop(num("1", 8), vAST::BinOp::DIV, num("0", 8))),
+            "8'd1 / 8'd0");
+  // The result of ~ depends on the width of the context
+  EXPECT_EQ(fold(std::make_unique<vAST::UnaryOp>(num("0", 4),
+                                                 vAST::UnOp::INVERT)),
+            "~ 4'd0");
+}
+
+TEST(FoldConstantsTests, TestUnaryOps) {
+  EXPECT_EQ(fold(std::make_unique<vAST::UnaryOp>(num("f", 4, false, vAST::HEX),
+                                                 vAST::UnOp::AND)),
+            "1'b1");
+  EXPECT_EQ(fold(std::make_unique<vAST::UnaryOp>(num("7", 4), vAST::UnOp::AND)),
+            "1'b0");
+  EXPECT_EQ(fold(std::make_unique<vAST::UnaryOp>(num("7", 4), vAST::UnOp::XOR)),
+            "1'b1");
+  EXPECT_EQ(fold(std::make_unique<vAST::UnaryOp>(num("0", 4), vAST::UnOp::NOT)),
+            "1'b1");
+}
+
+TEST(FoldConstantsTests, TestIdentities) {
+  EXPECT_EQ(fold(binop(std::make_unique<vAST::Slice>(vAST::make_id("x"),
+                                                     vAST::make_num("31"),
+                                                     vAST::make_num("0")),
+                       vAST::BinOp::ADD, vAST::make_num("0"))),
+            "x[31:0]");
+  EXPECT_EQ(fold(binop(num("1", 8), vAST::BinOp::MUL,
+                       std::make_unique<vAST::Slice>(vAST::make_id("x"),
+                                                     vAST::make_num("7"),
+                                                     vAST::make_num("0")))),
+            "x[7:0]");
+  // The 32 bit literal is wider than x[3:0], and x may be narrower too
+  EXPECT_EQ(fold(binop(std::make_unique<vAST::Slice>(vAST::make_id("x"),
+                                                     vAST::make_num("3"),
+                                                     vAST::make_num("0")),
+                       vAST::BinOp::ADD, vAST::make_num("0"))),
+            "x[3:0] + 0");
+  EXPECT_EQ(fold(binop(vAST::make_id("x"), vAST::BinOp::ADD,
+                       num("0", 32, true))),
+            "x + 'sd0");
+  // x may be signed, and adding an unsigned 0 would make it unsigned
+  EXPECT_EQ(fold(binop(vAST::make_id("x"), vAST::BinOp::ADD,
+                       vAST::make_num("0"))),
+            "x + 0");
+  EXPECT_EQ(fold(binop(vAST::make_num("1"), vAST::BinOp::MUL,
+                       vAST::make_id("x"))),
+            "1 * x");
+  EXPECT_EQ(fold(binop(vAST::make_id("x"), vAST::BinOp::RSHIFT,
+                       vAST::make_num("0"))),
+            "x");
+  EXPECT_EQ(fold(binop(vAST::make_id("x"), vAST::BinOp::AND,
+                       num("0", 1, false, vAST::BINARY))),
+            "1'b0");
+  EXPECT_EQ(fold(binop(vAST::make_id("x"), vAST::BinOp::SUB,
+                       vAST::make_num("1"))),
+            "x - 1");
+
+  // The widths of x and y are unknown, so removing the literals could narrow
+  // the arguments of the concatenation
+  std::vector<std::unique_ptr<vAST::Expression>> args;
+  args.push_back(binop(vAST::make_id("x"), vAST::BinOp::ADD,
+                       vAST::make_num("0")));
+  args.push_back(binop(
+      binop(vAST::make_id("y"), vAST::BinOp::MUL, vAST::make_num("1")),
+      vAST::BinOp::ADD, vAST::make_id("z")));
+  args.push_back(binop(vAST::make_id("z"), vAST::BinOp::LSHIFT,
+                       vAST::make_num("0")));
+  args.push_back(binop(vAST::make_num("1"), vAST::BinOp::ADD,
+                       vAST::make_num("2")));
+  EXPECT_EQ(fold(std::make_unique<vAST::Concat>(std::move(args))),
+            "{x + 0,y * 1 + z,z,3}");
+
+  // Mixing signed and unsigned operands is unsigned
+  EXPECT_EQ(fold(binop(binop(num("1", 8, true), vAST::BinOp::SUB,
+                             std::make_unique<vAST::Slice>(
+                                 vAST::make_id("x"), vAST::make_num("3"),
+                                 vAST::make_num("0"))),
+                       vAST::BinOp::ADD, num("0", 8))),
+            "8'sd1 - x[3:0]");
+  // Would change the signedness of the operation
+  EXPECT_EQ(fold(binop(std::make_unique<vAST::UnaryOp>(num("3", 8, true),
+                                                       vAST::UnOp::MINUS),
+                       vAST::BinOp::ADD, vAST::make_num("0"))),
+            "- 8'sd3 + 0");
+
+  // The carry of a[7:0] + b[7:0] is kept by the 32 bit addition, whatever
+  // the context
+  auto sum = [] {
+    return binop(binop(std::make_unique<vAST::Slice>(vAST::make_id("a"),
+                                                     vAST::make_num("7"),
+                                                     vAST::make_num("0")),
+                       vAST::BinOp::ADD,
+                       std::make_unique<vAST::Slice>(vAST::make_id("b"),
+                                                     vAST::make_num("7"),
+                                                     vAST::make_num("0"))),
+                 vAST::BinOp::ADD, vAST::make_num("0"));
+  };
+  EXPECT_EQ(fold(binop(sum(), vAST::BinOp::RSHIFT, vAST::make_num("1"))),
+            "a[7:0] + b[7:0] + 0 >> 1");
+  EXPECT_EQ(fold(binop(sum(), vAST::BinOp::EQ,
+                       std::make_unique<vAST::Slice>(vAST::make_id("c"),
+                                                     vAST::make_num("7"),
+                                                     vAST::make_num("0")))),
+            "a[7:0] + b[7:0] + 0 == c[7:0]");
+  EXPECT_EQ(fold(std::make_unique<vAST::Index>(vAST::make_id("m"), sum())),
+            "m[a[7:0] + b[7:0] + 0]");
+}
+
+TEST(FoldConstantsTests, TestTernary) {
+  EXPECT_EQ(fold(std::make_unique<vAST::TernaryOp>(
+                binop(vAST::make_num("1"), vAST::BinOp::EQ,
+                      vAST::make_num("2")),
+                num("3", 8), num("5", 8))),
+            "8'd5");
+  EXPECT_EQ(fold(std::make_unique<vAST::TernaryOp>(
+                vAST::make_num("1"), num("3", 8, true), num("1", 4, true))),
+            "8'sd3");
+  // x may be narrower than 8 bits
+  EXPECT_EQ(fold(std::make_unique<vAST::TernaryOp>(
+                vAST::make_num("1"), vAST::make_id("x"), num("1", 8, true))),
+            "1 ? x : 8'sd1");
+  // x and y may differ in signedness, which makes the result unsigned
+  EXPECT_EQ(fold(std::make_unique<vAST::TernaryOp>(
+                binop(vAST::make_num("1"), vAST::BinOp::EQ,
+                      vAST::make_num("2")),
+                vAST::make_id("x"), vAST::make_id("y"))),
+            "1'b0 ? x : y");
+  EXPECT_EQ(fold(std::make_unique<vAST::TernaryOp>(
+                vAST::make_id("c"), vAST::make_id("x"), vAST::make_id("y"))),
+            "c ? x : y");
+}
+
+TEST(FoldConstantsTests, TestModule) {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::Port>(
+      std::make_unique<vAST::Vector>(
+          vAST::make_id("i"),
+          binop(vAST::make_id("WIDTH"), vAST::BinOp::SUB, vAST::make_num("1")),
+          vAST::make_num("0")),
+      vAST::INPUT, vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("o"),
+                                               vAST::OUTPUT, vAST::WIRE));
+
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("o"),
+      std::make_unique<vAST::Slice>(
+          vAST::make_id("i"),
+          binop(vAST::make_num("4"), vAST::BinOp::SUB, vAST::make_num("1")),
+          binop(vAST::make_num("1"), vAST::BinOp::ADD, vAST::make_num("2")))));
+
+  vAST::Parameters parameters;
+  parameters.push_back(std::make_pair(
+      vAST::make_id("WIDTH"),
+      binop(vAST::make_num("4"), vAST::BinOp::MUL, vAST::make_num("2"))));
+
+  vAST::Module module("test_module", std::move(ports), std::move(body),
+                      std::move(parameters));
+  vAST::fold_constants(module);
+  EXPECT_EQ(module.toString(),
+            "module test_module #(parameter WIDTH = 8) (input [WIDTH - 1:0] i, "
+            "output o);\n"
+            "assign o = i[3];\n"
+            "endmodule\n");
+}
+
+TEST(FoldConstantsTests, TestDeclaredIdentities) {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::Port>(
+      std::make_unique<vAST::Vector>(vAST::make_id("x"), vAST::make_num("7"),
+                                     vAST::make_num("0")),
+      vAST::INPUT, vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("o"),
+                                               vAST::OUTPUT, vAST::WIRE));
+
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  body.push_back(std::make_unique<vAST::Wire>(std::make_unique<vAST::Vector>(
+      vAST::make_id("y"), vAST::make_num("31"), vAST::make_num("0"))));
+  auto assign = [&](std::unique_ptr<vAST::Expression> value) {
+    body.push_back(std::make_unique<vAST::ContinuousAssign>(vAST::make_id("o"),
+                                                            std::move(value)));
+  };
+  assign(binop(vAST::make_id("x"), vAST::BinOp::ADD, num("0", 8)));
+  assign(binop(vAST::make_id("x"), vAST::BinOp::MUL, num("1", 4)));
+  assign(binop(num("1", 8), vAST::BinOp::MUL, vAST::make_id("x")));
+  // Adding a signed literal to an unsigned net is unsigned
+  assign(binop(vAST::make_id("x"), vAST::BinOp::ADD, num("0", 8, true)));
+  // The 32 bit literal is as wide as y
+  assign(binop(vAST::make_id("y"), vAST::BinOp::ADD, vAST::make_num("0")));
+  // The literals are wider than x
+  assign(binop(vAST::make_id("x"), vAST::BinOp::ADD, vAST::make_num("0")));
+  assign(binop(vAST::make_id("x"), vAST::BinOp::MUL, num("1", 16)));
+  assign(binop(vAST::make_id("x"), vAST::BinOp::ADD, num("0", 32, true)));
+  // The width of z is not declared in the module
+  assign(binop(vAST::make_id("z"), vAST::BinOp::ADD, num("0", 8)));
+
+  vAST::Module module("test_module", std::move(ports), std::move(body),
+                      vAST::Parameters());
+  vAST::fold_constants(module);
+  EXPECT_EQ(module.toString(),
+            "module test_module (input [7:0] x, output o);\n"
+            "wire [31:0] y;\n"
+            "assign o = x;\n"
+            "assign o = x;\n"
+            "assign o = x;\n"
+            "assign o = x;\n"
+            "assign o = y;\n"
+            "assign o = x + 0;\n"
+            "assign o = x * 16'd1;\n"
+            "assign o = x + 'sd0;\n"
+            "assign o = z + 8'd0;\n"
+            "endmodule\n");
+}
+
+}  // namespace
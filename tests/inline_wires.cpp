@@ -0,0 +1,125 @@
+#include "gtest/gtest.h"
+#include "verilogAST.hpp"
+#include "verilogAST/parser.hpp"
+#include "verilogAST/passes.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+TEST(InlineWiresTests, TestChain) {
+  auto file = vAST::parse(
+      "module m (input [7:0] a, input [7:0] b, input [7:0] c, "
+      "output [7:0] x, output y);\n"
+      "wire [7:0] t0;\n"
+      "wire [7:0] t1;\n"
+      "wire [7:0] t2;\n"
+      "wire t3;\n"
+      "assign t2 = t1 * t0;\n"
+      "assign t0 = a + b;\n"
+      "assign t1 = c - a;\n"
+      "assign x = t2;\n"
+      "assign t3 = a[0] && b[1];\n"
+      "assign y = ~t3;\n"
+      "endmodule\n");
+  auto hash = file->hash();
+  EXPECT_EQ(vAST::inline_wires(*file), 4u);
+  EXPECT_NE(file->hash(), hash);
+  EXPECT_EQ(file->toString(),
+            "module m (input [7:0] a, input [7:0] b, input [7:0] c, "
+            "output [7:0] x, output y);\n"
+            "assign x = (c - a) * (a + b);\n"
+            "assign y = ~ (a[0] && b[1]);\n"
+            "endmodule\n");
+  EXPECT_EQ(vAST::inline_wires(*file), 0u);
+}
+
+TEST(InlineWiresTests, TestKept) {
+  auto file = vAST::parse(
+      "module m (input clk, input [7:0] a, input [7:0] b, output [7:0] x, "
+      "output [7:0] y, output [8:0] z);\n"
+      // Read twice
+      "wire [7:0] twice;\n"
+      // Read by an instance and an always block
+      "wire [7:0] to_inst;\n"
+      "wire [7:0] to_always;\n"
+      // Driven by an instance
+      "wire [7:0] from_inst;\n"
+      // Narrower than its value
+      "wire [3:0] narrow;\n"
+      // Would carry into the wider context of its reader
+      "wire [7:0] sum;\n"
+      // Driven in pieces
+      "wire [7:0] pieces;\n"
+      // An output
+      "assign x = a;\n"
+      "assign twice = a + b;\n"
+      "assign to_inst = twice + twice;\n"
+      "assign to_always = a;\n"
+      "assign narrow = a;\n"
+      "assign sum = a + b;\n"
+      "assign pieces[3:0] = a[3:0];\n"
+      "assign pieces[7:4] = b[7:4];\n"
+      "assign y = from_inst + narrow + pieces;\n"
+      "assign z = sum + a;\n"
+      "other inst(.i(to_inst), .o(from_inst));\n"
+      "reg [7:0] r;\n"
+      "always @(posedge clk) begin\n"
+      "r <= to_always;\n"
+      "end\n"
+      "\n"
+      "endmodule\n");
+  std::string before = file->toString();
+  EXPECT_EQ(vAST::inline_wires(*file), 0u);
+  EXPECT_EQ(file->toString(), before);
+}
+
+TEST(InlineWiresTests, TestMaxNodes) {
+  const char *text =
+      "module m (input [7:0] a, input [7:0] b, output [7:0] x);\n"
+      "wire [7:0] t0;\n"
+      "wire [7:0] t1;\n"
+      "assign t0 = a + b;\n"
+      "assign t1 = t0 - a;\n"
+      "assign x = t1 * b;\n"
+      "endmodule\n";
+  // `a + b` can be inlined into `t1`, which is then too large for `x`
+  auto file = vAST::parse(text);
+  EXPECT_EQ(vAST::inline_wires(*file, 5), 1u);
+  EXPECT_EQ(file->toString(),
+            "module m (input [7:0] a, input [7:0] b, output [7:0] x);\n"
+            "wire [7:0] t1;\n"
+            "assign t1 = a + b - a;\n"
+            "assign x = t1 * b;\n"
+            "endmodule\n");
+
+  file = vAST::parse(text);
+  EXPECT_EQ(vAST::inline_wires(*file, 7), 2u);
+  EXPECT_EQ(file->toString(),
+            "module m (input [7:0] a, input [7:0] b, output [7:0] x);\n"
+            "assign x = (a + b - a) * b;\n"
+            "endmodule\n");
+}
+
+TEST(InlineWiresTests, TestDelays) {
+  const char *text =
+      "module m (input a, output o);\n"
+      "wire w;\n"
+      "assign w = ~a;\n"
+      "assign o = w;\n"
+      "endmodule\n";
+  // The delay of either assignment would be lost
+  for (size_t delayed : {1, 2}) {
+    auto file = vAST::parse(text);
+    auto &module = static_cast<vAST::Module &>(*file->modules[0]);
+    auto &assign = static_cast<vAST::ContinuousAssign &>(
+        *std::get<std::unique_ptr<vAST::StructuralStatement>>(
+            module.body[delayed]));
+    assign.setPrefix("assign #5 ");
+    std::string before = file->toString();
+    EXPECT_EQ(vAST::inline_wires(*file), 0u);
+    EXPECT_EQ(file->toString(), before);
+  }
+}
+
+}  // namespace
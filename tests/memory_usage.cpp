@@ -0,0 +1,149 @@
+#include "verilogAST/memory_usage.hpp"
+
+#include "gtest/gtest.h"
+#include "verilogAST.hpp"
+#include "verilogAST/parser.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+// Bytes of a node object, rounded up to the alignment
+size_t allocation(size_t size) {
+  size_t alignment = vAST::Arena::kAlignment;
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+TEST(MemoryUsageTests, TestLeaves) {
+  auto id = vAST::make_id("x");
+  vAST::MemoryUsage usage = id->memoryUsage();
+  EXPECT_EQ(usage.nodes[vAST::NodeKind::IDENTIFIER], 1u);
+  auto &bytes = usage.bytes[vAST::NodeKind::IDENTIFIER];
+  EXPECT_EQ(bytes.objects, sizeof(vAST::Identifier));
+  EXPECT_EQ(bytes.strings, 0u);
+  EXPECT_EQ(bytes.containers, 0u);
+  EXPECT_EQ(bytes.objects + bytes.indirection,
+            allocation(sizeof(vAST::Identifier)));
+  EXPECT_EQ(usage.total().total(), bytes.total());
+
+  // Short strings are stored within the string object
+  EXPECT_EQ(vAST::String("short").memoryUsage().total().strings, 0u);
+  std::string text(100, 'a');
+  EXPECT_GE(vAST::String(text).memoryUsage().total().strings, 101u);
+
+  // Integer literals keep their words inline up to 64 bits
+  EXPECT_EQ(vAST::NumericLiteral(5, 64).memoryUsage().total().containers, 0u);
+  vAST::NumericLiteral wide(std::vector<uint64_t>{1, 2, 3}, 192);
+  EXPECT_EQ(wide.memoryUsage().total().containers, 4 * sizeof(uint64_t));
+}
+
+TEST(MemoryUsageTests, TestTree) {
+  std::vector<std::unique_ptr<vAST::Expression>> args;
+  args.reserve(8);
+  args.push_back(vAST::make_id("a"));
+  args.push_back(vAST::make_binop(vAST::make_id("b"), vAST::BinOp::ADD,
+                                  vAST::make_num("1")));
+  vAST::Concat concat(std::move(args));
+  vAST::MemoryUsage usage = concat.memoryUsage();
+  EXPECT_EQ(usage.nodes[vAST::NodeKind::CONCAT], 1u);
+  EXPECT_EQ(usage.nodes[vAST::NodeKind::IDENTIFIER], 2u);
+  EXPECT_EQ(usage.nodes[vAST::NodeKind::BINARY_OP], 1u);
+  EXPECT_EQ(usage.nodes[vAST::NodeKind::NUMERIC_LITERAL], 1u);
+  // The reserved capacity counts, not only the arguments
+  EXPECT_EQ(usage.bytes[vAST::NodeKind::CONCAT].containers,
+            8 * sizeof(std::unique_ptr<vAST::Expression>));
+  EXPECT_EQ(usage.bytes[vAST::NodeKind::IDENTIFIER].objects,
+            2 * sizeof(vAST::Identifier));
+
+  auto total = usage.total();
+  size_t sum = 0;
+  for (auto &bytes : usage.bytes) sum += bytes.total();
+  EXPECT_EQ(total.total(), sum);
+}
+
+TEST(MemoryUsageTests, TestFile) {
+  auto file = vAST::parse(
+      "module a (input [7:0] x, output y);\n"
+      "wire [7:0] t;\n"
+      "assign t = x + 8'd1;\n"
+      "assign y = t[0];\n"
+      "endmodule\n");
+  vAST::MemoryUsage usage = file->memoryUsage();
+  EXPECT_EQ(usage.nodes[vAST::NodeKind::FILE], 1u);
+  EXPECT_EQ(usage.nodes[vAST::NodeKind::MODULE], 1u);
+  EXPECT_EQ(usage.nodes[vAST::NodeKind::PORT], 2u);
+  EXPECT_EQ(usage.nodes[vAST::NodeKind::WIRE], 1u);
+  EXPECT_EQ(usage.nodes[vAST::NodeKind::CONTINUOUS_ASSIGN], 2u);
+  auto &module = static_cast<vAST::Module &>(*file->modules[0]);
+  EXPECT_EQ(usage.bytes[vAST::NodeKind::MODULE].containers,
+            module.ports.capacity() * sizeof(module.ports[0]) +
+                module.body.capacity() * sizeof(module.body[0]) +
+                module.parameters.capacity() *
+                    sizeof(vAST::Parameters::value_type));
+  // A module counts the same on its own
+  EXPECT_EQ(module.memoryUsage().bytes[vAST::NodeKind::MODULE].total(),
+            usage.bytes[vAST::NodeKind::MODULE].total());
+
+  // The cached text of a module is owned by the module
+  size_t strings = usage.bytes[vAST::NodeKind::MODULE].strings;
+  file->cacheEmission(true);
+  std::string text = file->toString();
+  EXPECT_GE(file->memoryUsage().bytes[vAST::NodeKind::MODULE].strings,
+            strings + text.size() + 1);
+}
+
+// Target sizes of the node classes on 64 bit targets with libstdc++ (other
+// standard libraries have smaller strings).  Node carries a 32 bit hash memo
+// next to its vtable pointer, and the most common nodes keep a 32 bit field
+// in the padding after it, so that literals (56), binary (32) and unary (24)
+// operators and ports (32) are no larger than before the memo.  Identifiers
+// refer to interned names (24, down from 40), and assignments (48, down from
+// 104) and declarations (32, down from 56) derive their keywords from the
+// class.
+TEST(MemoryUsageTests, TestLayout) {
+  if (sizeof(void *) != 8) GTEST_SKIP();
+  EXPECT_LE(sizeof(vAST::Node), 16u);
+  EXPECT_LE(sizeof(vAST::NumericLiteral), 56u);
+  EXPECT_LE(sizeof(vAST::Identifier), 24u);
+  EXPECT_LE(sizeof(vAST::String), 48u);
+  EXPECT_LE(sizeof(vAST::Index), 32u);
+  EXPECT_LE(sizeof(vAST::Slice), 40u);
+  EXPECT_LE(sizeof(vAST::BinaryOp), 32u);
+  EXPECT_LE(sizeof(vAST::UnaryOp), 24u);
+  EXPECT_LE(sizeof(vAST::TernaryOp), 40u);
+  EXPECT_LE(sizeof(vAST::Concat), 40u);
+  EXPECT_LE(sizeof(vAST::PosEdge), 24u);
+  EXPECT_LE(sizeof(vAST::Vector), 40u);
+  EXPECT_LE(sizeof(vAST::Port), 32u);
+  EXPECT_LE(sizeof(vAST::ModuleInstantiation), 80u);
+  EXPECT_LE(sizeof(vAST::Wire), 32u);
+  EXPECT_LE(sizeof(vAST::Reg), 32u);
+  EXPECT_LE(sizeof(vAST::ContinuousAssign), 48u);
+  EXPECT_LE(sizeof(vAST::BlockingAssign), 48u);
+  EXPECT_LE(sizeof(vAST::NonBlockingAssign), 48u);
+  EXPECT_LE(sizeof(vAST::Always), 64u);
+  EXPECT_LE(sizeof(vAST::Module), 136u);
+  EXPECT_LE(sizeof(vAST::File), 48u);
+  // Nodes are allocated without a header
+  EXPECT_LE(allocation(sizeof(vAST::ContinuousAssign)), 48u);
+}
+
+TEST(MemoryUsageTests, TestJson) {
+  vAST::MemoryUsage usage;
+  usage.nodes[vAST::NodeKind::IDENTIFIER] = 2;
+  usage.bytes[vAST::NodeKind::IDENTIFIER].objects = 32;
+  usage.bytes[vAST::NodeKind::IDENTIFIER].indirection = 32;
+  usage.nodes[vAST::NodeKind::STRING] = 1;
+  usage.bytes[vAST::NodeKind::STRING].objects = 40;
+  usage.bytes[vAST::NodeKind::STRING].strings = 31;
+  EXPECT_EQ(usage.toJson(),
+            "{\"total\": {\"nodes\": 3, \"objects\": 72, \"strings\": 31, "
+            "\"containers\": 0, \"indirection\": 32, \"bytes\": 135}, "
+            "\"classes\": {\"Identifier\": {\"nodes\": 2, \"objects\": 32, "
+            "\"strings\": 0, \"containers\": 0, \"indirection\": 32, "
+            "\"bytes\": 64}, \"String\": {\"nodes\": 1, \"objects\": 40, "
+            "\"strings\": 31, \"containers\": 0, \"indirection\": 0, "
+            "\"bytes\": 71}}}");
+}
+
+}  // namespace
@@ -0,0 +1,197 @@
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "gtest/gtest.h"
+#include "verilogAST.hpp"
+#include "verilogAST/parser.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+const char *kModule =
+    "module test_module #(parameter N = 8, parameter M = 'hFF) "
+    "(input clk, input [N - 1:0] a, input [7:0] b, output reg [7:0] x, "
+    "inout c);\n"
+    "wire [7:0] w;\n"
+    "reg r;\n"
+    "wire y[3];\n"
+    "assign w = a + b * 8'hF0 - ~ b[0] ? {a[3:0],b[7:4]} : 8'sd3;\n"
+    "assign \\esc[0]  = \\or  << 2 >>> 1 ** 3 % 4 == 5 && 6 != 7 || \"s\";\n"
+    "always @(posedge clk, negedge a, b) begin\n"
+    "reg t;\n"
+    "x <= w;\n"
+    "r = ! & ~& | ~| ^ ~^ ^~ + - a;\n"
+    "end\n"
+    "\n"
+    "always @(*) begin\n"
+    "end\n"
+    "\n"
+    "other_module #(.N(N), .M(4'b1010)) inst(.i(a[0]), .j({a,b}), .k(w[3:0]), "
+    ".l(x));\n"
+    "endmodule\n";
+
+TEST(ParserTests, TestRoundTrip) {
+  std::unique_ptr<vAST::File> file = vAST::parse(kModule);
+  ASSERT_EQ(file->modules.size(), 1u);
+  EXPECT_EQ(file->toString(), kModule);
+  // Parsing the output again gives the same tree
+  EXPECT_TRUE(vAST::parse(file->toString())->structurallyEqual(*file));
+}
+
+TEST(ParserTests, TestConnectionOrder) {
+  const char *source =
+      "module m ();\n"
+      "other inst(.z(a), .y(b[0]), .x(c));\n"
+      "endmodule\n";
+  EXPECT_EQ(vAST::parse(source)->toString(), source);
+}
+
+TEST(ParserTests, TestCompactRoundTrip) {
+  auto file = vAST::parse(kModule);
+  file->emit_options.compact = true;
+  std::string compact = file->toString();
+  EXPECT_LT(compact.size(), std::string(kModule).size());
+  EXPECT_TRUE(vAST::parse(compact)->structurallyEqual(*file));
+}
+
+TEST(ParserTests, TestPrecedence) {
+  auto file = vAST::parse(
+      "module m (); assign x = a + b * c; assign y = (a + b) * c;\n"
+      "assign z = a ? b : c ? d : e; assign u = - a ** b; endmodule");
+  auto &body = static_cast<vAST::Module &>(*file->modules[0]).body;
+  auto value = [&](size_t i) -> vAST::Expression & {
+    return *static_cast<vAST::ContinuousAssign &>(
+                *std::get<std::unique_ptr<vAST::StructuralStatement>>(body[i]))
+                .value;
+  };
+  auto &x = static_cast<vAST::BinaryOp &>(value(0));
+  EXPECT_EQ(x.op, vAST::BinOp::ADD);
+  EXPECT_EQ(x.right->toString(), "b * c");
+  auto &y = static_cast<vAST::BinaryOp &>(value(1));
+  EXPECT_EQ(y.op, vAST::BinOp::MUL);
+  EXPECT_EQ(y.left->toString(), "a + b");
+  auto &z = static_cast<vAST::TernaryOp &>(value(2));
+  EXPECT_EQ(z.cond->toString(), "a");
+  EXPECT_EQ(z.false_value->kind(), vAST::NodeKind::TERNARY_OP);
+  // Unary operators bind tighter than `**`
+  auto &u = static_cast<vAST::BinaryOp &>(value(3));
+  EXPECT_EQ(u.op, vAST::BinOp::POW);
+  // Parentheses are emitted where the grouping needs them
+  EXPECT_EQ(y.toString(), "(a + b) * c");
+  EXPECT_TRUE(vAST::parse(file->toString())->structurallyEqual(*file));
+}
+
+TEST(ParserTests, TestLiterals) {
+  auto file = vAST::parse(
+      "module m (); assign x = {3, 16'D23, 8'd7, 'hDEADBEEF, 6'b011001, "
+      "24'o764, 8'Sd764, 4'sb1x0z}; endmodule");
+  EXPECT_EQ(file->toString(),
+            "module m ();\n"
+            "assign x = {3,16'd23,8'd7,'hDEADBEEF,6'b011001,24'o764,8'sd764,"
+            "4'sb1x0z};\n"
+            "endmodule\n");
+  auto &assign = static_cast<vAST::ContinuousAssign &>(
+      *std::get<std::unique_ptr<vAST::StructuralStatement>>(
+          static_cast<vAST::Module &>(*file->modules[0]).body[0]));
+  auto &args = static_cast<vAST::Concat &>(*assign.value).args;
+  auto &literal = static_cast<vAST::NumericLiteral &>(*args[7]);
+  EXPECT_EQ(literal.value(), "1x0z");
+  EXPECT_EQ(literal.size, 4u);
+  EXPECT_TRUE(literal._signed);
+  EXPECT_EQ(literal.radix, vAST::BINARY);
+}
+
+TEST(ParserTests, TestComments) {
+  auto file = vAST::parse(
+      "// header\n"
+      "module m (input a /* the input */, output b); // ports\n"
+      "/* multi\n"
+      "   line */ assign b = a;\n"
+      "endmodule\n");
+  EXPECT_EQ(file->toString(),
+            "module m (input a, output b);\n"
+            "assign b = a;\n"
+            "endmodule\n");
+}
+
+TEST(ParserTests, TestDeep) {
+  std::string source = "module m (); assign x = ";
+  for (int i = 0; i < 100000; i++) source += "~ (";
+  source += "a";
+  source += std::string(100000, ')');
+  source += "; endmodule";
+  auto file = vAST::parse(source);
+  auto expected = std::string("module m ();\nassign x = ");
+  for (int i = 0; i < 100000; i++) expected += "~ ";
+  expected += "a;\nendmodule\n";
+  EXPECT_EQ(file->toString(), expected);
+}
+
+TEST(ParserTests, TestParallel) {
+  std::string source, expected;
+  for (int i = 0; i < 200; i++) {
+    std::string header = "module m" + std::to_string(i) +
+                         " (input [7:0] a, output [7:0] b);\n";
+    std::string body =
+        "assign b = a + " + std::to_string(i) + ";\nendmodule\n\n";
+    source += header + "// endmodule in a comment\n" + body;
+    expected += header + body;
+  }
+  expected.pop_back();
+  vAST::ThreadPool pool(4);
+  vAST::ParseOptions options;
+  options.pool = &pool;
+  auto file = vAST::parse(source, options);
+  ASSERT_EQ(file->modules.size(), 200u);
+  EXPECT_EQ(file->toString(), expected);
+  EXPECT_TRUE(file->structurallyEqual(*vAST::parse(source)));
+}
+
+TEST(ParserTests, TestParseFile) {
+  char path[] = "/tmp/verilogAST_parser_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  std::ofstream(path) << kModule;
+  EXPECT_EQ(vAST::parse_file(path)->toString(), kModule);
+  std::ofstream(path, std::ios::trunc);
+  EXPECT_TRUE(vAST::parse_file(path)->modules.empty());
+  std::remove(path);
+  EXPECT_THROW(vAST::parse_file(path), std::system_error);
+}
+
+TEST(ParserTests, TestErrors) {
+  auto error = [](const char *source) {
+    try {
+      vAST::parse(source);
+    } catch (std::runtime_error &e) {
+      return std::string(e.what());
+    }
+    return std::string();
+  };
+  EXPECT_EQ(error("module m ();\nassign x = a +;\nendmodule"),
+            "vAST::parse: line 2: expected an expression but found ';'");
+  EXPECT_EQ(error("module m ();\n\nassign x = (a;\nendmodule"),
+            "vAST::parse: line 3: expected ')' but found ';'");
+  EXPECT_EQ(error("module m ();\nassign a + b = c;\nendmodule"),
+            "vAST::parse: line 2: invalid assignment target");
+  EXPECT_EQ(error("module m ();\ninitial begin end\nendmodule"),
+            "vAST::parse: line 2: unsupported statement 'initial'");
+  EXPECT_EQ(error("module m ();\nassign x = a < b;\nendmodule"),
+            "vAST::parse: line 2: expected ';' but found '<'");
+  EXPECT_EQ(error("module m ();\nother inst(.a(x),\n.a(y));\nendmodule"),
+            "vAST::parse: line 3: duplicate connection 'a'");
+  // The base is required after the quote
+  EXPECT_EQ(error("module m ();\nassign x = 16'23;\nendmodule"),
+            "vAST::parse: line 2: invalid literal '16'23'");
+  EXPECT_EQ(error("module m ();\nassign x = 8's764;\nendmodule"),
+            "vAST::parse: line 2: invalid literal '8's764'");
+  EXPECT_EQ(error("module m ();\n"),
+            "vAST::parse: line 2: expected 'endmodule' but found end of "
+            "input");
+}
+
+}  // namespace
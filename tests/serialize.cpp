@@ -0,0 +1,131 @@
+#include <unistd.h>
+
+#include <cstdio>
+
+#include "gtest/gtest.h"
+#include "verilogAST.hpp"
+#include "verilogAST/parser.hpp"
+#include "verilogAST/serialize.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+const char *kSource =
+    "module test_module #(parameter N = 8) (input clk, input [N - 1:0] a, "
+    "output reg [7:0] x, inout \\c[0] );\n"
+    "wire [7:0] w;\n"
+    "reg r[3];\n"
+    "wire y[3:0];\n"
+    "assign w = a + 8'hF0 - ~ a[0] ? {a[3:0],a[7:4]} : 8'sd3;\n"
+    "always @(posedge clk, negedge a, *) begin\n"
+    "x <= w;\n"
+    "r = \"s\";\n"
+    "end\n"
+    "\n"
+    "other #(.N(N)) inst(.i(a[0]), .j({a,w}), .k(w[3:0]), .l(x));\n"
+    "endmodule\n";
+
+std::unique_ptr<vAST::File> make_file() {
+  auto file = vAST::parse(kSource);
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::StringPort>("input i"));
+  file->modules.push_back(std::make_unique<vAST::StringBodyModule>(
+      "string_body", std::move(ports), "assign o = i;", vAST::Parameters()));
+  file->modules.push_back(
+      std::make_unique<vAST::StringModule>("module string;\nendmodule\n"));
+  return file;
+}
+
+std::string serialize(const vAST::Node &node) {
+  vAST::StringSink sink;
+  vAST::serialize(node, sink);
+  return sink.release();
+}
+
+TEST(SerializeTests, TestRoundTrip) {
+  auto file = make_file();
+  // Edited fields are kept
+  auto &module = static_cast<vAST::Module &>(*file->modules[0]);
+  auto &assign = static_cast<vAST::ContinuousAssign &>(
+      *std::get<std::unique_ptr<vAST::StructuralStatement>>(module.body[3]));
+  assign.setPrefix("assign #1 ");
+  std::string data = serialize(*file);
+  std::unique_ptr<vAST::Node> copy = vAST::deserialize(data);
+  ASSERT_EQ(copy->kind(), vAST::NodeKind::FILE);
+  EXPECT_TRUE(copy->structurallyEqual(*file));
+  EXPECT_EQ(copy->toString(), file->toString());
+  // Serializing is deterministic
+  EXPECT_EQ(serialize(*copy), data);
+}
+
+TEST(SerializeTests, TestEmitOptions) {
+  auto file = make_file();
+  file->emit_options.compact = true;
+  auto copy = vAST::deserialize(serialize(*file));
+  ASSERT_EQ(copy->kind(), vAST::NodeKind::FILE);
+  EXPECT_TRUE(static_cast<vAST::File &>(*copy).emit_options.compact);
+  EXPECT_EQ(copy->toString(), file->toString());
+}
+
+TEST(SerializeTests, TestExpression) {
+  auto expr = std::make_unique<vAST::BinaryOp>(
+      vAST::make_id("a"), vAST::BinOp::ADD, vAST::make_num("1"));
+  auto copy = vAST::deserialize(serialize(*expr));
+  EXPECT_TRUE(copy->structurallyEqual(*expr));
+}
+
+TEST(SerializeTests, TestDeep) {
+  std::unique_ptr<vAST::Expression> expr = vAST::make_id("a");
+  for (int i = 0; i < 100000; i++) {
+    expr = std::make_unique<vAST::UnaryOp>(std::move(expr), vAST::UnOp::INVERT);
+  }
+  EXPECT_TRUE(vAST::deserialize(serialize(*expr))->structurallyEqual(*expr));
+}
+
+TEST(SerializeTests, TestSymbolTable) {
+  auto file = make_file();
+  std::string data = serialize(*file);
+  vAST::SymbolTable symbols;
+  vAST::SymbolTable::Scope scope(symbols);
+  auto copy = vAST::deserialize(data);
+  EXPECT_GT(symbols.size(), 0u);
+  EXPECT_TRUE(copy->structurallyEqual(*file));
+}
+
+TEST(SerializeTests, TestErrors) {
+  auto file = make_file();
+  std::string data = serialize(*file);
+  EXPECT_THROW(vAST::deserialize("not a tree"), std::runtime_error);
+  for (size_t size : {size_t(20), data.size() / 2, data.size() - 1}) {
+    EXPECT_THROW(vAST::deserialize(data.substr(0, size)), std::runtime_error);
+  }
+  std::string corrupt = data;
+  // Change the kind of the first record
+  corrupt[12] = vAST::NodeKind::FILE;
+  EXPECT_THROW(vAST::deserialize(corrupt), std::runtime_error);
+  std::string version = data;
+  version[8] = 2;
+  try {
+    vAST::deserialize(version);
+    FAIL();
+  } catch (std::runtime_error &e) {
+    EXPECT_EQ(std::string(e.what()),
+              "vAST::deserialize: unsupported version 2");
+  }
+}
+
+TEST(SerializeTests, TestFile) {
+  char path[] = "/tmp/verilogAST_serialize_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  auto file = make_file();
+  size_t size = vAST::save_binary(*file, path);
+  EXPECT_EQ(size, serialize(*file).size());
+  EXPECT_TRUE(vAST::load_binary(path)->structurallyEqual(*file));
+  std::remove(path);
+  EXPECT_THROW(vAST::load_binary(path), std::system_error);
+}
+
+}  // namespace
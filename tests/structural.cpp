@@ -0,0 +1,313 @@
+#include "gtest/gtest.h"
+#include "verilogAST.hpp"
+#include "verilogAST/passes.hpp"
+#include "verilogAST/transformer.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+typedef std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                                 std::unique_ptr<vAST::Declaration>>>
+    Body;
+
+std::unique_ptr<vAST::Expression> make_expr(std::string right) {
+  return std::make_unique<vAST::BinaryOp>(
+      std::make_unique<vAST::Index>(vAST::make_id("a"), vAST::make_num("0")),
+      vAST::BinOp::ADD, vAST::make_id(right));
+}
+
+// Module with input `i` and output `o` instantiating `child` (if not empty)
+// and assigning `o` to `i` otherwise
+std::unique_ptr<vAST::AbstractModule> make_module(std::string name,
+                                                  std::string child = "") {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("i"),
+                                               vAST::INPUT, vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("o"),
+                                               vAST::OUTPUT, vAST::WIRE));
+  Body body;
+  if (child.empty()) {
+    body.push_back(std::make_unique<vAST::ContinuousAssign>(
+        vAST::make_id("o"), vAST::make_id("i")));
+  } else {
+    std::map<std::string, std::variant<std::unique_ptr<vAST::Identifier>,
+                                       std::unique_ptr<vAST::Index>,
+                                       std::unique_ptr<vAST::Slice>,
+                                       std::unique_ptr<vAST::Concat>>>
+        connections;
+    connections["i"] = vAST::make_id("i");
+    connections["o"] = vAST::make_id("o");
+    body.push_back(std::make_unique<vAST::ModuleInstantiation>(
+        child, vAST::Parameters(), "inst", std::move(connections)));
+  }
+  return std::make_unique<vAST::Module>(name, std::move(ports),
+                                        std::move(body), vAST::Parameters());
+}
+
+TEST(StructuralTests, TestEqual) {
+  auto x = make_expr("b");
+  auto y = make_expr("b");
+  auto z = make_expr("c");
+  EXPECT_EQ(x->hash(), y->hash());
+  EXPECT_TRUE(x->structurallyEqual(*y));
+  EXPECT_FALSE(x->structurallyEqual(*z));
+  EXPECT_FALSE(x->structurallyEqual(*vAST::make_id("b")));
+
+  auto m = make_module("m");
+  auto n = make_module("n");
+  EXPECT_TRUE(m->structurallyEqual(*make_module("m")));
+  // The name is part of a module
+  EXPECT_FALSE(m->structurallyEqual(*n));
+}
+
+TEST(StructuralTests, TestDeep) {
+  std::unique_ptr<vAST::Expression> x = vAST::make_id("a");
+  std::unique_ptr<vAST::Expression> y = vAST::make_id("a");
+  for (int i = 0; i < 100000; i++) {
+    x = std::make_unique<vAST::UnaryOp>(std::move(x), vAST::UnOp::INVERT);
+    y = std::make_unique<vAST::UnaryOp>(std::move(y), vAST::UnOp::INVERT);
+  }
+  EXPECT_TRUE(x->structurallyEqual(*y));
+}
+
+class Renamer : public vAST::Transformer {
+ public:
+  std::unique_ptr<vAST::Expression> transform(
+      std::unique_ptr<vAST::Expression> node) override {
+    if (node->kind() == vAST::NodeKind::IDENTIFIER &&
+        static_cast<vAST::Identifier &>(*node).value.str() == "b") {
+      return vAST::make_id("c");
+    }
+    return node;
+  }
+};
+
+TEST(StructuralTests, TestInvalidate) {
+  auto x = make_expr("b");
+  auto z = make_expr("c");
+  size_t hash = x->hash();
+  EXPECT_NE(hash, z->hash());
+  // A Transformer resets the memoized hashes of the nodes it visits
+  Renamer renamer;
+  renamer.run(*x);
+  EXPECT_EQ(x->hash(), make_expr("c")->hash());
+  EXPECT_NE(x->hash(), hash);
+
+  // Edits made directly need an explicit reset
+  auto &op = static_cast<vAST::BinaryOp &>(*z);
+  op.op = vAST::BinOp::SUB;
+  op.invalidateHash();
+  EXPECT_FALSE(z->structurallyEqual(*make_expr("c")));
+
+  // Setting the prefix of an assignment resets its hash
+  vAST::ContinuousAssign assign(vAST::make_id("a"), vAST::make_id("b"));
+  hash = assign.hash();
+  assign.setPrefix("assign #1 ");
+  EXPECT_NE(assign.hash(), hash);
+}
+
+TEST(StructuralTests, TestDeduplicate) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  modules.push_back(make_module("leaf_a"));
+  modules.push_back(make_module("leaf_b"));
+  // Become identical once `leaf_b` is replaced by `leaf_a`
+  modules.push_back(make_module("top_a", "leaf_a"));
+  modules.push_back(make_module("top_b", "leaf_b"));
+  modules.push_back(make_module("top", "top_b"));
+  vAST::File file(modules);
+  EXPECT_EQ(vAST::deduplicate_modules(file), 2u);
+  ASSERT_EQ(file.modules.size(), 3u);
+  EXPECT_EQ(file.toString(),
+            "module leaf_a (input i, output o);\n"
+            "assign o = i;\n"
+            "endmodule\n\n"
+            "module top_a (input i, output o);\n"
+            "leaf_a inst(.i(i), .o(o));\n"
+            "endmodule\n\n"
+            "module top (input i, output o);\n"
+            "top_a inst(.i(i), .o(o));\n"
+            "endmodule\n");
+  EXPECT_EQ(vAST::deduplicate_modules(file), 0u);
+}
+
+TEST(StructuralTests, TestDeduplicateOpaqueText) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  modules.push_back(make_module("leaf_a"));
+  modules.push_back(make_module("leaf_b"));
+  modules.push_back(make_module("leaf_c"));
+  // Instantiates `leaf_b` in text that is not parsed, so it is kept
+  modules.push_back(std::make_unique<vAST::StringModule>(
+      "module top (input i, output o);\n"
+      "leaf_b inst(.i(i), .o(o));\n"
+      "endmodule"));
+  vAST::File file(modules);
+  EXPECT_EQ(vAST::deduplicate_modules(file), 1u);
+  ASSERT_EQ(file.modules.size(), 3u);
+  EXPECT_EQ(file.toString(),
+            "module leaf_a (input i, output o);\n"
+            "assign o = i;\n"
+            "endmodule\n\n"
+            "module leaf_b (input i, output o);\n"
+            "assign o = i;\n"
+            "endmodule\n\n"
+            "module top (input i, output o);\n"
+            "leaf_b inst(.i(i), .o(o));\n"
+            "endmodule");
+}
+
+TEST(StructuralTests, TestEmissionCache) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  modules.push_back(make_module("a"));
+  modules.push_back(make_module("b", "a"));
+  vAST::File file(modules);
+  file.cacheEmission();
+  // Fills the caches
+  file.toString();
+
+  // Renaming a module is seen without resetting its hash
+  auto &a = static_cast<vAST::Module &>(*file.modules[0]);
+  auto &b = static_cast<vAST::Module &>(*file.modules[1]);
+  a.name = "c";
+  b.name = "d";
+  EXPECT_EQ(file.toString(),
+            "module c (input i, output o);\n"
+            "assign o = i;\n"
+            "endmodule\n\n"
+            "module d (input i, output o);\n"
+            "a inst(.i(i), .o(o));\n"
+            "endmodule\n");
+
+  // Other edits, e.g. deep in the module, are seen once the memoized hash of
+  // the edited node is reset
+  auto &assign = static_cast<vAST::ContinuousAssign &>(
+      *std::get<std::unique_ptr<vAST::StructuralStatement>>(a.body[0]));
+  auto &target = *std::get<std::unique_ptr<vAST::Identifier>>(assign.target);
+  target.value = vAST::SymbolTable::current().intern("p");
+  target.invalidateHash();
+  EXPECT_EQ(file.toString().substr(0, 43),
+            "module c (input i, output o);\n"
+            "assign p = i;");
+  // Added statements are seen without resetting the hash
+  a.body.push_back(std::make_unique<vAST::Wire>(vAST::make_id("w")));
+  EXPECT_EQ(file.toString(),
+            "module c (input i, output o);\n"
+            "assign p = i;\n"
+            "wire w;\n"
+            "endmodule\n\n"
+            "module d (input i, output o);\n"
+            "a inst(.i(i), .o(o));\n"
+            "endmodule\n");
+  a.body.pop_back();
+  target.value = vAST::SymbolTable::current().intern("o");
+
+  // Transformers reset the hashes of the nodes they visit
+  vAST::fold_constants(a);
+  EXPECT_EQ(file.toString(),
+            "module c (input i, output o);\n"
+            "assign o = i;\n"
+            "endmodule\n\n"
+            "module d (input i, output o);\n"
+            "a inst(.i(i), .o(o));\n"
+            "endmodule\n");
+
+  // Replacing a statement in place is seen, as destroying the old one
+  // invalidates the cache
+  a.body[0] = std::make_unique<vAST::ContinuousAssign>(vAST::make_id("o"),
+                                                       vAST::make_num("3"));
+  EXPECT_EQ(file.toString().substr(0, 43),
+            "module c (input i, output o);\n"
+            "assign o = 3;");
+
+  file.cacheEmission(false);
+  EXPECT_EQ(file.toString(),
+            "module c (input i, output o);\n"
+            "assign o = 3;\n"
+            "endmodule\n\n"
+            "module d (input i, output o);\n"
+            "a inst(.i(i), .o(o));\n"
+            "endmodule\n");
+}
+
+TEST(StructuralTests, TestEmissionCacheEdits) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  modules.push_back(make_module("m"));
+  vAST::File file(modules);
+  file.cacheEmission();
+  auto &m = static_cast<vAST::Module &>(*file.modules[0]);
+  m.body.push_back(std::make_unique<vAST::ContinuousAssign>(vAST::make_id("o"),
+                                                            make_expr("b")));
+  EXPECT_EQ(file.toString(),
+            "module m (input i, output o);\n"
+            "assign o = i;\n"
+            "assign o = a[0] + b;\n"
+            "endmodule\n");
+
+  // Setting a prefix is seen without touching the ancestors of the assignment
+  auto &first = static_cast<vAST::ContinuousAssign &>(
+      *std::get<std::unique_ptr<vAST::StructuralStatement>>(m.body[0]));
+  first.setPrefix("assign #1 ");
+  EXPECT_EQ(file.toString(),
+            "module m (input i, output o);\n"
+            "assign #1 o = i;\n"
+            "assign o = a[0] + b;\n"
+            "endmodule\n");
+
+  // So is an identifier edited deep in an expression and reset on its own
+  auto &second = static_cast<vAST::ContinuousAssign &>(
+      *std::get<std::unique_ptr<vAST::StructuralStatement>>(m.body[1]));
+  auto &sum = static_cast<vAST::BinaryOp &>(*second.value);
+  auto &index = static_cast<vAST::Index &>(*sum.left);
+  auto &id = *index.id;
+  id.value = vAST::SymbolTable::current().intern("q");
+  id.invalidateHash();
+  EXPECT_EQ(file.toString(),
+            "module m (input i, output o);\n"
+            "assign #1 o = i;\n"
+            "assign o = q[0] + b;\n"
+            "endmodule\n");
+}
+
+TEST(StructuralTests, TestEmissionCacheReplace) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  modules.push_back(make_module("top", "leaf"));
+  modules.push_back(make_module("other"));
+  vAST::File file(modules);
+  file.cacheEmission();
+  file.toString();
+  auto &top = static_cast<vAST::Module &>(*file.modules[0]);
+  top.body.push_back(std::make_unique<vAST::Wire>(vAST::make_id("w")));
+  EXPECT_EQ(file.modules[0]->toString(),
+            "module top (input i, output o);\n"
+            "leaf inst(.i(i), .o(o));\n"
+            "wire w;\n"
+            "endmodule\n");
+
+  // Replacing a connection destroys the old one, which invalidates the cache
+  auto &inst = static_cast<vAST::ModuleInstantiation &>(
+      *std::get<std::unique_ptr<vAST::StructuralStatement>>(top.body[0]));
+  inst.connections[0].second = vAST::make_id("x");
+  EXPECT_EQ(file.modules[0]->toString(),
+            "module top (input i, output o);\n"
+            "leaf inst(.i(x), .o(o));\n"
+            "wire w;\n"
+            "endmodule\n");
+
+  // Reordering statements needs the hash of the module to be reset
+  std::swap(top.body[0], top.body[1]);
+  top.invalidateHash();
+  EXPECT_EQ(file.modules[0]->toString(),
+            "module top (input i, output o);\n"
+            "wire w;\n"
+            "leaf inst(.i(x), .o(o));\n"
+            "endmodule\n");
+
+  // Destroying a cached module leaves the others cached
+  file.modules.erase(file.modules.begin());
+  EXPECT_EQ(file.toString(),
+            "module other (input i, output o);\n"
+            "assign o = i;\n"
+            "endmodule\n");
+}
+
+}  // namespace
@@ -0,0 +1,186 @@
+#include "verilogAST/transformer.hpp"
+
+#include <algorithm>
+
+#include "common.cpp"
+#include "gtest/gtest.h"
+#include "verilogAST.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+class IdentifierCollector : public vAST::Visitor {
+ public:
+  std::vector<std::string> names;
+  size_t num_nodes = 0;
+  size_t num_leaves = 0;
+
+  bool enter(const vAST::Node &node) override {
+    num_nodes++;
+    if (node.kind() == vAST::NodeKind::IDENTIFIER) {
+      names.push_back(static_cast<const vAST::Identifier &>(node).value.str());
+    }
+    return true;
+  }
+  void leave(const vAST::Node &) override { num_leaves++; }
+};
+
+// Replaces every identifier named `from` with one named `to`
+class Rename : public vAST::Transformer {
+  std::string from, to;
+
+ public:
+  Rename(std::string from, std::string to) : from(from), to(to) {}
+
+  std::unique_ptr<vAST::Expression> transform(
+      std::unique_ptr<vAST::Expression> node) override {
+    if (node->kind() == vAST::NodeKind::IDENTIFIER &&
+        static_cast<vAST::Identifier &>(*node).value == from) {
+      return vAST::make_id(to);
+    }
+    return node;
+  }
+};
+
+TEST(TransformerTests, TestWalkModule) {
+  vAST::Module module("test_module", make_simple_ports(), make_simple_body(),
+                      make_simple_params());
+  IdentifierCollector collector;
+  vAST::walk(module, collector);
+  std::vector<std::string> expected = {"param0", "param1", "i",  "o",
+                                       "param0", "param1", "a",  "b", "c"};
+  EXPECT_EQ(collector.names, expected);
+  EXPECT_EQ(collector.num_nodes, collector.num_leaves);
+}
+
+TEST(TransformerTests, TestWalkSkipChildren) {
+  class SkipIndex : public IdentifierCollector {
+    bool enter(const vAST::Node &node) override {
+      IdentifierCollector::enter(node);
+      return node.kind() != vAST::NodeKind::INDEX;
+    }
+  } collector;
+  vAST::Slice slice(vAST::make_id("x"), vAST::make_num("1"),
+                    std::make_unique<vAST::Index>(vAST::make_id("y"),
+                                                  vAST::make_num("0")));
+  vAST::walk(slice, collector);
+  EXPECT_EQ(collector.names, std::vector<std::string>{"x"});
+}
+
+TEST(TransformerTests, TestRename) {
+  vAST::Module module("test_module", make_simple_ports(), make_simple_body(),
+                      make_simple_params());
+  Rename rename("b", "d");
+  rename.run(module);
+  EXPECT_EQ(module.toString(),
+            "module test_module #(parameter param0 = 0, parameter param1 = "
+            "1) (input i, output o);\nother_module #(.param0(0), "
+            ".param1(1)) other_module_inst(.a(a), .b(d[0]), "
+            ".c(c[31:0]));\nendmodule\n");
+}
+
+TEST(TransformerTests, TestReplaceExpressionRoot) {
+  class FoldAdd : public vAST::Transformer {
+    std::unique_ptr<vAST::Expression> transform(
+        std::unique_ptr<vAST::Expression> node) override {
+      if (node->kind() == vAST::NodeKind::BINARY_OP) {
+        return vAST::make_num("3");
+      }
+      return node;
+    }
+  } fold;
+  std::unique_ptr<vAST::Expression> expr = vAST::make_binop(
+      vAST::make_num("1"), vAST::BinOp::ADD, vAST::make_num("2"));
+  expr = fold.run(std::move(expr));
+  EXPECT_EQ(expr->toString(), "3");
+}
+
+TEST(TransformerTests, TestReplaceVariantAlternative) {
+  class IndexTarget : public vAST::Transformer {
+    std::unique_ptr<vAST::Expression> transform(
+        std::unique_ptr<vAST::Expression> node) override {
+      if (node->kind() == vAST::NodeKind::IDENTIFIER &&
+          static_cast<vAST::Identifier &>(*node).value == "a") {
+        return std::make_unique<vAST::Index>(vAST::make_id("a"),
+                                             vAST::make_num("0"));
+      }
+      return node;
+    }
+  } transformer;
+  vAST::ContinuousAssign assign(vAST::make_id("a"), vAST::make_id("b"));
+  transformer.run(assign);
+  EXPECT_EQ(assign.toString(), "assign a[0] = b;");
+  EXPECT_TRUE(std::holds_alternative<std::unique_ptr<vAST::Index>>(
+      assign.target));
+}
+
+TEST(TransformerTests, TestBadReplacement) {
+  class ReplaceWithNum : public vAST::Transformer {
+    std::unique_ptr<vAST::Expression> transform(
+        std::unique_ptr<vAST::Expression> node) override {
+      if (node->kind() == vAST::NodeKind::IDENTIFIER) {
+        return vAST::make_num("0");
+      }
+      return node;
+    }
+  } transformer;
+  // Index::id has to be an Identifier
+  vAST::Index index(vAST::make_id("x"), vAST::make_num("0"));
+  EXPECT_THROW(transformer.run(index), std::runtime_error);
+  // So does a continuous assign target
+  vAST::ContinuousAssign assign(vAST::make_id("a"), vAST::make_id("b"));
+  EXPECT_THROW(transformer.run(assign), std::runtime_error);
+}
+
+TEST(TransformerTests, TestEditStatements) {
+  // Drops every module instance from module bodies
+  class RemoveInstances : public vAST::Transformer {
+    void leave(vAST::Node &node) override {
+      if (node.kind() != vAST::NodeKind::MODULE) return;
+      auto &body = static_cast<vAST::Module &>(node).body;
+      body.erase(
+          std::remove_if(body.begin(), body.end(),
+                         [](auto &statement) {
+                           auto *structural = std::get_if<
+                               std::unique_ptr<vAST::StructuralStatement>>(
+                               &statement);
+                           return structural &&
+                                  (*structural)->kind() ==
+                                      vAST::NodeKind::MODULE_INSTANTIATION;
+                         }),
+          body.end());
+    }
+  } transformer;
+  vAST::Module module("test_module", make_simple_ports(), make_simple_body(),
+                      vAST::Parameters());
+  transformer.run(module);
+  EXPECT_EQ(module.toString(),
+            "module test_module (input i, output o);\nendmodule\n");
+}
+
+TEST(TransformerTests, TestDeepTree) {
+  std::unique_ptr<vAST::Expression> expr = vAST::make_id("x");
+  const size_t depth = 10000;
+  for (size_t i = 0; i < depth; i++) {
+    expr = vAST::make_binop(std::move(expr), vAST::BinOp::ADD,
+                            vAST::make_id("x"));
+  }
+  IdentifierCollector collector;
+  vAST::walk(*expr, collector);
+  EXPECT_EQ(collector.num_nodes, 2 * depth + 1);
+
+  Rename rename("x", "y");
+  expr = rename.run(std::move(expr));
+  collector.names.clear();
+  vAST::walk(*expr, collector);
+  EXPECT_EQ(collector.names.size(), depth + 1);
+  EXPECT_EQ(collector.names.back(), "y");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}